@@ -0,0 +1,100 @@
+// Library interface of the simulation (libsmopt)
+// A simulation is set up from a genome and tRNA table held in memory, run in pieces and queried for its statistics
+// as arrays, without files. Every simulation keeps its own state, so several can be run at the same time by
+// different threads. Build the library by compiling translation_v2.0.c without its main():
+//
+//	gcc -c -fPIC -O3 -DSMOPT_LIB source/translation_v2.0.c -o smopt.o
+//	gcc -shared -o libsmopt.so smopt.o -lgsl -lgslcblas -lm -lpthread
+//
+// As in the rest of the program, running out of memory ends the process.
+
+#ifndef SMOPT_H
+#define SMOPT_H
+
+#include <stdint.h>
+
+typedef struct smopt_sim smopt_sim;
+
+// Parameters of a simulation, named after the options of the command line
+typedef struct
+{	int tot_ribo;				// Total ribosomes (-R)
+	int tot_tRNA;				// Total tRNAs (-t)
+	double volume;				// Volume of the cell (-V). As with -V, the space available to ribosomes and tRNAs is computed
+								// from it, so the defaults match the command line run with -V 4.2e-17
+	double chx_rb_prob;			// Cycloheximide binding probability and dissociation rate (-x1, -x2)
+	double chx_ds_rate;
+	double harr_rf_rate;		// Harringtonine action rate on free ribosomes (-y)
+	double chx_time;			// Times at which cycloheximide and harringtonine are added (-Tc, -Th)
+	double harr_time;
+	double thresh_time;			// Burn-in: statistics are gathered after this time (-Tb)
+	int engine;					// Event selection method: 0 direct, 1 composition-rejection, 2 next reaction (-E)
+	int rng;					// Random number generator: 0 mt19937, 1 xoshiro, 2 pcg64, 3 philox (-G)
+	int seed;					// Seed and random stream (-s, -Gs)
+	int stream;
+	double leap_eps;			// Error control of a leaped burn-in, 0 for an exact one (-Tl)
+} smopt_params;
+
+// Default parameters, those of the command line without options
+void smopt_default_params(smopt_params *P);
+
+// Set up a simulation with all ribosomes free. Gene g has len[g] codons seq[g][0...len[g]-1] (codon numbers 0...60
+// as in the processed sequence files), the initiation probability ini_prob[g] and n_mRNA[g] mRNAs. tid, gcn and
+// wobble are the columns of the tRNA file for the 61 codons. The inputs are copied. Returns NULL if they are invalid
+// or memory runs out, with nothing left allocated.
+smopt_sim *smopt_create(const smopt_params *P, int n_genes, const int *len, const uint8_t *const *seq, const double *ini_prob,
+	const int *n_mRNA, const int *tid, const int *gcn, const double *wobble);
+
+// Simulate up to time t. Runs can be continued with a later t.
+void smopt_run(smopt_sim *S, double t);
+
+// Simulate the next n_events events, whatever the time they take. Returns the number of events simulated, fewer
+// than n_events only if no event can happen anymore. A leap of a leaped burn-in is applied as a whole, so a step
+// that ends with a leap returns all the events of the leap, which can be more than n_events.
+long smopt_step(smopt_sim *S, long n_events);
+
+// Change the drugs (chx_rb_prob, chx_ds_rate, harr_rf_rate, chx_time, harr_time of P, the rest is ignored) for the
+// rest of the simulation, e.g. to add cycloheximide now by setting chx_time to smopt_time(). Returns 0 if they are
+// invalid, leaving the drugs unchanged.
+int smopt_set_drugs(smopt_sim *S, const smopt_params *P);
+
+// Current time of the simulation
+double smopt_time(smopt_sim *S);
+
+// Number of mRNAs, numbered gene by gene in the order of the genes
+int smopt_n_mRNA(smopt_sim *S);
+
+// Number of elongation events and average elongation time of each of the 61 codons after the burn-in (-p1), the
+// average being 0 for codons without events
+void smopt_codon_etimes(smopt_sim *S, int *n_events, double *avg_time);
+
+// Number of translation events, average time between initiations and average total elongation time of each gene
+// after the burn-in (-p2, -p3), the averages being 0 for genes not translated
+void smopt_gene_times(smopt_sim *S, int *n_trans, double *avg_ini, double *avg_elng);
+
+// Average free ribosomes and free tRNAs of each of the 61 tRNA types after the burn-in (-p4), 0 before it.
+// Either pointer can be NULL.
+void smopt_avg_pools(smopt_sim *S, double *avg_ribo, double *avg_tRNA);
+
+// Current free ribosomes and free tRNAs of each of the 61 tRNA types. Either pointer can be NULL.
+void smopt_free_pools(smopt_sim *S, int *ribo, int *tRNA);
+
+// Current number of ribosomes bound at each codon of a gene, summed over its mRNAs (len of the gene values)
+void smopt_occupancy(smopt_sim *S, int gene, int *count);
+
+// The state of the simulation as it is updated by the runs, without copies. The pointers stay valid until
+// smopt_destroy and must not be written to.
+// Free tRNAs of each of the 61 tRNA types
+const int *smopt_Tf(smopt_sim *S);
+// Bound ribosomes that can be elongated at each of the 61 codons
+const int *smopt_n_Rb_e(smopt_sim *S);
+// Initiable mRNAs of each gene (the first 10 codons unbound)
+const int *smopt_Mf(smopt_sim *S);
+// Occupancy grid: the ribosome (0...tot_ribo-1) bound at each codon of each mRNA, or tot_ribo if none, with the
+// rows of all mRNAs back to back. The row of mRNA m starts at row_off[m] (row_off[n_mRNA] is the size of the grid)
+// and belongs to gene mRNA_gene[m]. Its first len codons are those of the gene; the rest are always empty.
+// Returns NULL (row_off and mRNA_gene are still set) if built with -DSPARSE_RGRID, which keeps no grid.
+const int *smopt_grid(smopt_sim *S, const long **row_off, const int **mRNA_gene);
+
+void smopt_destroy(smopt_sim *S);
+
+#endif
@@ -0,0 +1,258 @@
+# Python bindings of the simulation library (smopt.h), with NumPy views of the state of a running simulation.
+# The library is loaded with ctypes, so nothing else has to be compiled. Build it as described in smopt.h:
+#
+#	gcc -c -fPIC -O3 -DSMOPT_LIB source/translation_v2.0.c -o smopt.o
+#	gcc -shared -o libsmopt.so smopt.o -lgsl -lgslcblas -lm -lpthread
+#
+# and put libsmopt.so next to this file, on the library path, or in $SMOPT_LIBRARY.
+#
+# Example, on a synthetic genome of yeast size written by utilities/make.synthetic.genome.pl:
+#	perl utilities/make.synthetic.genome.pl 4839 400 0.6 1.0 0.5 1 example/input/synthetic
+#
+#	import smopt
+#	genome = smopt.read_genome("example/input/synthetic.genom")
+#	trna = smopt.read_trna("example/input/S.cer.tRNA")
+#	sim = smopt.Simulation(genome, trna, tot_ribo=200000, tot_tRNA=3300000, thresh_time=1000, seed=1)
+#	Tf = sim.Tf									# Live view: changes as the simulation runs
+#	while sim.time < 1500:
+#		sim.step(100000)
+#		if Tf.min() < 10 and sim.chx_rb_prob == 0:
+#			sim.set_drugs(chx_rb_prob=0.5, chx_time=sim.time)
+#	n_events, avg_time = sim.codon_etimes()
+
+import ctypes
+import ctypes.util
+import os
+
+import numpy as np
+
+ENGINES = ["direct", "cr", "nrm"]
+RNGS = ["mt19937", "xoshiro", "pcg64", "philox"]
+DRUGS = ["chx_rb_prob", "chx_ds_rate", "harr_rf_rate", "chx_time", "harr_time"]
+
+
+class Params(ctypes.Structure):
+	_fields_ = [("tot_ribo", ctypes.c_int),
+		("tot_tRNA", ctypes.c_int),
+		("volume", ctypes.c_double),
+		("chx_rb_prob", ctypes.c_double),
+		("chx_ds_rate", ctypes.c_double),
+		("harr_rf_rate", ctypes.c_double),
+		("chx_time", ctypes.c_double),
+		("harr_time", ctypes.c_double),
+		("thresh_time", ctypes.c_double),
+		("engine", ctypes.c_int),
+		("rng", ctypes.c_int),
+		("seed", ctypes.c_int),
+		("stream", ctypes.c_int),
+		("leap_eps", ctypes.c_double)]
+
+
+def _load():
+	path = os.environ.get("SMOPT_LIBRARY")
+	if path is None:
+		path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "libsmopt.so")
+		if not os.path.exists(path):
+			path = ctypes.util.find_library("smopt")
+	if path is None:
+		raise OSError("libsmopt not found: build it (see smopt.h) or set SMOPT_LIBRARY")
+	lib = ctypes.CDLL(path)
+
+	sim = ctypes.c_void_p
+	p_int = ctypes.POINTER(ctypes.c_int)
+	p_double = ctypes.POINTER(ctypes.c_double)
+	p_long = ctypes.POINTER(ctypes.c_long)
+	sigs = {"smopt_default_params": (None, [ctypes.POINTER(Params)]),
+		"smopt_create": (sim, [ctypes.POINTER(Params), ctypes.c_int, p_int, ctypes.POINTER(ctypes.c_void_p), p_double, p_int, p_int, p_int, p_double]),
+		"smopt_run": (None, [sim, ctypes.c_double]),
+		"smopt_step": (ctypes.c_long, [sim, ctypes.c_long]),
+		"smopt_set_drugs": (ctypes.c_int, [sim, ctypes.POINTER(Params)]),
+		"smopt_time": (ctypes.c_double, [sim]),
+		"smopt_n_mRNA": (ctypes.c_int, [sim]),
+		"smopt_codon_etimes": (None, [sim, p_int, p_double]),
+		"smopt_gene_times": (None, [sim, p_int, p_double, p_double]),
+		"smopt_avg_pools": (None, [sim, p_double, p_double]),
+		"smopt_free_pools": (None, [sim, p_int, p_int]),
+		"smopt_Tf": (p_int, [sim]),
+		"smopt_n_Rb_e": (p_int, [sim]),
+		"smopt_Mf": (p_int, [sim]),
+		"smopt_grid": (p_int, [sim, ctypes.POINTER(p_long), ctypes.POINTER(p_int)]),
+		"smopt_destroy": (None, [sim])}
+	for name, (res, args) in sigs.items():
+		f = getattr(lib, name)
+		f.restype = res
+		f.argtypes = args
+	return lib
+
+
+_lib = _load()
+
+
+def _ptr(a, ctype):
+	return a.ctypes.data_as(ctypes.POINTER(ctype))
+
+
+def _view(ptr, n):
+	# Read-only array over memory of the library, without a copy
+	a = np.ctypeslib.as_array(ptr, shape=(n,))
+	a.setflags(write=False)
+	return a
+
+
+def read_genome(filename, n_genes=None):
+	"""Processed sequence file (.genom): one gene per line, its initiation probability, number of mRNAs and codons.
+	Returns (ini_prob, n_mRNA, seqs) with seqs a list of uint8 arrays of codons."""
+	ini_prob, n_mRNA, seqs = [], [], []
+	with open(filename) as fh:
+		for line in fh:
+			x = line.split()
+			if not x:
+				continue
+			ini_prob.append(float(x[0]))
+			n_mRNA.append(int(x[1]))
+			seqs.append(np.array([int(c) for c in x[2:]], dtype=np.uint8))
+			if n_genes is not None and len(seqs) == n_genes:
+				break
+	return np.array(ini_prob), np.array(n_mRNA, dtype=np.intc), seqs
+
+
+def read_trna(filename):
+	"""tRNA file: codon, tRNA id, tRNA gene copy number and wobble parameter of the 61 codons.
+	Returns (tid, gcn, wobble)."""
+	x = np.loadtxt(filename, ndmin=2)[:61]
+	return x[:, 1].astype(np.intc), x[:, 2].astype(np.intc), x[:, 3].astype(np.double)
+
+
+class Simulation:
+	"""A simulated cell. Parameters are the fields of smopt_params given as keywords (engine and rng can be given
+	by name), the rest keep the defaults of the command line. The views Tf, n_Rb_e, Mf and grid are live: they
+	show the current state without copies and stay valid until close()."""
+
+	def __init__(self, genome, trna, **par):
+		self._sim = None
+		ini_prob, n_mRNA, seqs = genome
+		tid, gcn, wobble = trna
+		self.par = Params()
+		_lib.smopt_default_params(ctypes.byref(self.par))
+		for k, v in par.items():
+			if k == "engine" and isinstance(v, str):
+				v = ENGINES.index(v)
+			elif k == "rng" and isinstance(v, str):
+				v = RNGS.index(v)
+			if k not in dict(Params._fields_):
+				raise TypeError("Unknown parameter " + k)
+			setattr(self.par, k, v)
+
+		self.n_genes = len(seqs)
+		self.len = np.array([len(s) for s in seqs], dtype=np.intc)
+		seqs = [np.ascontiguousarray(s, dtype=np.uint8) for s in seqs]
+		seq_ptr = (ctypes.c_void_p * self.n_genes)(*[s.ctypes.data for s in seqs])
+		ini_prob = np.ascontiguousarray(ini_prob, dtype=np.double)
+		n_mRNA = np.ascontiguousarray(n_mRNA, dtype=np.intc)
+		tid = np.ascontiguousarray(tid, dtype=np.intc)
+		gcn = np.ascontiguousarray(gcn, dtype=np.intc)
+		wobble = np.ascontiguousarray(wobble, dtype=np.double)
+		if len(ini_prob) != self.n_genes or len(n_mRNA) != self.n_genes or len(tid) != 61 or len(gcn) != 61 or len(wobble) != 61:
+			raise ValueError("Genome or tRNA table of the wrong size")
+		self._sim = _lib.smopt_create(ctypes.byref(self.par), self.n_genes, _ptr(self.len, ctypes.c_int), seq_ptr,
+			_ptr(ini_prob, ctypes.c_double), _ptr(n_mRNA, ctypes.c_int), _ptr(tid, ctypes.c_int), _ptr(gcn, ctypes.c_int), _ptr(wobble, ctypes.c_double))
+		if not self._sim:
+			raise ValueError("Invalid parameters, genome or tRNA table, or out of memory")
+
+		self.n_mRNA = _lib.smopt_n_mRNA(self._sim)
+		self.Tf = _view(_lib.smopt_Tf(self._sim), 61)
+		self.n_Rb_e = _view(_lib.smopt_n_Rb_e(self._sim), 61)
+		self.Mf = _view(_lib.smopt_Mf(self._sim), self.n_genes)
+		row_off = ctypes.POINTER(ctypes.c_long)()
+		mRNA_gene = ctypes.POINTER(ctypes.c_int)()
+		grid = _lib.smopt_grid(self._sim, ctypes.byref(row_off), ctypes.byref(mRNA_gene))
+		self.row_off = _view(row_off, self.n_mRNA+1)
+		self.mRNA_gene = _view(mRNA_gene, self.n_mRNA)
+		self.grid = _view(grid, int(self.row_off[-1])) if grid else None
+
+	def close(self):
+		if self._sim:
+			_lib.smopt_destroy(self._sim)
+			self._sim = None
+			self.Tf = self.n_Rb_e = self.Mf = self.grid = self.row_off = self.mRNA_gene = None
+
+	def __del__(self):
+		self.close()
+
+	def __enter__(self):
+		return self
+
+	def __exit__(self, *exc):
+		self.close()
+
+	@property
+	def time(self):
+		return _lib.smopt_time(self._sim)
+
+	def run_until(self, t):
+		"""Simulate up to time t."""
+		_lib.smopt_run(self._sim, t)
+
+	def step(self, n_events):
+		"""Simulate the next n_events events. Returns the number simulated, fewer only if no event can happen and
+		more if the step ends with a leap of a leaped burn-in (leap_eps)."""
+		return _lib.smopt_step(self._sim, n_events)
+
+	def set_drugs(self, **drugs):
+		"""Change any of chx_rb_prob, chx_ds_rate, harr_rf_rate, chx_time and harr_time for the rest of the run."""
+		par = Params.from_buffer_copy(self.par)
+		for k, v in drugs.items():
+			if k not in DRUGS:
+				raise TypeError("Unknown drug parameter " + k)
+			setattr(par, k, v)
+		if _lib.smopt_set_drugs(self._sim, ctypes.byref(par)) == 0:
+			raise ValueError("Invalid drug parameters")
+		self.par = par
+
+	def __getattr__(self, name):
+		# Parameters of the simulation, e.g. sim.chx_time
+		if name != "par" and name in dict(Params._fields_):
+			return getattr(self.par, name)
+		raise AttributeError(name)
+
+	def row(self, m):
+		"""Occupancy of the codons of mRNA m: the ribosome bound at each codon, or tot_ribo if none (a view)."""
+		if self.grid is None:
+			raise ValueError("No occupancy grid in a library built with -DSPARSE_RGRID")
+		off = int(self.row_off[m])
+		return self.grid[off:off+self.len[self.mRNA_gene[m]]]
+
+	def occupancy(self, gene):
+		"""Ribosomes bound at each codon of a gene, summed over its mRNAs (a copy)."""
+		count = np.zeros(self.len[gene], dtype=np.intc)
+		for m in np.flatnonzero(self.mRNA_gene == gene):
+			count += self.row(m) != self.par.tot_ribo
+		return count
+
+	def free_ribo(self):
+		n = ctypes.c_int()
+		_lib.smopt_free_pools(self._sim, ctypes.byref(n), None)
+		return n.value
+
+	def codon_etimes(self):
+		"""Number of elongation events and average elongation time of each codon after the burn-in (-p1), 0 without events."""
+		n = np.zeros(61, dtype=np.intc)
+		t = np.zeros(61)
+		_lib.smopt_codon_etimes(self._sim, _ptr(n, ctypes.c_int), _ptr(t, ctypes.c_double))
+		return n, t
+
+	def gene_times(self):
+		"""Translation events, average time between initiations and average elongation time of each gene (-p2, -p3),
+		0 for genes not translated."""
+		n = np.zeros(self.n_genes, dtype=np.intc)
+		ini = np.zeros(self.n_genes)
+		elng = np.zeros(self.n_genes)
+		_lib.smopt_gene_times(self._sim, _ptr(n, ctypes.c_int), _ptr(ini, ctypes.c_double), _ptr(elng, ctypes.c_double))
+		return n, ini, elng
+
+	def avg_pools(self):
+		"""Average free ribosomes and free tRNAs of each tRNA type after the burn-in (-p4)."""
+		ribo = ctypes.c_double()
+		tRNA = np.zeros(61)
+		_lib.smopt_avg_pools(self._sim, ctypes.byref(ribo), _ptr(tRNA, ctypes.c_double))
+		return ribo.value, tRNA
@@ -6,6 +6,17 @@ To compile and run the code run:
 	gcc translation.c -g -lm -mtune=generic -O3 -o SMoPT
 	./SMoPT
 
+To report the progress of long runs as lines of JSON (-L), add -DSMOPT_TELEMETRY. Without it the counters
+are not compiled at all.
+
+To build the benchmark binary used by utilities/bench.pl, which counts and times the events and can stop after a
+fixed number of events (-B), add -DSMOPT_BENCH:
+
+	gcc translation_v2.0.c -g -lm -lgsl -lgslcblas -O3 -DSMOPT_BENCH -o SMoPT_v2_bench
+
+To build the library declared in smopt.h, which runs simulations from inputs in memory, add -DSMOPT_LIB to leave
+main() out (see smopt.h).
+
 */
 // Declaring Header Files
 #include <stdio.h>
@@ -14,16 +25,56 @@ To compile and run the code run:
 #include <time.h>
 #include <sys/time.h> 
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <errno.h>
+#include <dirent.h>
+#include <stdarg.h>
 #include <gsl/gsl_rng.h>
+#include <gsl/gsl_randist.h>
+#include "smopt.h"
+#ifdef SMOPT_BENCH
+#include <sys/resource.h>
+#endif
 
 // Fixed parameters
-#define MAX_GENES 5000				// Maximum number of genes supported
-#define MAX_GENE_LEN_ALLW 5000		// Maximum allowed gene length in codons
 #define MAX_TIME 2400000			// Maximum time of the simulation
 #define char_len_tRNA 1.5e-8		// Characteristic length of tRNA
 #define char_len_ribo 3e-8			// Characteristic length of ribosome
 #define char_time_tRNA 5.719e-4		// Characteristic time of movement for tRNA (4.45e-7 * 1285.1)
 #define char_time_ribo 5e-4			// Characteristic time of movement for ribosome
+#define THREAD_STACK_SIZE 67108864	// Stack size of replicate threads (64 MB)
+
+// Synchronization of the domains of a cell (-D)
+#define DOMAIN_WINDOW0 1e-3			// First synchronization window (s)
+#define DOMAIN_MIN_SHARE 16			// Errors of free pools smaller than this per domain are measured against it
+#define SWEEP_N_PAR 8				// Parameters that can be swept (-S)
+#define SWEEP_MAX_VALUES 256		// Maximum number of values of a swept parameter
+
+// Event selection methods
+#define ENGINE_DIRECT 0				// Direct method with sum trees
+#define ENGINE_CR 1					// Composition-rejection
+#define ENGINE_NRM 2				// Next reaction method (Gibson-Bruck)
+
+// Random number generators (-G)
+#define RNG_MT19937 0				// Mersenne twister of GSL, as in published runs
+#define RNG_XOSHIRO 1				// xoshiro256++
+#define RNG_PCG64 2					// PCG64 (128-bit LCG with XSL-RR output)
+#define RNG_PHILOX 3				// Philox4x32-10 (counter-based)
+// Every cell draws from its own stream, given by the seed (-s), its replicate (-n) and its partition (domain with -D).
+// MT19937 is seeded with seed+replicate+partition as in earlier versions. Philox is keyed by the seed and the
+// counter of the stream is (block, replicate, partition), so streams never overlap and any block of any stream
+// can be generated on its own. xoshiro256++ and PCG64 are seeded by hashing the three.
+#define RNG_BATCH 256				// Numbers generated at a time by the generators other than MT19937
+#define RNG_LANES 4					// Interleaved xoshiro256++ streams, so a batch is filled lane-parallel
 
 // Default global variables
 int seed = 0;						// Seed for RNG
@@ -44,11 +95,50 @@ double harr_time = 1500;			// Threshold time for action of harringtonine
 
 // Run options
 int printOpt[9] = {0,0,0,0,0,0,0,0,0};
+int traj_opt = 0;					// Write a binary trajectory of ribosome positions (-pt)
+int stall_opt = 0;					// Time spent by stalled ribosomes at each position of every gene (-ps)
+int engine = ENGINE_DIRECT;			// Event selection method
+int rng_type = RNG_MT19937;			// Random number generator (-G)
+int first_stream = 0;				// Random stream of the first replicate (-Gs)
+int n_replicates = 1;				// Number of replicate cells simulated with seeds seed, seed+1, ...
+int n_threads = 1;					// Number of threads simulating replicates
+int n_domains = 1;					// Domains of a single cell, each simulated by its own thread (-D)
+double domain_tol = 0.01;			// Tolerated relative error of the free pools seen by a domain (-Dt)
 char out_prefix[150] = "output";	// Prefix for output file names
-char out_file[150];
 char fasta_file[150] = "example/input/S.cer.genom";
 char code_file[150] = "example/input/S.cer.tRNA";
+char orf_fasta_file[150] = "";		// FASTA file of ORFs read directly instead of fasta_file (-Ff)
+char gcode_file[150] = "utilities/genetic.code.tsv";
+char abndc_file[150] = "";
 char state_file[150] = "";
+char ckpt_file[150] = "";			// Checkpoint written during the simulation (-K)
+char resume_file[150] = "";			// Checkpoint the simulation is resumed from (-k)
+double ckpt_period = 0;				// Simulated time between checkpoints (0: only at the end)
+#ifdef SMOPT_BENCH
+long bench_events = 0;				// Stop after this many events (-B), 0: run to tot_time
+struct timespec bench_start;		// Start of the program, for the startup time
+#endif
+#ifdef SMOPT_TELEMETRY
+char telem_file[150] = "";			// Progress reports written during the simulation (-L), "-" for stderr
+double telem_period = 10;			// Wall seconds between progress reports (-Lp)
+FILE *telem_fh = NULL;
+#endif
+double leap_eps = 0;				// Error control of the leaped burn-in (-Tl), 0: exact burn-in
+int leap_validate = 0;				// Compare the leaped burn-in with an exact one (-Tv)
+char sweep_file[150] = "";			// Grid of parameters simulated as a sweep (-S)
+char server_socket[108] = "";		// Unix socket of the job server (-W), or that jobs are sent to (-Wc)
+int server_client = 0;				// Send jobs read from stdin to the server (-Wc)
+char cache_dir[150] = "";			// Directory of the result cache (-Oc), "" for none
+char cache_key[65] = "";			// Key of the run in the cache
+char *cache_manifest = NULL;		// Provenance of the run: binary, command line and input files with their hashes
+char **cache_outputs = NULL;		// Output files opened by the run (Output_Open), stored in the cache with it
+int n_cache_outputs = 0;
+int max_cache_outputs = 0;
+pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;	// Guards cache_outputs, opened by replicates and sweep points in threads
+char stall_genes_file[150] = "";	// Genes whose stalls are tracked by position with -ps (-Fs), all genes if not given
+
+int *stall_off = NULL;				// Offset of each gene in the per position stall arrays of a cell, -1 if not tracked (-ps)
+int n_stall_pos = 0;				// Total number of tracked positions
 
 
 
@@ -57,14 +147,24 @@ char state_file[150] = "";
 
 
 // Create ribosome and mRNA based structures
+// The fields of the ribosomes are kept in separate arrays by how they are accessed, so the ribosomes looked up
+// through the grid or the elongatable lists bring only what the event needs into the cache
 typedef struct
-{	int mRNA;					// Bound to which mRNA
-	int pos;					// Position on mRNA
-	double t_trans_ini;			// Time of translation initiation
-	double t_elong_ini;			// Time of arrival at current codon
-	int elng_cod_list;			// The id of the list of elongatable codons
-	int elng_pos_list;			// Position in the list of elongatable codons
-	int inhbtr_bound;			// Is the ribosome bound with CHX or Harr?
+{	int32_t mRNA;				// Bound to which mRNA
+	int32_t pos;				// Position on mRNA
+} ribo_site;
+
+typedef struct
+{	int32_t elng_pos_list;		// Position in the list of elongatable codons
+	uint8_t elng_cod_list;		// The id of the list of elongatable codons
+	uint8_t inhbtr_bound;		// Is the ribosome bound with CHX or Harr?
+} ribo_elng;
+
+typedef struct
+{	ribo_site *site;			// Read by every event
+	ribo_elng *elng;			// Read when a ribosome joins or leaves the lists of elongatable ribosomes
+	double *t_trans_ini;		// Time of translation initiation
+	double *t_elong_ini;		// Time of arrival at current codon
 } ribosome;
 
 typedef struct
@@ -77,7 +177,7 @@ typedef struct
 } transcript;
 
 typedef struct
-{	int seq[MAX_GENE_LEN_ALLW];	// Codon sequence of the gene
+{	uint8_t *seq;				// Codon sequence of the gene (points into the codon buffer shared by all genes)
 	int len;					// Length of the gene
 	int exp;					// Gene expression level
 	double ini_prob;			// Initiation probability of the mRNA
@@ -90,1399 +190,7401 @@ typedef struct
 	double wobble;				// Wobble parmeter
 } trna;
 
+// Compiled genome file (.sgb, see Compile_Genome), mapped into memory as is
+// Header, then one sgb_gene per gene, then the codons of all genes back to back (one byte each).
+// Fields are stored in the byte order of the machine that compiled the file.
+#define SGB_MAGIC "SMOPTSGB"
+#define SGB_VERSION 1
+
+typedef struct
+{	char magic[8];				// SGB_MAGIC
+	uint32_t version;			// SGB_VERSION
+	uint32_t n_genes;			// Number of genes
+	uint64_t n_codons;			// Total number of codons of all genes
+} sgb_header;
+
+typedef struct
+{	double ini_prob;			// Initiation probability
+	int32_t exp;				// Number of mRNAs
+	int32_t len;				// Number of codons
+} sgb_gene;
+
+// Ribosome occupancy of all mRNAs (R_grid): id of the ribosome at each codon of each mRNA, or empty
+// Rows cover the gene's own length plus GRID_PAD codons that are always empty, so the exclusion checks at
+// pos+10 and pos+11 never need a bounds check. The layout is chosen at build time:
+//	default:		one int per codon of each mRNA
+//	-DSPARSE_RGRID:	a bitset of bound codons plus the ribosomes of each mRNA sorted by position
+#define GRID_PAD 12
+
+#ifdef SPARSE_RGRID
+typedef struct
+{	uint64_t *occ;				// Bit p is set if codon p is bound by a ribosome
+	int *pos;					// Positions of the bound ribosomes in increasing order
+	int *id;					// Ids of the bound ribosomes, in the same order
+	int n_ribo;					// Number of bound ribosomes
+	int max_ribo;				// Allocated size of pos and id
+} grid_row;
+#endif
+
+typedef struct
+{	int n_rows;					// Number of mRNAs
+	int empty;					// Value of an empty codon (tot_ribo)
+#ifdef SPARSE_RGRID
+	grid_row *row;
+#else
+	int **row;					// Rows of all mRNAs, laid back to back in cells
+	int *cells;
+#endif
+} ribogrid;
+
+// Summary statistics of one replicate cell
+typedef struct
+{	int seed;					// Seed of the replicate
+	int n_etimes[61];			// Number of elongation events of each codon
+	double etimes[61];			// Average elongation time of each codon
+	int *n_trans;				// Number of translation events of each gene
+	double *g_etimes;			// Average total elongation time of each gene
+	double *g_ini;				// Average time between initiation events of each gene
+	double avg_Rf;				// Average number of free ribosomes
+	double avg_tRNA[61];		// Average number of free tRNAs of each type
+	long leap_events;			// Events of the leaped burn-in (-Tl)
+	long leap_dropped;			// Events of the leaped burn-in dropped as the free tRNAs or ribosomes ran out
+} replicate;
+
+// Replicates waiting to be simulated by a pool of threads
+typedef struct
+{	gene *Gene;					// Shared read-only genome
+	trna *cTRNA;				// Shared read-only tRNA table
+	replicate *Rep;				// Summary statistics of each replicate
+	char *prefix;				// Prefix of the outputs of the replicates
+	int next_rep;				// Next replicate to be simulated
+	pthread_mutex_t lock;		// Guards next_rep
+} replicate_pool;
+
+
+// State of a generator other than MT19937 and its batch of 64-bit numbers not used yet (buf[pos]...buf[RNG_BATCH-1])
+typedef struct
+{	uint64_t xo[4][RNG_LANES];	// xoshiro256++: word w of lane l is xo[w][l]
+	unsigned __int128 pcg;		// PCG64: state and increment
+	unsigned __int128 pcg_inc;
+	uint32_t ph_ctr[4];			// Philox4x32-10: counter of the next block (block, replicate, partition) and key (seed)
+	uint32_t ph_key[2];
+	uint64_t buf[RNG_BATCH];
+	int pos;
+} rng_state;
+
+// Random number generator of a cell
+typedef struct
+{	int type;					// RNG_*
+	gsl_rng *gsl;				// MT19937 itself, or an adapter drawing from st for the distributions of GSL
+	rng_state st;
+} rng;
+
+
+// Binary sum tree over the propensities of reaction channels
+// Leaves are stored at node[size]...node[size+n_leaves-1] and every internal node holds the sum of its two children,
+// so a leaf can be updated and a channel can be picked in O(log n)
+typedef struct
+{	int n_leaves;				// Number of reaction channels
+	int size;					// Power of two >= n_leaves, index of the first leaf
+	double *node;				// node[1] is the root (total propensity)
+} sumtree;
+
+// Reaction channels of the main event loop, in the order in which they were picked by the linear scan
+#define CHN_INI 0					// Translation initiation
+#define CHN_HARR 1					// Harringtonine action on free ribosomes
+#define CHN_CHX_DS 2				// CHX dissociation from bound ribosomes
+#define CHN_ELNG 3					// Elongation of codon c is channel CHN_ELNG+c
+
+// Variants of the event loop, compiled for every combination of the statistics gathered per event and the drugs
+#define RUN_ETIMES 1				// Elongation times of codons (-p1)
+#define RUN_POOLS 2					// Time averages of free ribosomes and tRNAs (-p4)
+#define RUN_STALL 4					// Time averages of stalled ribosomes (-p6)
+#define RUN_SAMPLE 8				// Positions of bound ribosomes every second (-p7, -Tv)
+#define RUN_DRUGS 16				// Cycloheximide or harringtonine
+#ifdef __GNUC__
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
+// Leaped burn-in (-Tl). Leaps expected to hold fewer events than LEAP_MIN_EVENTS are replaced by an exact event
+#define LEAP_MIN_EVENTS 10
+#define N_CHN 64					// Total number of channels
+
+// Composition-rejection table of reaction channels
+// Channels are grouped into bins of propensities within a factor of two, [2^(e-1),2^e).
+// A bin is picked by its summed propensity and a channel within the bin by rejection,
+// which accepts with probability > 1/2 so the cost does not grow with the number of channels
+#define CR_EXP_OFFSET 1100			// Bin of a channel is its binary exponent + CR_EXP_OFFSET
+#define CR_N_BINS 2200				// Covers all exponents of normalized and denormalized doubles
+#define CR_RESUM_PERIOD 1048576		// Number of updates after which bin sums are recomputed to remove round-off drift
+
+typedef struct
+{	int n_leaves;				// Number of reaction channels
+	double *rate;				// Propensity of each channel
+	int *bin;					// Bin of each channel (-1 when its propensity is zero)
+	int *bin_pos;				// Position of each channel in the member list of its bin
+	int **member;				// Channels in each bin
+	int *n_member;				// Number of channels in each bin
+	int *max_member;			// Allocated size of the member list of each bin
+	sumtree bin_tree;			// Summed propensity of each bin
+	int n_updates;				// Updates since the bin sums were last recomputed
+} crtable;
+
+// Indexed priority queue of putative firing times for the next reaction method
+// Every channel stays in the heap; channels with zero propensity never fire (HUGE_VAL) but keep their
+// remaining integrated propensity so that they need no new random number when they become active again
+typedef struct
+{	int n_leaves;				// Number of reaction channels
+	double *rate;				// Propensity of each channel
+	double *tau;				// Absolute putative firing time of each channel
+	double *rem;				// Integrated propensity left until firing, kept while the propensity is zero
+	int *heap;					// Binary min-heap of channels ordered by tau
+	int *heap_pos;				// Position of each channel in the heap
+	double now;					// Time of the last fired event
+} nrmqueue;
+
+// Propensities of a set of reaction channels stored for the selected event selection method
+typedef struct
+{	int engine;					// Event selection method (ENGINE_*)
+	sumtree tree;				// Used by the direct method
+	crtable cr;					// Used by composition-rejection
+	nrmqueue nrm;				// Used by the next reaction method
+} proptable;
+
+// Binary trajectory of ribosome positions (-pt), encoded and written by a background thread
+// Every frame holds the bound codons as offsets into the codons of all mRNAs laid end to end, sorted and stored as
+// variable-length gaps (7 bits per byte), which takes 1-2 bytes per ribosome. See utilities/read.trajectory.pl
+#define TRAJ_MAGIC "SMOPTTRJ"
+#define TRAJ_VERSION 1
+#define TRAJ_QUEUE 4				// Frames that can wait for the writer before the simulation waits
+
+typedef struct
+{	double t;					// Time of the frame
+	int n;						// Number of bound codons
+	uint64_t *pos;				// Offsets of the bound codons
+} traj_frame;
+
+typedef struct
+{	FILE *fh;
+	uint64_t *mRNA_off;			// Offset of the first codon of each mRNA
+	traj_frame frame[TRAJ_QUEUE];	// Ring of frames filled by the simulation
+	int head;					// Next frame to be written
+	int n_queued;				// Frames filled and not yet written
+	int done;					// Set when the simulation has no more frames
+	int failed;					// Set if the file could not be written
+	uint8_t *buf;				// Encoded frame
+	pthread_t thread;
+	pthread_mutex_t lock;		// Guards head, n_queued and done
+	pthread_cond_t cond;
+} traj_writer;
+
+// Seconds between two times of the monotonic clock
+static inline double Clock_Elapsed(struct timespec *t1, struct timespec *t2)
+{	return (double)(t2->tv_sec - t1->tv_sec) + 1e-9*(double)(t2->tv_nsec - t1->tv_nsec);
+}
+
+#if defined(SMOPT_BENCH) || defined(SMOPT_TELEMETRY)
+// Event types counted by the bench and telemetry builds: the reaction channels below CHN_ELNG,
+// elongations and elongations that terminate translation
+#define EV_ELNG 3
+#define EV_TERM 4
+#define EV_TYPES 5
+
+char *ev_names[EV_TYPES] = {"initiation","harringtonine","chx_dissociation","elongation","termination"};
+#endif
+
+#ifdef SMOPT_BENCH
+// Event counts and timings of the bench build. One event in BENCH_SAMPLE+1 is timed.
+#define BENCH_SAMPLE 15
+
+typedef struct
+{	long n_events;						// Events processed
+	long n[EV_TYPES];					// Events of each type
+	long n_timed[EV_TYPES];				// Timed events of each type
+	double ns_timed[EV_TYPES];			// Total time of the timed events of each type (ns)
+	double run_s;						// Wall time spent in Cell_Run
+	double startup_s;					// Wall time from the start of the program to the first event
+} bench_stats;
+#endif
+
+#ifdef SMOPT_TELEMETRY
+// Progress of a cell reported by the telemetry build (-L). Reports are considered every TELEM_CHECK+1 events
+// and written when telem_period wall seconds have passed since the last one.
+#define TELEM_CHECK 65535
+
+typedef struct
+{	long n_events;						// Events processed
+	long n[EV_TYPES];					// Events of each type
+	long n_stall;						// Ribosomes stalled behind another ribosome
+	long n_unstall;						// Stalled ribosomes released
+	long last_events;					// Events, simulated time and wall time at the last report
+	double last_t;
+	struct timespec last_wall;
+	struct timespec start_wall;
+} telem_stats;
+#endif
+
+// Value of a time-averaged counter and the time since which it is held
+// Counters are integrated over time only when they change (Avg_Update) instead of at every event
+typedef struct
+{	int value;
+	double since;
+} lazy_count;
+
+// Parameters and settings of one cell: the values given on the command line, those of a point of a sweep (-S)
+// or those given to the library (smopt.h)
+typedef struct
+{	int tot_ribo;				// Total ribosomes (-R)
+	int tot_tRNA;				// Total tRNAs (-t)
+	double tot_space;			// Volume of the cell (-V) and the space it leaves to tRNAs and ribosomes
+	double avail_space_t;
+	double avail_space_r;
+	double chx_rb_prob;			// Cycloheximide binding probability and dissociation rate (-x1, -x2)
+	double chx_ds_rate;
+	double harr_rf_rate;		// Harringtonine action rate on free ribosomes (-y)
+	double chx_time;			// Times at which cycloheximide and harringtonine are added (-Tc, -Th)
+	double harr_time;
+	int n_genes;				// Number of genes of the genome of the cell
+	double tot_time;			// Total and burn-in time (-Tt, -Tb)
+	double thresh_time;
+	int engine;					// Event selection method (-E)
+	int rng_type;				// Random number generator and seed (-G, -s)
+	int seed;
+	double leap_eps;			// Error control of the leaped burn-in (-Tl)
+	int printOpt[9];			// Statistics gathered (-p1...-p9)
+	char *state_file;			// State the cell starts from (-J), "" for none
+	int *stall_off;				// Positions whose stalls are tracked (-ps), NULL for none
+	int n_stall_pos;
+} cell_par;
+
+// State of one simulated cell
+// Everything the event loop reads or changes is kept here, so a cell can be simulated in pieces (Cell_Run)
+// and saved to or restored from a binary checkpoint (Cell_Checkpoint_IO)
+typedef struct
+{	gene *Gene;					// Shared read-only genome
+	trna cTRNA[61];				// Local copy as the wobble parameters are rescaled
+	cell_par par;				// Parameters of the cell
+	int seed;					// Seed of the cell (seed+replicate+partition, the seed of MT19937)
+	int rep;					// Replicate and partition of the cell, which select its random stream
+	int part;
+	rng *r;
+	ribosome Ribo;
+	transcript *mRNA;
+	ribogrid R_grid;			// The state of the system with respect to mRNAs and bound ribosomes
+	proptable gene_prop;		// Initiation propensity of each gene (number of initiable mRNAs scaled by ini_prob)
+	proptable chn_prop;			// Propensity of each reaction channel (see CHN_*)
+	int tRNA_cod[61][61];		// Codons decoded by each tRNA type
+	int n_tRNA_cod[61];			// Number of codons decoded by each tRNA type
+	int obs_max_len;			// Observed max gene length
+	int obs_max_exp;			// Observed max gene expression
+	int n_mRNA;					// Number of mRNAs (tot_mRNA, or the share of a domain with -D)
+	double pool_scale;			// Free pools of the whole cell over those of the cell (the number of domains with -D)
+	
+	double t;					// Current time
+	int Tf[61];					// Number of free tRNAs of each type
+	int Rf;						// Total number of free ribosomes
+	int Rfh;					// Number of free ribosomes bound by harringtonine
+	int *Mf;					// Number of initiable mRNAs of each gene (first 10 codons unbound by ribosomes)
+	int **free_mRNA;			// Ids of the initiable mRNAs of each gene
+	int **Rb_e;					// Bound ribosomes to each codon that can be elongated
+	int n_Rb_e[61];				// Number of elongable bound ribosomes to each codon
+	int next_avail_ribo;		// Bound ribosomes have the ids 0...next_avail_ribo-1
+	int tot_stall_chx;			// Total number of stalled ribosomes on mRNAs due to cycloheximide
+	int *chx_r_id;				// Ids of the ribosomes stalled by cycloheximide
+	
+	// Accumulated statistics
+	int n_e_times[61];			// Number of times a codon type is elongated
+	double e_times[61];
+	int *num_waste_ribo;		// Number of stalled ribosomes on mRNAs of each gene
+	int *num_waste_ribo_pos;	// Number of stalled ribosomes by codon position on mRNAs of the first gene
+	double *time_waste_ribo;	// Total time spent by stalled ribosomes on mRNAs of each gene
+	double *time_waste_ribo_pos;	// Total time spent by stalled ribosomes at each codon position on mRNAs of the first gene
+	int *num_stall_chx;			// Number of stalled ribosomes on mRNAs of each gene due to cycloheximide
+	double avg_tRNA_abndc[61];	// Average number of free tRNAs of each type (averaged by time)
+	double avg_Rf;				// Average number of free ribosomes (averaged by time)
+	int avg_started;			// Set once the time averages have started (first event after thresh_time)
+	lazy_count Tf_held[61];		// Free tRNAs, free ribosomes and stalled ribosomes as last added to the time averages
+	lazy_count Rf_held;
+	lazy_count *waste_held;
+	lazy_count *waste_pos_held;
+	lazy_count *stall_held;		// Stalled ribosomes at each tracked position of all mRNAs of its gene (-ps)
+	double *stall_time;			// Total time spent by stalled ribosomes at each tracked position (-ps)
+	int t_print;				// Next time at which ribosome positions are sampled for -p7
+	long events_left;			// Events left before Cell_Run returns (steps of the library, smopt_step), 0: no limit
+	int *leap_order;			// Bound ribosomes by mRNA, front first, and the first of each mRNA in leap_order (-Tl)
+	int *leap_first;
+	int *leap_stall;			// Position of each ribosome of leap_order if stalled at the start of the leap, else -1
+	uint8_t *leap_ini;			// Initiable mRNAs during a leap
+	double *leap_s[2];			// Times and positions of the moves of a ribosome and of the one ahead of it during a leap
+	int *leap_p[2];
+	long leap_n;				// Leaps, leaped events and leaped events dropped as the free tRNAs or ribosomes ran out
+	long leap_events;
+	long leap_dropped;
+	int **gene_sp_ribo_500;		// Sampled ribosome positions on each gene (-p7)
+	traj_writer *traj;			// Trajectory of ribosome positions (-pt), NULL if not written
+#ifdef SMOPT_BENCH
+	bench_stats bench;
+#endif
+#ifdef SMOPT_TELEMETRY
+	telem_stats telem;
+#endif
+} cell;
+
+// Domains of a single cell simulated by their own threads (-D)
+// The main thread sets the end of the next synchronization window and starts it by increasing window
+typedef struct
+{	cell *C;					// The domains
+	gene **Gene;				// Genome of each domain: the shared sequences with its share of the mRNAs of each gene
+	int n;						// Number of domains
+	double t_sync;				// End of the current window, < 0 when the simulation is over
+	long window;				// Number of the current window
+	int n_done;					// Domains that reached the end of the current window
+	int next_id;				// Next domain to be taken by a thread
+	pthread_mutex_t lock;		// Guards t_sync, window, n_done and next_id
+	pthread_cond_t go;
+	pthread_cond_t done;
+} domain_set;
+
+// Points of a parameter sweep (-S) simulated by a pool of threads
+// Points with the same -R, -t and -V form a group sharing one burn-in, simulated up to the first time at which
+// a drug of any point of the group acts (t_fork) and kept in memory as a checkpoint that all its points start from
+typedef struct
+{	cell_par par;				// Parameters of the point
+	int group;					// Group of the point
+	int started;				// Set once a thread has taken the point
+	double free_ribo;			// Summary of the point: average free ribosomes, elongation events,
+	long n_elng;				// average elongation time and ribosomes stalled by cycloheximide at the end
+	double etime;
+	int n_chx;
+} sweep_point;
+
+typedef struct
+{	cell_par par;				// Parameters of the shared burn-in (those of the first point without drugs)
+	double t_fork;				// Time at which the points of the group fork from the burn-in
+	int status;					// 0: burn-in not started, 1: being simulated, 2: state ready
+	int n_left;					// Points of the group not yet simulated
+	char *state;				// Checkpoint of the cell at t_fork
+	size_t size;
+} sweep_group;
+
+typedef struct
+{	gene *Gene;					// Shared read-only genome
+	trna *cTRNA;				// Shared read-only tRNA table
+	sweep_point *pt;			// Points in the order of the index (-R, -t and -V change slowest)
+	int n_pt;
+	sweep_group *grp;
+	int n_grp;
+	int n_started;				// Points taken by a thread
+	int next_grp;				// Next group whose burn-in is to be simulated
+	pthread_mutex_t lock;		// Guards started, status, n_left, state, n_started and next_grp
+	pthread_cond_t ready;		// Signalled when the state of a group is ready
+} sweep_set;
+
+// Job server (-W): genomes, tRNA tables and snapshots of cells are kept in memory across jobs
+// Jobs from all connections wait in one queue and are simulated by a pool of threads
+typedef struct server_genome
+{	char genome_file[150];		// Files and number of genes the genome was read from
+	char code_file[150];
+	int n_genes;
+	gene *Gene;
+	uint8_t *codon_buf;
+	size_t map_size;
+	trna cTRNA[61];
+	struct server_genome *next;
+} server_genome;
+
+typedef struct server_snapshot
+{	char name[64];
+	server_genome *genome;		// The state fits cells of this genome with the same ribosomes, engine and generator
+	int tot_ribo;
+	int engine;
+	int rng_type;
+	int avg_pools;				// Time averages kept by the state (p4, p6)
+	int avg_stall;
+	double t;					// Time of the cell
+	char *state;				// Checkpoint of the cell, NULL until saved
+	size_t size;
+	int n_queued;				// Jobs queued so far that save to the snapshot, and those of them done
+	int n_saved;
+	struct server_snapshot *next;
+} server_snapshot;
+
+typedef struct
+{	int fd;						// Socket of the client
+	int n_left;					// Jobs of the connection not yet answered
+	pthread_mutex_t lock;		// Guards n_left and writes to fd
+	pthread_cond_t done;		// Signalled when a job of the connection is answered
+	struct job_server *server;
+} server_conn;
+
+typedef struct server_job
+{	int id;						// Number of the job in its connection, from 0
+	cell_par par;
+	int stream;
+	server_genome *genome;
+	char resume[64];			// Snapshot the job starts from, "" for a new cell
+	int n_wait;					// Saves of that snapshot by earlier jobs that must be done first
+	int reseed;					// Draw from the job's own stream after resuming (s or Gs given)
+	char save[64];				// Snapshot the job's final state is kept as, "" for none
+	char prefix[150];			// Prefix of the output files, "" for none
+	server_conn *conn;
+	struct server_job *next;
+} server_job;
+
+typedef struct job_server
+{	server_genome *genome;		// Genomes read so far
+	server_snapshot *snap;		// Snapshots kept so far
+	server_job *head;			// Jobs waiting for a thread
+	server_job *tail;
+	pthread_mutex_t lock;		// Guards genome, snap, head and tail
+	pthread_cond_t ready;		// Signalled when a job is queued
+	pthread_cond_t saved;		// Signalled when a snapshot is saved
+} job_server;
+
+// Binary checkpoints (-K, -k)
+#define CKPT_MAGIC "SMOPTCKP"
+#define CKPT_VERSION 5				// Increase whenever the layout written by Cell_Checkpoint_IO changes
+
+// Result cache (-Oc), keyed by SHA-256
+#define CACHE_VERSION 1				// Increase whenever the key or the layout of the entries changes
+
+typedef struct
+{	uint32_t h[8];				// State of the hash
+	uint8_t buf[64];			// Bytes of the current block
+	uint64_t len;				// Bytes hashed so far
+} sha256;
+
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
-// Reading the processed sequence file
-int Read_FASTA_File(char *filename, gene *Gene)
-{	FILE *fh;
-	int c1=0,c2=0;
-	char curr_char;
+// Next output of splitmix64, used to expand a seed into the state of a generator
+uint64_t Split_Mix(uint64_t *x)
+{	uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
 	
-	fh=fopen(filename, "r");
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
 
-	if(!fh)					// Check if file exists
-	{	printf("\nModified FASTA/Sequence File Doesn't Exist\n");
-		fflush(stdout);
-		Help_out();
-		exit(1);
+static inline uint64_t Rotl(uint64_t x, int k)
+{	return (x << k) | (x >> (64 - k));
+}
+
+// Fill the batch of a generator. Each lane of xoshiro256++ and each Philox block is independent of the others,
+// so the inner loops have no dependencies between iterations.
+void Rng_Fill(rng *R)
+{	int c1, c2, c3;
+	rng_state *S = &R->st;
+	
+	if(R->type == RNG_XOSHIRO)
+	{	uint64_t (*xo)[RNG_LANES] = S->xo;
+		uint64_t t;
+		
+		for(c1=0;c1<RNG_BATCH;c1+=RNG_LANES)
+		{	for(c2=0;c2<RNG_LANES;c2++)
+			{	S->buf[c1+c2] = Rotl(xo[0][c2] + xo[3][c2], 23) + xo[0][c2];
+				t = xo[1][c2] << 17;
+				xo[2][c2] ^= xo[0][c2];
+				xo[3][c2] ^= xo[1][c2];
+				xo[1][c2] ^= xo[2][c2];
+				xo[0][c2] ^= xo[3][c2];
+				xo[2][c2] ^= t;
+				xo[3][c2] = Rotl(xo[3][c2], 45);
+			}
+		}
+	}
+	else if(R->type == RNG_PCG64)
+	{	const unsigned __int128 mult = ((unsigned __int128)0x2360ED051FC65DA4ULL << 64) | 0x4385DF649FCCF645ULL;
+		uint64_t x;
+		int rot;
+		
+		for(c1=0;c1<RNG_BATCH;c1++)
+		{	S->pcg = S->pcg * mult + S->pcg_inc;
+			x = (uint64_t)(S->pcg >> 64) ^ (uint64_t)S->pcg;
+			rot = (int)(S->pcg >> 122);
+			S->buf[c1] = (x >> rot) | (x << ((-rot) & 63));
+		}
+	}
+	else
+	{	uint32_t c[RNG_BATCH/2][4];
+		uint32_t k0, k1, hi0, lo0, hi1, lo1;
+		uint64_t p0, p1;
+		
+		// Counters of the blocks of the batch. Only the block number (the two lowest words) is incremented.
+		for(c1=0;c1<RNG_BATCH/2;c1++)
+		{	memcpy(c[c1], S->ph_ctr, sizeof(S->ph_ctr));
+			if(++S->ph_ctr[0] == 0)
+			{	S->ph_ctr[1]++;
+			}
+		}
+		k0 = S->ph_key[0];
+		k1 = S->ph_key[1];
+		for(c3=0;c3<10;c3++)
+		{	for(c1=0;c1<RNG_BATCH/2;c1++)
+			{	p0 = (uint64_t)0xD2511F53U * c[c1][0];
+				p1 = (uint64_t)0xCD9E8D57U * c[c1][2];
+				hi0 = (uint32_t)(p0 >> 32);
+				lo0 = (uint32_t)p0;
+				hi1 = (uint32_t)(p1 >> 32);
+				lo1 = (uint32_t)p1;
+				c[c1][0] = hi1 ^ c[c1][1] ^ k0;
+				c[c1][1] = lo1;
+				c[c1][2] = hi0 ^ c[c1][3] ^ k1;
+				c[c1][3] = lo0;
+			}
+			k0 += 0x9E3779B9U;
+			k1 += 0xBB67AE85U;
+		}
+		for(c1=0;c1<RNG_BATCH/2;c1++)
+		{	S->buf[2*c1] = ((uint64_t)c[c1][1] << 32) | c[c1][0];
+			S->buf[2*c1+1] = ((uint64_t)c[c1][3] << 32) | c[c1][2];
+		}
 	}
+	S->pos = 0;
+}
 
-	fscanf(fh,"%lf",&Gene[c1].ini_prob);
+static inline uint64_t Rng_Next(rng *R)
+{	if(R->st.pos == RNG_BATCH)
+	{	Rng_Fill(R);
+	}
+	return R->st.buf[R->st.pos++];
+}
 
-	do
-	{	fscanf(fh,"%d",&Gene[c1].exp);
-		
-		c2 = 0;
-		do
-		{	fscanf(fh,"%d",&Gene[c1].seq[c2]);
-			c2++;
-			curr_char = fgetc(fh);
-		}while(curr_char != '\n');
-		Gene[c1].len = c2;
+// Uniform in [0,1)
+static inline double Rng_Uniform(rng *R)
+{	if(R->type == RNG_MT19937)
+	{	return gsl_rng_uniform(R->gsl);
+	}
+	return (double)(Rng_Next(R) >> 11) * 0x1.0p-53;
+}
 
-		c1++;
-	}while(fscanf(fh,"%lf",&Gene[c1].ini_prob) ==1);
+// Uniform in (0,1)
+static inline double Rng_Uniform_Pos(rng *R)
+{	if(R->type == RNG_MT19937)
+	{	return gsl_rng_uniform_pos(R->gsl);
+	}
+	return ((double)(Rng_Next(R) >> 11) + 0.5) * 0x1.0p-53;
+}
+
+// Uniform integer in 0...n-1, n > 0. Lemire's multiply and shift, which needs a division only for the rare
+// numbers that would bias the result.
+static inline unsigned long Rng_Uniform_Int(rng *R, unsigned long n)
+{	unsigned __int128 m;
+	uint64_t l, t;
+	
+	if(R->type == RNG_MT19937)
+	{	return gsl_rng_uniform_int(R->gsl, n);
+	}
+	m = (unsigned __int128)Rng_Next(R) * n;
+	l = (uint64_t)m;
+	if(l < n)
+	{	t = -(uint64_t)n % n;
+		while(l < t)
+		{	m = (unsigned __int128)Rng_Next(R) * n;
+			l = (uint64_t)m;
+		}
+	}
+	return (unsigned long)(m >> 64);
 }
 
+// The other generators seen by GSL, for its distributions (gsl_ran_poisson of the leaps). The state of the
+// adapter is a pointer to the generator.
+void Rng_Gsl_Set(void *state, unsigned long s)
+{	
+}
 
+unsigned long Rng_Gsl_Get(void *state)
+{	return (unsigned long)(Rng_Next(*(rng **)state) >> 32);
+}
 
-// Read in tRNA file
-int Read_tRNA_File(char *filename, trna *cTRNA)
-{	FILE *fh;
-	int c1=0,c2=0;
-	char curr_char;
+double Rng_Gsl_Get_Double(void *state)
+{	return Rng_Uniform(*(rng **)state);
+}
+
+const gsl_rng_type rng_gsl_adapter = {"smopt", 0xFFFFFFFFUL, 0, sizeof(rng *), &Rng_Gsl_Set, &Rng_Gsl_Get, &Rng_Gsl_Get_Double};
+
+const char *Rng_Name(rng *R)
+{	const char *name[4] = {"mt19937","xoshiro256++","pcg64","philox4x32-10"};
 	
-	fh=fopen(filename, "r");
+	return name[R->type];
+}
+
+// Start a generator at the beginning of the stream of a replicate and a partition for a seed
+void Rng_Set(rng *R, unsigned long seed, int rep, int part)
+{	int c1, c2;
+	uint64_t x = seed;
+	rng_state *S = &R->st;
 	
-	if(!fh)					// Check if file exists
-	{	printf("\ntRNA File Doesn't Exist\n");
-		fflush(stdout);
-		Help_out();
-		exit(1);
+	if(R->type == RNG_MT19937)
+	{	gsl_rng_set(R->gsl, seed+rep+part);
+		return;
 	}
-	c1 = 0;
-	c2 = 0;
-	while(fscanf(fh,"%s",&cTRNA[c1].codon)==1)
-	{	fscanf(fh,"%d%d%lf",&cTRNA[c1].tid,&cTRNA[c1].gcn,&cTRNA[c1].wobble);
-		c1++;
+	memset(S, 0, sizeof(rng_state));
+	x = Split_Mix(&x) ^ (((uint64_t)(uint32_t)rep << 32) | (uint32_t)part);
+	if(R->type == RNG_XOSHIRO)
+	{	for(c1=0;c1<RNG_LANES;c1++)
+		{	for(c2=0;c2<4;c2++)
+			{	S->xo[c2][c1] = Split_Mix(&x);
+			}
+		}
+	}
+	else if(R->type == RNG_PCG64)
+	{	S->pcg_inc = ((((unsigned __int128)Split_Mix(&x) << 64) | Split_Mix(&x)) << 1) | 1;
+		S->pcg = (((unsigned __int128)Split_Mix(&x) << 64) | Split_Mix(&x)) + S->pcg_inc;
+	}
+	else
+	{	S->ph_key[0] = (uint32_t)seed;
+		S->ph_key[1] = (uint32_t)((uint64_t)seed >> 32);
+		S->ph_ctr[2] = (uint32_t)rep;
+		S->ph_ctr[3] = (uint32_t)part;
+	}
+	S->pos = RNG_BATCH;
+}
+
+// Returns NULL if out of memory
+rng *Rng_Alloc(int type, unsigned long seed, int rep, int part)
+{	rng *R = (rng *)malloc(sizeof(rng));
+	
+	if(R == NULL)
+	{	return NULL;
+	}
+	R->type = type;
+	R->gsl = gsl_rng_alloc((type == RNG_MT19937) ? gsl_rng_mt19937 : &rng_gsl_adapter);
+	if(R->gsl == NULL)
+	{	free(R);
+		return NULL;
 	}
+	if(type != RNG_MT19937)
+	{	*(rng **)R->gsl->state = R;
+	}
+	Rng_Set(R, seed, rep, part);
+	return R;
 }
 
+void Rng_Free(rng *R)
+{	gsl_rng_free(R->gsl);
+	free(R);
+}
 
 
-// Reading the state of the system
-int Read_STATE_File(char *filename, int **R_grid)
-{	FILE *fh;
-	int c1=0,c2=0;
-	char curr_char;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Allocate a sum tree with all propensities set to zero. Returns 0 if out of memory.
+int Sum_Tree_Init(sumtree *tree, int n_leaves)
+{	tree->n_leaves = n_leaves;
+	tree->size = 1;
+	while(tree->size < n_leaves)
+	{	tree->size *= 2;
+	}
 	
-	fh=fopen(filename, "r");
+	tree->node = (double *)calloc(2*tree->size, sizeof(double));
+	return tree->node != NULL;
+}
+
+// Set the propensity of a channel and update the partial sums on the path to the root
+// Parents are recomputed from their children rather than incremented to avoid accumulating round-off errors
+void Sum_Tree_Set(sumtree *tree, int leaf, double value)
+{	int i = tree->size + leaf;
 	
-	if(!fh)					// Check if file exists
-	{	printf("\nState File Doesn't Exist\n");
-		fflush(stdout);
-		Help_out();
-		exit(1);
+	tree->node[i] = value;
+	for(i/=2;i>0;i/=2)
+	{	tree->node[i] = tree->node[2*i] + tree->node[2*i+1];
 	}
+}
+
+// Total propensity of all channels
+double Sum_Tree_Total(sumtree *tree)
+{	return tree->node[1];
+}
+
+// Find the channel whose cumulative propensity interval contains target (0 <= target < total)
+// Empty subtrees are never entered so that round-off at the upper edge cannot pick a channel with zero propensity
+int Sum_Tree_Find(sumtree *tree, double target)
+{	int i = 1;
 	
-	c1 = 0;
-	c2 = -1;
+	while(i < tree->size)
+	{	if(target < tree->node[2*i] || tree->node[2*i+1] <= 0.0)
+		{	i = 2*i;
+		}
+		else
+		{	target -= tree->node[2*i];
+			i = 2*i+1;
+		}
+	}
+	return i - tree->size;
+}
+
+// Propensity of a channel
+double Sum_Tree_Get(sumtree *tree, int leaf)
+{	return tree->node[tree->size + leaf];
+}
+
+void Sum_Tree_Free(sumtree *tree)
+{	free(tree->node);
+}
+
+
+
+// Allocate a composition-rejection table with all propensities set to zero. Returns 0 if out of memory.
+int CR_Init(crtable *cr, int n_leaves)
+{	int c1;
+	
+	cr->n_leaves = n_leaves;
+	cr->n_updates = 0;
+	cr->rate = (double *)malloc(sizeof(double) * n_leaves);
+	cr->bin = (int *)malloc(sizeof(int) * n_leaves);
+	cr->bin_pos = (int *)malloc(sizeof(int) * n_leaves);
+	cr->member = (int **)calloc(CR_N_BINS, sizeof(int *));
+	cr->n_member = (int *)calloc(CR_N_BINS, sizeof(int));
+	cr->max_member = (int *)calloc(CR_N_BINS, sizeof(int));
+	cr->bin_tree.node = NULL;
+	if(cr->rate == NULL || cr->bin == NULL || cr->bin_pos == NULL || cr->member == NULL || cr->n_member == NULL || cr->max_member == NULL)
+	{	return 0;
+	}
+	
+	for(c1=0;c1<n_leaves;c1++)
+	{	cr->rate[c1] = 0.0;
+		cr->bin[c1] = -1;
+	}
+	return Sum_Tree_Init(&cr->bin_tree, CR_N_BINS);
+}
+
+// Take a channel out of its bin
+void CR_Remove(crtable *cr, int leaf)
+{	int b = cr->bin[leaf];
+	int last;
+	
+	cr->n_member[b]--;
+	if(cr->bin_pos[leaf] != cr->n_member[b])
+	{	last = cr->member[b][cr->n_member[b]];				// Move the last member into the freed slot
+		cr->member[b][cr->bin_pos[leaf]] = last;
+		cr->bin_pos[last] = cr->bin_pos[leaf];
+	}
+	
+	if(cr->n_member[b] == 0)
+	{	Sum_Tree_Set(&cr->bin_tree, b, 0.0);				// Empty bins are exactly zero so they are never picked
+	}
+	else
+	{	Sum_Tree_Set(&cr->bin_tree, b, Sum_Tree_Get(&cr->bin_tree, b) - cr->rate[leaf]);
+	}
+	cr->bin[leaf] = -1;
+}
+
+// Put a channel with a positive propensity into the bin of its binary exponent
+void CR_Insert(crtable *cr, int leaf, double value)
+{	int b, e;
+	
+	frexp(value, &e);
+	b = e + CR_EXP_OFFSET;
+	
+	if(cr->n_member[b] == cr->max_member[b])
+	{	cr->max_member[b] = (cr->max_member[b] == 0) ? 16 : 2*cr->max_member[b];
+		cr->member[b] = (int *)realloc(cr->member[b], sizeof(int) * cr->max_member[b]);
+		if(cr->member[b] == NULL)
+		{	printf("Too many reaction channels\nOut of memory\n");fflush(stdout);
+			exit(1);
+		}
+	}
+	cr->member[b][cr->n_member[b]] = leaf;
+	cr->bin_pos[leaf] = cr->n_member[b];
+	cr->n_member[b]++;
+	cr->bin[leaf] = b;
+	
+	Sum_Tree_Set(&cr->bin_tree, b, Sum_Tree_Get(&cr->bin_tree, b) + value);
+}
+
+// Recompute the summed propensity of every bin from its members
+void CR_Resum(crtable *cr)
+{	int b, c1;
+	double sum;
+	
+	for(b=0;b<CR_N_BINS;b++)
+	{	if(cr->n_member[b] > 0)
+		{	sum = 0.0;
+			for(c1=0;c1<cr->n_member[b];c1++)
+			{	sum += cr->rate[cr->member[b][c1]];
+			}
+			Sum_Tree_Set(&cr->bin_tree, b, sum);
+		}
+	}
+	cr->n_updates = 0;
+}
+
+// Set the propensity of a channel, moving it to another bin if needed
+void CR_Set(crtable *cr, int leaf, double value)
+{	int e;
+	
+	if(cr->bin[leaf] >= 0 && value > 0.0 && (frexp(value, &e), e + CR_EXP_OFFSET) == cr->bin[leaf])
+	{	Sum_Tree_Set(&cr->bin_tree, cr->bin[leaf], Sum_Tree_Get(&cr->bin_tree, cr->bin[leaf]) + value - cr->rate[leaf]);
+	}
+	else
+	{	if(cr->bin[leaf] >= 0)
+		{	CR_Remove(cr, leaf);
+		}
+		if(value > 0.0)
+		{	CR_Insert(cr, leaf, value);
+		}
+	}
+	cr->rate[leaf] = value;
+	
+	cr->n_updates++;
+	if(cr->n_updates >= CR_RESUM_PERIOD)
+	{	CR_Resum(cr);
+	}
+}
+
+// Pick a bin by its summed propensity, then a channel within the bin by rejection against the bin's upper bound
+int CR_Pick(crtable *cr, rng *r)
+{	int b, leaf;
+	double bound;
+	
+	b = Sum_Tree_Find(&cr->bin_tree, Rng_Uniform(r)*Sum_Tree_Total(&cr->bin_tree));
+	bound = ldexp(1.0, b - CR_EXP_OFFSET);
 	do
-	{	c2++;
-		do
-		{	fscanf(fh,"%d",&R_grid[c1][c2]);
-			c2++;
-			curr_char = fgetc(fh);
-		}while(curr_char != '\n');
-		c1++;
-		c2 = 0;
-	}while(fscanf(fh,"%d",&R_grid[c1][c2]) ==1);
+	{	leaf = cr->member[b][Rng_Uniform_Int(r, (unsigned long)cr->n_member[b])];
+	}while(Rng_Uniform(r)*bound >= cr->rate[leaf]);
+	
+	return leaf;
 }
 
+void CR_Free(crtable *cr)
+{	int b;
+	
+	for(b=0;b<CR_N_BINS && cr->member!=NULL;b++)
+	{	free(cr->member[b]);
+	}
+	free(cr->member);
+	free(cr->n_member);
+	free(cr->max_member);
+	free(cr->rate);
+	free(cr->bin);
+	free(cr->bin_pos);
+	Sum_Tree_Free(&cr->bin_tree);
+}
 
-// Help output
-int Help_out()
-{	printf("\nUsage:\n");
-	printf("\t./bin/SMoPT [options]\n\n");
-	printf("Options:\n");
-	printf("\n\t-V <value>	Volume of the cell in m^3/s. The minimum volume of the cell is set to\n");
-	printf("\t\t\tcontain at least 1000 ribosomes and tRNAs.\n");
-	printf("\t\t\t[DEFAULT]  -V 4.2E-17 (volume of yeast cell)\n");
-	printf("\n");
-	printf("\t-T[CHAR]	Specify times for various events\n");
-	printf("\n");
-	printf("\t\t\t-Tt:	Total simulation time in seconds.\n");
-	printf("\t\t\t	[DEFAULT]  -Tt 1500\n");
-	printf("\n");
-	printf("\t\t\t-Tb:	Burn-in/threshold time. Time spent by the cell to reach equilibrium.\n");
-	printf("\t\t\t	Only calculations after this time will be included in the analyses.\n");
-	printf("\t\t\t	[DEFAULT]  -Tb 1000\n");
-	printf("\n");
-	printf("\t\t\t-Th:	Time at which harringtonine is added to the cell.\n");
-	printf("\t\t\t	[DEFAULT]  -Th 1500\n");
-	printf("\n");
-	printf("\t\t\t-Tc:	Time at which cycloheximide is added to the cell.\n");
-	printf("\t\t\t	[DEFAULT]  -Tc 1500\n");
-	printf("\n");	
-	printf("\t-R <value>	Total number of ribosomes in the cell.\n");
-	printf("\t\t\t[DEFAULT]  -R 200000\n");
-	printf("\n");
-	printf("\t-t <value>	Total number of tRNAs in the cell.\n");
-	printf("\t\t\t[DEFAULT]  -t 3300000\n");
-	printf("\n");
-	printf("\t-N <value>	Total number of genes. This needs to be specified by the user.\n");
-	printf("\t\t\t[DEFAULT]  -N 1\n");
-	printf("\n");
-	printf("\t-F <FILE>	File containing processed fasta file into a numeric sequence.\n");
-	printf("\t\t\tThis file is an output of the code utilities/convert.fasta.to.genom.pl\n");
-	printf("\t\t\tIt contains the information regarding initiation probability, mRNA\n");
-	printf("\t\t\tabundance and codon sequence of each gene.\n");
-	printf("\t\t\t[DEFAULT]  -F example/input/S.cer.genom\n");
-	printf("\n");
-	printf("\t-C <FILE>	File containing the information about codon, tRNA, tRNA abundance and wobble.\n");
-	printf("\t\t\tThis file is an output of the code utilities/create.Scer.cod.anticod.numeric.pl\n");
-	printf("\t\t\t[DEFAULT]  -C example/input/S.cer.tRNA\n");
-	printf("\n");
-	printf("\t-J <FILE>	File containing the initial state of the system to begin simulations from.\n");
-	printf("\t\t\tThis file is an output of this simulation code containing '*_ribo_pos_*'\n");
-	printf("\t\t\t[DEFAULT]  -C example/input/output_final_ribo_pos.out\n");
-	printf("\n");
-	printf("\t-x[INTEGER]	Specify parameters for cycloheximide action\n");
-	printf("\n");
-	printf("\t\t\t-x1:	Probability of cycloheximide binding ribosomes\n");
-	printf("\t\t\t	[DEFAULT]  -x1 0\n");
-	printf("\n");
-	printf("\t\t\t-x2:	Rate of cycloheximide dissociation from bound ribosomes\n");
-	printf("\t\t\t	[DEFAULT]  -x2 0 (irreversible binding)\n");
-	printf("\n");
-	printf("\t-y <value>	Harringtonine rate for free ribosomes. This needs to be specified by the user.\n");
-	printf("\t\t\t[DEFAULT]  -y 0\n");
-	printf("\n");
-	printf("\t-s <value>	Random number seed. *MUST SETUP*\n");
-	printf("\t\t\t[DEFAULT]  -s 1\n");
-	printf("\n");
-	printf("\t-O <prefix>	Specifies the prefix for the output files.\n");
-	printf("\t\t\t[DEFAULT]  -O output\n");
-	printf("\n");
-	printf("\n");
-	printf("\t-p[INTEGER]	Specify which output files to print\n");
-	printf("\n");
-	printf("\t\t\t-p1:	Generates a file of average elongation times\n");
-	printf("\t\t\t	of all codons.\n");
-	printf("\n");
-	printf("\t\t\t-p2:	Generates a file of total average elongation\n");
-	printf("\t\t\t	time of each gene.\n");
-	printf("\n");
-	printf("\t\t\t-p3:	Generates a file of average time between initiation\n");
-	printf("\t\t\t	events on mRNAs of each gene.\n");
-	printf("\n");
-	printf("\t\t\t-p4:	Generates a file of average number of free ribosomes,\n");
-	printf("\t\t\t	and free tRNAs of each type.\n");
-	printf("\n");
-	printf("\t\t\t-p5:	Generates a file of the final state of all mRNAs in a cell.\n");
-	printf("\t\t\t	It contains the poistions of all bound ribosomes on mRNAs.\n");
-	printf("\n");
-	printf("\t\t\t-p6:	This generates two files:\n");
-	printf("\t\t\t	A file containing the amount of time wasted by stalled\n");
-	printf("\t\t\t	ribosomes on mRNAs of each gene.\n");
-	printf("\t\t\t	A file containing the time wasted by stalled ribosomes\n");
-	printf("\t\t\t	on each codon position of Gene 0 (first gene in the\n");
-	printf("\t\t\t	processed fasta file).\n");
-	printf("\t\t\t	This option significantly increases the total running time\n");
-	printf("\t\t\t	of the simulation. Use it with caution.\n");
-	printf("\n");
-	printf("\t\t\t-p7:	Generates a file of state of all mRNAs in a cell every second.\n");
-	printf("\t\t\t	This is similar to -p5 printed every second.\n");
-	printf("\t\t\t	This option significantly increases the total running time\n");
-	printf("\t\t\t	of the simulation. Use it with caution.\n");
+
+
+// Swap two entries of the heap
+void NRM_Swap(nrmqueue *q, int i, int j)
+{	int tmp = q->heap[i];
+	
+	q->heap[i] = q->heap[j];
+	q->heap[j] = tmp;
+	q->heap_pos[q->heap[i]] = i;
+	q->heap_pos[q->heap[j]] = j;
+}
+
+// Restore the heap order after the firing time of a channel changed
+void NRM_Update(nrmqueue *q, int leaf)
+{	int i = q->heap_pos[leaf];
+	int c;
+	
+	while(i > 0 && q->tau[q->heap[(i-1)/2]] > q->tau[q->heap[i]])		// Sift up
+	{	NRM_Swap(q, i, (i-1)/2);
+		i = (i-1)/2;
+	}
+	while(2*i+1 < q->n_leaves)											// Sift down
+	{	c = 2*i+1;
+		if(c+1 < q->n_leaves && q->tau[q->heap[c+1]] < q->tau[q->heap[c]])
+		{	c++;
+		}
+		if(q->tau[q->heap[c]] >= q->tau[q->heap[i]])
+		{	break;
+		}
+		NRM_Swap(q, i, c);
+		i = c;
+	}
+}
+
+// Allocate the queue with all propensities set to zero and draw the first unit exponential of every channel
+// Returns 0 if out of memory.
+int NRM_Init(nrmqueue *q, int n_leaves, rng *r)
+{	int c1;
+	
+	q->n_leaves = n_leaves;
+	q->now = 0.0;
+	q->rate = (double *)malloc(sizeof(double) * n_leaves);
+	q->tau = (double *)malloc(sizeof(double) * n_leaves);
+	q->rem = (double *)malloc(sizeof(double) * n_leaves);
+	q->heap = (int *)malloc(sizeof(int) * n_leaves);
+	q->heap_pos = (int *)malloc(sizeof(int) * n_leaves);
+	if(q->rate == NULL || q->tau == NULL || q->rem == NULL || q->heap == NULL || q->heap_pos == NULL)
+	{	return 0;
+	}
+	
+	for(c1=0;c1<n_leaves;c1++)
+	{	q->rate[c1] = 0.0;
+		q->tau[c1] = HUGE_VAL;
+		q->rem[c1] = -log(Rng_Uniform_Pos(r));
+		q->heap[c1] = c1;
+		q->heap_pos[c1] = c1;
+	}
+	return 1;
+}
+
+// Set the propensity of a channel and rescale its putative firing time (Gibson and Bruck, 2000)
+void NRM_Set(nrmqueue *q, int leaf, double value)
+{	double old = q->rate[leaf];
+	
+	if(old > 0.0 && value > 0.0)
+	{	q->tau[leaf] = q->now + (old/value)*(q->tau[leaf] - q->now);
+	}
+	else if(old > 0.0)
+	{	q->rem[leaf] = old*(q->tau[leaf] - q->now);						// Channel switched off, keep what is left
+		q->tau[leaf] = HUGE_VAL;
+	}
+	else if(value > 0.0)
+	{	q->tau[leaf] = q->now + q->rem[leaf]/value;						// Channel switched on again
+	}
+	q->rate[leaf] = value;
+	NRM_Update(q, leaf);
+}
+
+// Time until the channel at the top of the heap fires, or a negative value if no channel can fire
+double NRM_Wait(nrmqueue *q)
+{	if(q->tau[q->heap[0]] == HUGE_VAL)
+	{	return -1.0;
+	}
+	return q->tau[q->heap[0]] - q->now;
+}
+
+// Fire the channel at the top of the heap and draw its next firing time
+// This is the only random number needed to schedule the event
+int NRM_Pick(nrmqueue *q, rng *r)
+{	int leaf = q->heap[0];
+	
+	q->now = q->tau[leaf];
+	q->tau[leaf] = q->now - log(Rng_Uniform_Pos(r))/q->rate[leaf];
+	NRM_Update(q, leaf);
+	
+	return leaf;
+}
+
+// Total propensity of all channels (only used for reporting, O(n))
+double NRM_Total(nrmqueue *q)
+{	int c1;
+	double sum = 0.0;
+	
+	for(c1=0;c1<q->n_leaves;c1++)
+	{	sum += q->rate[c1];
+	}
+	return sum;
+}
+
+void NRM_Free(nrmqueue *q)
+{	free(q->rate);
+	free(q->tau);
+	free(q->rem);
+	free(q->heap);
+	free(q->heap_pos);
+}
+
+
+
+// Allocate the propensity table of a set of channels for the given event selection method
+// Returns 0 if out of memory; the table can then still be freed.
+int Prop_Table_Init(proptable *prop, int n_leaves, int engine, rng *r)
+{	prop->engine = engine;
+	if(engine == ENGINE_CR)
+	{	return CR_Init(&prop->cr, n_leaves);
+	}
+	else if(engine == ENGINE_NRM)
+	{	return NRM_Init(&prop->nrm, n_leaves, r);
+	}
+	return Sum_Tree_Init(&prop->tree, n_leaves);
+}
+
+// Propensity of a channel
+double Prop_Table_Get(proptable *prop, int leaf)
+{	if(prop->engine == ENGINE_CR)
+	{	return prop->cr.rate[leaf];
+	}
+	else if(prop->engine == ENGINE_NRM)
+	{	return prop->nrm.rate[leaf];
+	}
+	return Sum_Tree_Get(&prop->tree, leaf);
+}
+
+// Set the propensity of a channel
+void Prop_Table_Set(proptable *prop, int leaf, double value)
+{	if(Prop_Table_Get(prop, leaf) == value)
+	{	return;
+	}
+	if(prop->engine == ENGINE_CR)
+	{	CR_Set(&prop->cr, leaf, value);
+	}
+	else if(prop->engine == ENGINE_NRM)
+	{	NRM_Set(&prop->nrm, leaf, value);
+	}
+	else
+	{	Sum_Tree_Set(&prop->tree, leaf, value);
+	}
+}
+
+// Total propensity of all channels
+double Prop_Table_Total(proptable *prop)
+{	if(prop->engine == ENGINE_CR)
+	{	return Sum_Tree_Total(&prop->cr.bin_tree);
+	}
+	else if(prop->engine == ENGINE_NRM)
+	{	return NRM_Total(&prop->nrm);
+	}
+	return Sum_Tree_Total(&prop->tree);
+}
+
+// Time until the next event, or a negative value if no channel can fire
+// The direct method and composition-rejection advance time by the mean waiting time 1/total propensity,
+// the next reaction method by the exponentially distributed firing time of the picked channel
+double Prop_Table_Wait(proptable *prop)
+{	double tot_rate;
+	
+	if(prop->engine == ENGINE_NRM)
+	{	return NRM_Wait(&prop->nrm);
+	}
+	
+	tot_rate = Prop_Table_Total(prop);
+	if(tot_rate > 0)
+	{	return 1/tot_rate;
+	}
+	return -1.0;
+}
+
+// Pick a channel with probability proportional to its propensity
+int Prop_Table_Pick(proptable *prop, rng *r)
+{	if(prop->engine == ENGINE_CR)
+	{	return CR_Pick(&prop->cr, r);
+	}
+	else if(prop->engine == ENGINE_NRM)
+	{	return NRM_Pick(&prop->nrm, r);
+	}
+	return Sum_Tree_Find(&prop->tree, Rng_Uniform(r)*Sum_Tree_Total(&prop->tree));
+}
+
+// Restart the clock of the table at time now after the propensities were changed outside of it (leaped burn-in)
+// The next reaction method draws new firing times for all channels, the other methods keep no clock
+void Prop_Table_Resync(proptable *prop, double now, rng *r)
+{	int c1, i, c;
+	nrmqueue *q = &prop->nrm;
+	
+	if(prop->engine != ENGINE_NRM)
+	{	return;
+	}
+	q->now = now;
+	for(c1=0;c1<q->n_leaves;c1++)
+	{	if(q->rate[c1] > 0.0)
+		{	q->tau[c1] = now - log(Rng_Uniform_Pos(r))/q->rate[c1];
+		}
+		else
+		{	q->rem[c1] = -log(Rng_Uniform_Pos(r));
+		}
+	}
+	for(c1=q->n_leaves/2-1;c1>=0;c1--)												// Rebuild the heap bottom up
+	{	i = c1;
+		while(2*i+1 < q->n_leaves)
+		{	c = 2*i+1;
+			if(c+1 < q->n_leaves && q->tau[q->heap[c+1]] < q->tau[q->heap[c]])
+			{	c++;
+			}
+			if(q->tau[q->heap[c]] >= q->tau[q->heap[i]])
+			{	break;
+			}
+			NRM_Swap(q, i, c);
+			i = c;
+		}
+	}
+}
+
+void Prop_Table_Free(proptable *prop)
+{	if(prop->engine == ENGINE_CR)
+	{	CR_Free(&prop->cr);
+	}
+	else if(prop->engine == ENGINE_NRM)
+	{	NRM_Free(&prop->nrm);
+	}
+	else
+	{	Sum_Tree_Free(&prop->tree);
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifdef SPARSE_RGRID
+
+// Index in the sorted ribosome list of the first ribosome at or after codon p
+static inline int Grid_Lower_Bound(grid_row *row, int p)
+{	int lo = 0, hi = row->n_ribo, mid;
+	
+	while(lo < hi)
+	{	mid = (lo+hi)/2;
+		if(row->pos[mid] < p)
+		{	lo = mid+1;
+		}
+		else
+		{	hi = mid;
+		}
+	}
+	return lo;
+}
+
+// Allocate an empty grid with one row per mRNA sized to the length of its gene
+// Returns 0 if out of memory; the grid can then still be freed.
+int Grid_Init(ribogrid *grid, transcript *mRNA, gene *Gene, int n_rows, int empty)
+{	int c1;
+	
+	grid->n_rows = n_rows;
+	grid->empty = empty;
+	grid->row = (grid_row *)calloc(n_rows, sizeof(grid_row));
+	if(grid->row == NULL)
+	{	grid->n_rows = 0;
+		return 0;
+	}
+	for(c1=0;c1<n_rows;c1++)
+	{	grid->row[c1].occ = (uint64_t *)calloc((Gene[mRNA[c1].gene].len+GRID_PAD)/64+1, sizeof(uint64_t));
+		if(grid->row[c1].occ == NULL)
+		{	return 0;
+		}
+	}
+	return 1;
+}
+
+// Id of the ribosome at codon p of mRNA m, or grid->empty
+static inline int Grid_Get(ribogrid *grid, int m, int p)
+{	grid_row *row = &grid->row[m];
+	
+	if(((row->occ[p>>6] >> (p&63)) & 1) == 0)
+	{	return grid->empty;
+	}
+	return row->id[Grid_Lower_Bound(row, p)];
+}
+
+// Place ribosome id at codon p of mRNA m, or clear the codon if id is grid->empty
+static inline void Grid_Set(ribogrid *grid, int m, int p, int id)
+{	grid_row *row = &grid->row[m];
+	int k = Grid_Lower_Bound(row, p);
+	int bound = (row->occ[p>>6] >> (p&63)) & 1;
+	
+	if(id == grid->empty)
+	{	if(bound)
+		{	memmove(row->pos+k, row->pos+k+1, sizeof(int) * (row->n_ribo-k-1));
+			memmove(row->id+k, row->id+k+1, sizeof(int) * (row->n_ribo-k-1));
+			row->n_ribo--;
+			row->occ[p>>6] &= ~((uint64_t)1 << (p&63));
+		}
+	}
+	else if(bound)
+	{	row->id[k] = id;
+	}
+	else
+	{	if(row->n_ribo == row->max_ribo)
+		{	row->max_ribo = (row->max_ribo == 0) ? 4 : 2*row->max_ribo;
+			row->pos = (int *)realloc(row->pos, sizeof(int) * row->max_ribo);
+			row->id = (int *)realloc(row->id, sizeof(int) * row->max_ribo);
+			if(row->pos == NULL || row->id == NULL)
+			{	printf("Too many ribosomes\nOut of memory\n");fflush(stdout);
+				exit(1);
+			}
+		}
+		memmove(row->pos+k+1, row->pos+k, sizeof(int) * (row->n_ribo-k));
+		memmove(row->id+k+1, row->id+k, sizeof(int) * (row->n_ribo-k));
+		row->pos[k] = p;
+		row->id[k] = id;
+		row->n_ribo++;
+		row->occ[p>>6] |= (uint64_t)1 << (p&63);
+	}
+}
+
+void Grid_Free(ribogrid *grid)
+{	int c1;
+	
+	for(c1=0;c1<grid->n_rows;c1++)
+	{	free(grid->row[c1].occ);
+		free(grid->row[c1].pos);
+		free(grid->row[c1].id);
+	}
+	free(grid->row);
+}
+
+#else
+
+// Allocate an empty grid with one row per mRNA sized to the length of its gene, all rows in one block
+// Returns 0 if out of memory; the grid can then still be freed.
+int Grid_Init(ribogrid *grid, transcript *mRNA, gene *Gene, int n_rows, int empty)
+{	int c1;
+	size_t c2, n_cells = 0;
+	
+	grid->n_rows = n_rows;
+	grid->empty = empty;
+	for(c1=0;c1<n_rows;c1++)
+	{	n_cells += Gene[mRNA[c1].gene].len+GRID_PAD;
+	}
+	grid->row = (int **)malloc(sizeof(int *) * n_rows);
+	grid->cells = (int *)malloc(sizeof(int) * n_cells);
+	if(grid->row == NULL || grid->cells == NULL)
+	{	return 0;
+	}
+	for(c2=0;c2<n_cells;c2++)
+	{	grid->cells[c2] = empty;
+	}
+	n_cells = 0;
+	for(c1=0;c1<n_rows;c1++)
+	{	grid->row[c1] = grid->cells+n_cells;
+		n_cells += Gene[mRNA[c1].gene].len+GRID_PAD;
+	}
+	return 1;
+}
+
+// Id of the ribosome at codon p of mRNA m, or grid->empty
+static inline int Grid_Get(ribogrid *grid, int m, int p)
+{	return grid->row[m][p];
+}
+
+// Place ribosome id at codon p of mRNA m, or clear the codon if id is grid->empty
+static inline void Grid_Set(ribogrid *grid, int m, int p, int id)
+{	grid->row[m][p] = id;
+}
+
+void Grid_Free(ribogrid *grid)
+{	free(grid->cells);
+	free(grid->row);
+}
+
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Open an output file for writing. With a result cache (-Oc) its name is recorded, so that the outputs stored
+// with the run are exactly those it wrote.
+FILE *Output_Open(char *filename, char *mode)
+{	FILE *fh = fopen(filename, mode);
+	int c1;
+	
+	if(fh == NULL || strcmp(cache_dir, "") == 0)
+	{	return fh;
+	}
+	pthread_mutex_lock(&cache_lock);
+	for(c1=0;c1<n_cache_outputs;c1++)
+	{	if(strcmp(cache_outputs[c1], filename) == 0)
+		{	break;
+		}
+	}
+	if(c1 == n_cache_outputs)
+	{	if(n_cache_outputs == max_cache_outputs)
+		{	max_cache_outputs = (max_cache_outputs == 0) ? 32 : 2*max_cache_outputs;
+			cache_outputs = (char **)realloc(cache_outputs, sizeof(char *) * max_cache_outputs);
+		}
+		if(cache_outputs == NULL || (cache_outputs[n_cache_outputs] = strdup(filename)) == NULL)
+		{	printf("Out of memory\n");fflush(stdout);
+			exit(1);
+		}
+		n_cache_outputs++;
+	}
+	pthread_mutex_unlock(&cache_lock);
+	return fh;
+}
+
+// Report an error in a genome file: into err if it is not NULL (the caller passes it on), otherwise print it and exit
+void Genome_Error(char *err, const char *fmt, ...)
+{	va_list ap;
+	
+	va_start(ap, fmt);
+	if(err != NULL)
+	{	vsnprintf(err, 300, fmt, ap);
+		va_end(ap);
+		return;
+	}
 	printf("\n");
-	printf("\t\t\t-p8:	Generates afile of number of bound ribosomes at each position of a gene.\n");
+	vprintf(fmt, ap);
 	printf("\n");
-	printf("\t\t\t-p9:	Generates a file of average (RPF and mRNA based) of bound ribosomes\n");
-	printf("\t\t\t	at each position of a gene.\n\n");
+	va_end(ap);
+	fflush(stdout);
+	exit(1);
 }
 
-// Read in commandline arguments
-void Read_Commandline_Args(int argc, char *argv[])
-{	int i;
+// Reading the processed sequence file, up to max_genes genes (the number read is stored in n_read)
+// Codon sequences of all genes are stored back to back in one buffer (returned) and Gene[c1].seq points
+// to the start of gene c1, so genes only take the memory of their own length and have no length limit
+// Errors in the file are reported through Genome_Error: with err set (at least 300 characters) NULL is returned
+uint8_t *Read_FASTA_File(char *filename, gene *Gene, int max_genes, int *n_read, char *err)
+{	FILE *fh;
+	int c1=0,c2=0,cod;
+	int curr_char;
+	long n_cod=0,max_cod=1048576;
+	uint8_t *codon_buf;
 	
-	for(i=1;i<argc;i++)
-	{	if(argv[i][0] == '-')
-		{	switch(argv[i][1])
-			{	case 'h':
-				case '-':
-					fflush(stdout);
-					Help_out();
-					exit(1);
-					break;
-				case 'V':
-					if((argv[i][2] != '\0') || (i==argc-1))
-					{	printf("\nTotal space not specified or Incorrect usage\n");
-						fflush(stdout);
-						Help_out();
-						exit(1);
-					}
-					else
-					{	tot_space = atof(argv[++i]);
-						
-						avail_space_t = (double)floor(tot_space/pow(char_len_tRNA,3));
-						avail_space_r = (double)floor(tot_space/pow(char_len_ribo,3));
-						
-						if(avail_space_r<1e3 || avail_space_t < 1e3)
-						{	printf("\nAvailable cytoplasmic space is too small\n\n");
-							fflush(stdout);
-							Help_out();
-							exit(1);
-						}
-						break;
-					}
-				case 's':
-					if((argv[i][2] != '\0') || (i==argc-1))
-					{	printf("\nSeed for RNG not specified or Incorrect usage\n");
-						fflush(stdout);
-						Help_out();
-						exit(1);
-					}
-					else
-					{	seed = atoi(argv[++i]);
-						break;
-					}
-				case 't':
-					if((argv[i][2] != '\0') || (i==argc-1))
-					{	printf("\nTotal # of tRNAs not specified or Incorrect usage\n");
-						fflush(stdout);
-						Help_out();
-						exit(1);
-					}
-					else
-					{	tot_tRNA = atoi(argv[++i]);
-						break;
-					}
-				case 'R':
-					if((argv[i][2] != '\0') || (i==argc-1))
-					{	printf("\nTotal # of ribosomes not specified or Incorrect usage\n");
-						fflush(stdout);
-						Help_out();
-						exit(1);
-					}
-					else
-					{	tot_ribo = atoi(argv[++i]);
-						break;
-					}
-				case 'N':
-					if((argv[i][2] != '\0') || (i==argc-1))
-					{	printf("\nTotal # of genes not specified or Incorrect usage\n");
-						fflush(stdout);
-						Help_out();
-						exit(1);
-					}
-					else
-					{	n_genes = atoi(argv[++i]);
-						if(n_genes>MAX_GENES)
-						{	printf("\nTotal # of genes for simulation exceeds maximum genes = %d\n", MAX_GENES);
-							fflush(stdout);
-							Help_out();
-							exit(1);
-						}
-						break;
-					}
-				case 'O':
-					if((argv[i][2] != '\0') || (i==argc-1))
-					{	printf("\nOutput prefix not specified or Incorrect usage\n");
-						fflush(stdout);
-						Help_out();
-						exit(1);
-					}
-					else
-					{	strcpy(out_prefix,argv[++i]);
-						break;
-					}
-				case 'F':
-					if((argv[i][2] != '\0') || (i==argc-1))
-					{	printf("\nFasta file not specified or Incorrect usage\n");
-						fflush(stdout);
-						Help_out();
-						exit(1);
-					}
-					else
-					{	strcpy(fasta_file,argv[++i]);
-						break;
-					}
-				case 'J':
-					if((argv[i][2] != '\0') || (i==argc-1))
-					{	printf("\nState file not specified or Incorrect usage\n");
-						fflush(stdout);
-						Help_out();
-						exit(1);
-					}
-					else
-					{	strcpy(state_file,argv[++i]);
-						break;
-					}
-				case 'C':
-					if((argv[i][2] != '\0') || (i==argc-1))
-					{	printf("\nS.cer Code file not specified or Incorrect usage\n");
-						fflush(stdout);
-						Help_out();
-						exit(1);
-					}
-					else
-					{	strcpy(code_file,argv[++i]);
-						break;
-					}
-				case 'x':
-					switch(argv[i][2])
-					{	case '1':
-							chx_rb_prob = atof(argv[++i]);
-							
-							if(chx_rb_prob<0)
-							{	printf("\nCycloheximide probability for bound ribosomes should be positive (>0)\n\n");
-								fflush(stdout);
-								Help_out();
-								exit(1);
-							}
-							break;
-						case '2':
-							chx_ds_rate = atof(argv[++i]);
-							
-							if(chx_ds_rate<0)
-							{	printf("\nCycloheximide dissociation rate from bound ribosomes should be positive (>0)\n\n");
-								fflush(stdout);
-								Help_out();
-								exit(1);
-							}
-							break;
-						default:
-							printf("\nInvalid CHX options\n");
-							fflush(stdout);
-							Help_out();
-							exit(1);
-							break;
-					}
+	fh=fopen(filename, "r");
+
+	if(!fh)					// Check if file exists
+	{	if(err == NULL)
+		{	printf("\nModified FASTA/Sequence File Doesn't Exist\n");
+			fflush(stdout);
+			Help_out();
+			exit(1);
+		}
+		sprintf(err,"Sequence file %.150s not found",filename);
+		return NULL;
+	}
+
+	codon_buf = (uint8_t *)malloc(max_cod);
+	if(codon_buf == NULL)
+	{	printf("Genome too large\nOut of memory\n");fflush(stdout);
+		exit(1);
+	}
+
+	if(fscanf(fh,"%lf",&Gene[c1].ini_prob) != 1)
+	{	Genome_Error(err, "Sequence file %.150s is empty or malformed", filename);
+		fclose(fh);
+		free(codon_buf);
+		return NULL;
+	}
+
+	do
+	{	if(fscanf(fh,"%d",&Gene[c1].exp) != 1)
+		{	Genome_Error(err, "Malformed gene %d in %.150s", c1, filename);
+			fclose(fh);
+			free(codon_buf);
+			return NULL;
+		}
+		
+		c2 = 0;
+		do
+		{	if(fscanf(fh,"%d",&cod) != 1 || cod<0 || cod>60)
+			{	Genome_Error(err, "Invalid codon at position %d of gene %d in %.150s", c2, c1, filename);
+				fclose(fh);
+				free(codon_buf);
+				return NULL;
+			}
+			if(n_cod == max_cod)
+			{	max_cod *= 2;
+				codon_buf = (uint8_t *)realloc(codon_buf, max_cod);
+				if(codon_buf == NULL)
+				{	printf("Genome too large\nOut of memory\n");fflush(stdout);
+					exit(1);
+				}
+			}
+			codon_buf[n_cod] = (uint8_t)cod;
+			n_cod++;
+			c2++;
+			curr_char = fgetc(fh);
+		}while(curr_char != '\n' && curr_char != EOF);
+		Gene[c1].len = c2;
+
+		c1++;
+	}while(c1<max_genes && fscanf(fh,"%lf",&Gene[c1].ini_prob) ==1);
+	fclose(fh);
+	*n_read = c1;
+	
+	// The buffer does not move anymore, point the genes to their sequences
+	n_cod = 0;
+	for(c1=0;c1<*n_read;c1++)
+	{	Gene[c1].seq = codon_buf + n_cod;
+		n_cod += Gene[c1].len;
+	}
+	
+	return codon_buf;
+}
+
+// Reading a FASTA file of ORFs directly (-Ff), replacing utilities/convert.fasta.to.genom.pl
+// Codons are numbered by their order in the genetic code file (-Fg) and each FASTA record is paired with the row
+// of the mRNA abundance file (-Fm) in the same order, giving the same genome as the perl script. The FASTA file is
+// read in a single pass and every codon is looked up in a table indexed by its nucleotides. The stop codon ending
+// each ORF is dropped, as the perl script drops the last codon. Malformed ORFs (length not a multiple of 3, unknown
+// nucleotides, internal or missing stop codons) and ORFs named differently in the two files are all reported
+// before exiting.
+uint8_t *Read_ORF_FASTA_File(char *filename, gene *Gene, int max_genes, int *n_read)
+{	FILE *fh, *fc, *fa;
+	int c1=-1,c2,ch,nt,key,n_nt=0,n_bad=0,bad=0,n_mismatch=0;
+	int cod_num[64];							// Codon number of each codon (16*nt1+4*nt2+nt3), -1 for stop codons
+	int nt_num[256];							// 0-3 for A, C, G and T/U, -1 for other characters
+	char line[1000], name[200], abndc_name[200], aa[16], cod[16];
+	double exp;
+	long n_cod=0,max_cod=1048576,g_start=0;
+	uint8_t *codon_buf;
+	
+	// Genetic code
+	for(c2=0;c2<256;c2++)
+	{	nt_num[c2] = -1;
+	}
+	nt_num['A'] = nt_num['a'] = 0;
+	nt_num['C'] = nt_num['c'] = 1;
+	nt_num['G'] = nt_num['g'] = 2;
+	nt_num['T'] = nt_num['t'] = nt_num['U'] = nt_num['u'] = 3;
+	for(c2=0;c2<64;c2++)
+	{	cod_num[c2] = -1;
+	}
+	
+	fc = fopen(gcode_file, "r");
+	if(!fc)
+	{	printf("\nGenetic code file %s Doesn't Exist\n",gcode_file);
+		fflush(stdout);
+		Help_out();
+		exit(1);
+	}
+	fgets(line, sizeof(line), fc);				// Header
+	c2 = 0;
+	while(fgets(line, sizeof(line), fc) != NULL)
+	{	if(sscanf(line,"%15s %15s",aa,cod) != 2)
+		{	continue;
+		}
+		if(strlen(cod) != 3 || nt_num[(unsigned char)cod[0]] < 0 || nt_num[(unsigned char)cod[1]] < 0 || nt_num[(unsigned char)cod[2]] < 0 || c2 > 60)
+		{	printf("\nInvalid codon %s in genetic code file %s\n",cod,gcode_file);
+			fflush(stdout);
+			exit(1);
+		}
+		cod_num[16*nt_num[(unsigned char)cod[0]] + 4*nt_num[(unsigned char)cod[1]] + nt_num[(unsigned char)cod[2]]] = c2;
+		c2++;
+	}
+	fclose(fc);
+	
+	// Initiation probabilities and mRNA abundances are read along with the FASTA records
+	fa = fopen(abndc_file, "r");
+	if(!fa)
+	{	printf("\nmRNA abundance file %s Doesn't Exist\n",abndc_file);
+		fflush(stdout);
+		Help_out();
+		exit(1);
+	}
+	fgets(line, sizeof(line), fa);				// Header
+	
+	fh = fopen(filename, "r");
+	if(!fh)
+	{	printf("\nFASTA File %s Doesn't Exist\n",filename);
+		fflush(stdout);
+		Help_out();
+		exit(1);
+	}
+	
+	codon_buf = (uint8_t *)malloc(max_cod);
+	if(codon_buf == NULL)
+	{	printf("Genome too large\nOut of memory\n");fflush(stdout);
+		exit(1);
+	}
+	
+	key = 0;
+	do
+	{	ch = getc(fh);
+		
+		// End of an ORF
+		if((ch == '>' || ch == EOF) && c1 >= 0)
+		{	if(n_nt%3 != 0)
+			{	printf("Malformed ORF %d (%s): length %d is not a multiple of 3\n",c1,name,n_nt);
+				bad = 1;
+			}
+			if(n_cod > g_start && codon_buf[n_cod-1] == 255)	// Drop the stop codon
+			{	n_cod--;
+			}
+			else if(bad == 0)
+			{	printf("Malformed ORF %d (%s): does not end with a stop codon\n",c1,name);
+				bad = 1;
+			}
+			for(c2=g_start;c2<n_cod && bad==0;c2++)
+			{	if(codon_buf[c2] == 255)
+				{	printf("Malformed ORF %d (%s): stop codon at codon %d\n",c1,name,c2-(int)g_start);
+					bad = 1;
 					break;
-				case 'y':
-					if((argv[i][2] != '\0') || (i==argc-1))
-					{	printf("\nHarringtonine rate for free ribosomes not specified or Incorrect usage\n");
-						fflush(stdout);
-						Help_out();
+				}
+			}
+			if(n_cod == g_start && bad == 0)
+			{	printf("Malformed ORF %d (%s): no codons\n",c1,name);
+				bad = 1;
+			}
+			Gene[c1].len = n_cod - g_start;
+			n_bad += bad;
+			
+			if(c1+1 == max_genes)
+			{	break;
+			}
+		}
+		
+		// Start of an ORF
+		if(ch == '>')
+		{	c1++;
+			if(fgets(line, sizeof(line), fh) == NULL || sscanf(line,"%199s",name) != 1)
+			{	strcpy(name, "");
+			}
+			while(strchr(line, '\n') == NULL && fgets(line, sizeof(line), fh) != NULL);	// Rest of a long header
+			if(fscanf(fa,"%199s %lf %lf",abndc_name,&Gene[c1].ini_prob,&exp) != 3)
+			{	printf("\nmRNA abundance file %s has fewer genes than the FASTA file %s\n",abndc_file,filename);
+				fflush(stdout);
+				exit(1);
+			}
+			Gene[c1].exp = (int)exp;
+			if(strcmp(name, abndc_name) != 0)
+			{	printf("ORF %d is %s in the FASTA file and %s in the mRNA abundance file\n",c1,name,abndc_name);
+				n_mismatch++;
+			}
+			g_start = n_cod;
+			n_nt = 0;
+			bad = 0;
+		}
+		else if(ch != EOF && ch != '\n' && ch != '\r' && ch != ' ' && ch != '\t')
+		{	if(c1 < 0)
+			{	printf("\nFASTA file %s does not start with a '>' header\n",filename);
+				fflush(stdout);
+				exit(1);
+			}
+			nt = nt_num[(unsigned char)ch];
+			if(nt < 0)
+			{	if(bad == 0)
+				{	printf("Malformed ORF %d (%s): unknown nucleotide '%c' at position %d\n",c1,name,ch,n_nt);
+				}
+				bad = 1;
+				nt = 0;
+			}
+			key = 4*key + nt;
+			n_nt++;
+			if(n_nt%3 == 0)
+			{	if(n_cod == max_cod)
+				{	max_cod *= 2;
+					codon_buf = (uint8_t *)realloc(codon_buf, max_cod);
+					if(codon_buf == NULL)
+					{	printf("Genome too large\nOut of memory\n");fflush(stdout);
 						exit(1);
 					}
-					else
-					{	harr_rf_rate = atof(argv[++i]);
-						
-						if(harr_rf_rate<0)
-						{	printf("\nHarringtonine rate for free ribosomes should be positive (>0)\n\n");
-							fflush(stdout);
-							Help_out();
-							exit(1);
-						}
-						break;
-					}
-				case 'P':
-				case 'p':
-					switch(argv[i][2])
-					{	case '1':
-							printOpt[0]=1;		// Elongation times of all codons
-							break;
-						case '2':
-							printOpt[1]=1;		// Average total elongation time of all genes
-							break;
-						case '3':
-							printOpt[2]=1;		// Average time between initiation events of all genes
-							break;
-						case '4':
-							printOpt[3]=1;		// Average number of free ribosomes and tRNAs of each type
-							break;
-						case '5':
-							printOpt[4]=1;		// Final state of the system - positions on mRNAs bound by ribosomes
-							break;
-						case '6':
-							printOpt[5]=1;		// Amount of time spent by ribosomes stalled on each gene
-							break;
-						case '7':
-							printOpt[6]=1;		// Print internal state of the cell every second - positions on mRNAs bound by ribosomes
-							break;
-						case '8':
-							printOpt[7]=1;		// Final state of the system - positions on genes bound by ribosomes
-							break;
-						case '9':
-							printOpt[8]=1;		// Final state of the system - avg (RPF and mRNA normalized) ribosome densities
-							break;
-						default:
-							printf("\nInvalid print options\n");
-							fflush(stdout);
+				}
+				codon_buf[n_cod] = (cod_num[key&63] < 0) ? 255 : (uint8_t)cod_num[key&63];
+				n_cod++;
+				key = 0;
+			}
+		}
+	}while(ch != EOF);
+	fclose(fh);
+	fclose(fa);
+	*n_read = c1+1;
+	
+	if(n_bad > 0 || n_mismatch > 0)
+	{	if(n_bad > 0)
+		{	printf("\n%d malformed ORFs in %s\n",n_bad,filename);
+		}
+		if(n_mismatch > 0)
+		{	printf("\n%d ORFs named differently in %s and %s\n",n_mismatch,filename,abndc_file);
+		}
+		fflush(stdout);
+		exit(1);
+	}
+	
+	// The buffer does not move anymore, point the genes to their sequences
+	n_cod = 0;
+	for(c1=0;c1<*n_read;c1++)
+	{	Gene[c1].seq = codon_buf + n_cod;
+		n_cod += Gene[c1].len;
+	}
+	
+	return codon_buf;
+}
+
+
+// Map a compiled genome file into memory, reading up to max_genes genes (the number read is stored in n_read)
+// Gene[c1].seq points into the mapping, so no codon is copied and concurrent runs share the file through the page cache.
+// Returns the start of the mapping, whose size is stored in map_size. Errors are reported as in Read_FASTA_File.
+uint8_t *Map_Genome_File(char *filename, gene *Gene, int max_genes, int *n_read, size_t *map_size, char *err)
+{	int fd, c1;
+	struct stat st;
+	uint8_t *map;
+	sgb_header *head;
+	sgb_gene *table;
+	uint8_t *codons;
+	uint64_t n_cod=0, c2;
+	
+	fd = open(filename, O_RDONLY);
+	if(fd < 0 || fstat(fd, &st) != 0)
+	{	if(fd >= 0)
+		{	close(fd);
+		}
+		Genome_Error(err, "Compiled genome file %.150s could not be opened", filename);
+		return NULL;
+	}
+	if((size_t)st.st_size < sizeof(sgb_header))
+	{	close(fd);
+		Genome_Error(err, "Compiled genome file %.150s is truncated", filename);
+		return NULL;
+	}
+	map = (uint8_t *)mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED)
+	{	Genome_Error(err, "Compiled genome file %.150s could not be mapped", filename);
+		return NULL;
+	}
+	*map_size = st.st_size;
+	
+	head = (sgb_header *)map;
+	if(head->version != SGB_VERSION)
+	{	Genome_Error(err, "Compiled genome file %.150s has version %u, expected %d. Compile it again with --compile-genome", filename, head->version, SGB_VERSION);
+		munmap(map, st.st_size);
+		return NULL;
+	}
+	if(sizeof(sgb_header) + (uint64_t)head->n_genes*sizeof(sgb_gene) + head->n_codons != (uint64_t)st.st_size)
+	{	Genome_Error(err, "Compiled genome file %.150s is truncated or corrupt", filename);
+		munmap(map, st.st_size);
+		return NULL;
+	}
+	table = (sgb_gene *)(map + sizeof(sgb_header));
+	codons = map + sizeof(sgb_header) + (size_t)head->n_genes*sizeof(sgb_gene);
+	
+	*n_read = (head->n_genes < (uint32_t)max_genes) ? (int)head->n_genes : max_genes;
+	for(c1=0;c1<*n_read;c1++)
+	{	Gene[c1].ini_prob = table[c1].ini_prob;
+		Gene[c1].exp = table[c1].exp;
+		Gene[c1].len = table[c1].len;
+		Gene[c1].seq = codons + n_cod;
+		n_cod += (uint64_t)table[c1].len;
+		if(table[c1].len <= 0 || table[c1].exp < 0 || n_cod > head->n_codons)
+		{	Genome_Error(err, "Compiled genome file %.150s is corrupt at gene %d", filename, c1);
+			munmap(map, st.st_size);
+			return NULL;
+		}
+	}
+	for(c2=0;c2<n_cod;c2++)
+	{	if(codons[c2] > 60)
+		{	Genome_Error(err, "Invalid codon %d in compiled genome file %.150s", codons[c2], filename);
+			munmap(map, st.st_size);
+			return NULL;
+		}
+	}
+	
+	return map;
+}
+
+// Read the genome of the n_genes genes from a FASTA file of ORFs (-Ff), a processed sequence file or a compiled genome file
+// Returns the buffer holding the codons, which is mapped from the file if map_size is set to a value > 0
+uint8_t *Read_Genome(char *filename, gene *Gene, size_t *map_size)
+{	FILE *fh;
+	char magic[8];
+	int n_read;
+	uint8_t *codon_buf;
+	
+	fh = fopen(filename, "rb");
+	if(strcmp(orf_fasta_file, "") != 0)
+	{	if(fh != NULL)
+		{	fclose(fh);
+		}
+		*map_size = 0;
+		codon_buf = Read_ORF_FASTA_File(orf_fasta_file, Gene, n_genes, &n_read);
+		filename = orf_fasta_file;
+	}
+	else if(fh != NULL && fread(magic, 1, 8, fh) == 8 && memcmp(magic, SGB_MAGIC, 8) == 0)
+	{	fclose(fh);
+		codon_buf = Map_Genome_File(filename, Gene, n_genes, &n_read, map_size, NULL);
+	}
+	else
+	{	if(fh != NULL)
+		{	fclose(fh);
+		}
+		*map_size = 0;
+		codon_buf = Read_FASTA_File(filename, Gene, n_genes, &n_read, NULL);
+	}
+	
+	if(n_read<n_genes)
+	{	printf("\nSequence file %s contains %d genes, fewer than the %d genes specified with -N\n",filename,n_read,n_genes);
+		fflush(stdout);
+		exit(1);
+	}
+	return codon_buf;
+}
+
+// Number of genes in a processed sequence file (its non-blank lines) or in a FASTA file of ORFs (its headers)
+int Count_Genes(char *filename, int is_orf)
+{	FILE *fh;
+	int ch, n = 0, line_start = 1, counted = 0;
+	
+	fh = fopen(filename, "r");
+	if(fh == NULL)
+	{	return 0;
+	}
+	while((ch = getc(fh)) != EOF)
+	{	if(ch == '\n')
+		{	line_start = 1;
+			counted = 0;
+			continue;
+		}
+		if(is_orf == 1 && line_start == 1 && ch == '>')
+		{	n++;
+		}
+		else if(is_orf == 0 && counted == 0 && ch != ' ' && ch != '\t' && ch != '\r')
+		{	n++;
+			counted = 1;
+		}
+		line_start = 0;
+	}
+	fclose(fh);
+	return n;
+}
+
+// Convert a processed sequence file, or a FASTA file of ORFs with the -Fg and -Fm files, into a compiled genome file (--compile-genome)
+// The genes are counted first, so the whole file is compiled whatever its size
+void Compile_Genome(char *in_file, char *out_file)
+{	FILE *fh;
+	int c1, n_read, n_genes, is_orf;
+	gene *Gene;
+	uint8_t *codon_buf;
+	sgb_header head;
+	sgb_gene entry;
+	
+	fh = fopen(in_file, "r");
+	is_orf = (fh != NULL && getc(fh) == '>');									// FASTA file of ORFs
+	if(fh != NULL)
+	{	fclose(fh);
+	}
+	n_genes = Count_Genes(in_file, is_orf);
+	Gene = (gene *)malloc(sizeof(gene) * ((n_genes>0) ? n_genes : 1));
+	if(Gene == NULL)
+	{	printf("Too many genes\nOut of memory\n");fflush(stdout);
+		exit(1);
+	}
+	if(is_orf)
+	{	codon_buf = Read_ORF_FASTA_File(in_file, Gene, n_genes, &n_read);
+	}
+	else
+	{	codon_buf = Read_FASTA_File(in_file, Gene, n_genes, &n_read, NULL);
+	}
+	if(n_read < n_genes)
+	{	printf("\nOnly %d of the %d genes of %s could be read\n",n_read,n_genes,in_file);
+		fflush(stdout);
+		exit(1);
+	}
+	
+	memset(&head, 0, sizeof(head));
+	memcpy(head.magic, SGB_MAGIC, 8);
+	head.version = SGB_VERSION;
+	head.n_genes = n_read;
+	head.n_codons = 0;
+	for(c1=0;c1<n_read;c1++)
+	{	head.n_codons += Gene[c1].len;
+	}
+	
+	fh = fopen(out_file, "wb");
+	if(fh == NULL)
+	{	printf("\nCould not write compiled genome file %s\n",out_file);
+		fflush(stdout);
+		exit(1);
+	}
+	fwrite(&head, sizeof(head), 1, fh);
+	for(c1=0;c1<n_read;c1++)
+	{	memset(&entry, 0, sizeof(entry));
+		entry.ini_prob = Gene[c1].ini_prob;
+		entry.exp = Gene[c1].exp;
+		entry.len = Gene[c1].len;
+		fwrite(&entry, sizeof(entry), 1, fh);
+	}
+	if(fwrite(codon_buf, 1, head.n_codons, fh) != head.n_codons || fclose(fh) != 0)
+	{	printf("\nCould not write compiled genome file %s\n",out_file);
+		fflush(stdout);
+		exit(1);
+	}
+	printf("Compiled %d genes (%llu codons) into %s\n",n_read,(unsigned long long)head.n_codons,out_file);
+	
+	free(codon_buf);
+	free(Gene);
+}
+
+
+
+// Read in tRNA file
+int Read_tRNA_File(char *filename, trna *cTRNA)
+{	FILE *fh;
+	int c1=0,c2=0;
+	char curr_char;
+	
+	fh=fopen(filename, "r");
+	
+	if(!fh)					// Check if file exists
+	{	printf("\ntRNA File Doesn't Exist\n");
+		fflush(stdout);
+		Help_out();
+		exit(1);
+	}
+	c1 = 0;
+	c2 = 0;
+	while(fscanf(fh,"%s",&cTRNA[c1].codon)==1)
+	{	fscanf(fh,"%d%d%lf",&cTRNA[c1].tid,&cTRNA[c1].gcn,&cTRNA[c1].wobble);
+		c1++;
+	}
+}
+
+
+
+// Set up the positions whose stalled ribosomes are tracked with -ps: every gene, or the genes listed in the file
+// given with -Fs (gene numbers as in the output files, separated by white space)
+void Read_Stall_Genes(char *filename, gene *Gene)
+{	FILE *fh;
+	int c1, g_id;
+	
+	stall_off = (int *)malloc(sizeof(int) * n_genes);
+	if(stall_off == NULL)
+	{	printf("Out of memory\n");fflush(stdout);
+		exit(1);
+	}
+	for(c1=0;c1<n_genes;c1++)
+	{	stall_off[c1] = (strcmp(filename, "") == 0) ? 0 : -1;
+	}
+	
+	if(strcmp(filename, "") != 0)
+	{	fh=fopen(filename, "r");
+		if(!fh)					// Check if file exists
+		{	printf("\nStall gene list File Doesn't Exist\n");
+			fflush(stdout);
+			Help_out();
+			exit(1);
+		}
+		while(fscanf(fh,"%d",&g_id)==1)
+		{	if(g_id<0 || g_id>=n_genes)
+			{	printf("\nGene %d in %s is not one of the %d simulated genes\n",g_id,filename,n_genes);
+				fflush(stdout);
+				exit(1);
+			}
+			stall_off[g_id] = 0;
+		}
+		fclose(fh);
+	}
+	
+	n_stall_pos = 0;
+	for(c1=0;c1<n_genes;c1++)
+	{	if(stall_off[c1]==0)
+		{	stall_off[c1] = n_stall_pos;
+			n_stall_pos += Gene[c1].len;
+		}
+	}
+}
+
+
+
+// Reading the state of the system
+// Positions bound in the file are set to tot_ribo+1 until ribosome ids are assigned, free positions to tot_ribo
+int Read_STATE_File(char *filename, ribogrid *grid, int n_rows)
+{	FILE *fh;
+	int c1=0,c2=0,bound;
+	char curr_char;
+	
+	fh=fopen(filename, "r");
+	
+	if(!fh)					// Check if file exists
+	{	printf("\nState File Doesn't Exist\n");
+		fflush(stdout);
+		Help_out();
+		exit(1);
+	}
+	
+	c1 = 0;
+	while(c1<n_rows && fscanf(fh,"%d",&bound) ==1)
+	{	c2 = 0;
+		do
+		{	if(c2>0)
+			{	fscanf(fh,"%d",&bound);
+			}
+			Grid_Set(grid, c1, c2, (bound==0) ? grid->empty : grid->empty+1);
+			c2++;
+			curr_char = fgetc(fh);
+		}while(curr_char != '\n' && curr_char != EOF);
+		c1++;
+	}
+	fclose(fh);
+}
+
+
+// Help output
+int Help_out()
+{	printf("\nUsage:\n");
+	printf("\t./bin/SMoPT [options]\n\n");
+	printf("Options:\n");
+	printf("\n\t-V <value>	Volume of the cell in m^3/s. The minimum volume of the cell is set to\n");
+	printf("\t\t\tcontain at least 1000 ribosomes and tRNAs.\n");
+	printf("\t\t\t[DEFAULT]  -V 4.2E-17 (volume of yeast cell)\n");
+	printf("\n");
+	printf("\t-T[CHAR]	Specify times for various events\n");
+	printf("\n");
+	printf("\t\t\t-Tt:	Total simulation time in seconds.\n");
+	printf("\t\t\t	[DEFAULT]  -Tt 1500\n");
+	printf("\n");
+	printf("\t\t\t-Tb:	Burn-in/threshold time. Time spent by the cell to reach equilibrium.\n");
+	printf("\t\t\t	Only calculations after this time will be included in the analyses.\n");
+	printf("\t\t\t	[DEFAULT]  -Tb 1000\n");
+	printf("\n");
+	printf("\t\t\t-Th:	Time at which harringtonine is added to the cell.\n");
+	printf("\t\t\t	[DEFAULT]  -Th 1500\n");
+	printf("\n");
+	printf("\t\t\t-Tc:	Time at which cycloheximide is added to the cell.\n");
+	printf("\t\t\t	[DEFAULT]  -Tc 1500\n");
+	printf("\n");
+	printf("\t\t\t-Tk:	Time between checkpoints written with -K.\n");
+	printf("\t\t\t	[DEFAULT]  -Tk 0 (only at the end of the simulation)\n");
+	printf("\n");
+	printf("\t\t\t-Tl:	Simulate the burn-in (-Tb) in leaps with this error control\n");
+	printf("\t\t\t	(e.g. 0.03). Over a leap the free tRNAs and ribosomes are held\n");
+	printf("\t\t\t	fixed in the rates and the ribosomes of each mRNA move in one go;\n");
+	printf("\t\t\t	a leap is short enough that no free pool is expected to change by\n");
+	printf("\t\t\t	more than this fraction. Time after the burn-in is always simulated\n");
+	printf("\t\t\t	exactly.\n");
+	printf("\t\t\t	[DEFAULT]  exact burn-in\n");
+	printf("\n");
+	printf("\t\t\t-Tv:	As -Tl, but also simulate the cells with an exact burn-in (outputs\n");
+	printf("\t\t\t	<prefix>_exact...) and compare the statistics after the burn-in of\n");
+	printf("\t\t\t	both in <prefix>_leap_validation.out, flagging significant\n");
+	printf("\t\t\t	differences.\n");
+	printf("\n");	
+	printf("\t-R <value>	Total number of ribosomes in the cell.\n");
+	printf("\t\t\t[DEFAULT]  -R 200000\n");
+	printf("\n");
+	printf("\t-t <value>	Total number of tRNAs in the cell.\n");
+	printf("\t\t\t[DEFAULT]  -t 3300000\n");
+	printf("\n");
+	printf("\t-N <value>	Total number of genes. This needs to be specified by the user.\n");
+	printf("\t\t\t[DEFAULT]  -N 1\n");
+	printf("\n");
+	printf("\t-F <FILE>	File containing processed fasta file into a numeric sequence.\n");
+	printf("\t\t\tThis file is an output of the code utilities/convert.fasta.to.genom.pl\n");
+	printf("\t\t\tIt contains the information regarding initiation probability, mRNA\n");
+	printf("\t\t\tabundance and codon sequence of each gene.\n");
+	printf("\t\t\tA genome compiled with --compile-genome is also accepted and is\n");
+	printf("\t\t\tmapped into memory instead of being parsed.\n");
+	printf("\t\t\t[DEFAULT]  -F example/input/S.cer.genom\n");
+	printf("\n");
+	printf("\t-F[CHAR]	Read the genome from a FASTA file of ORFs instead of -F. This replaces\n");
+	printf("\t\t\tthe conversion with utilities/convert.fasta.to.genom.pl\n");
+	printf("\n");
+	printf("\t\t\t-Ff:	FASTA file of ORFs, each ending with a stop codon.\n");
+	printf("\n");
+	printf("\t\t\t-Fg:	Genetic code file numbering the 61 sense codons.\n");
+	printf("\t\t\t	[DEFAULT]  -Fg utilities/genetic.code.tsv\n");
+	printf("\n");
+	printf("\t\t\t-Fm:	Initiation probability and mRNA abundance of each ORF,\n");
+	printf("\t\t\t	in the order of the FASTA file. Required with -Ff.\n");
+	printf("\t\t\t	e.g. -Fm example/input/S.cer.mRNA.abndc.ini.tsv\n");
+	printf("\n");
+	printf("\t\t\t-Fs:	Numbers of the genes (as in the output files) whose stalls\n");
+	printf("\t\t\t	are tracked by -ps, separated by spaces or new lines.\n");
+	printf("\t\t\t	[DEFAULT]  all genes\n");
+	printf("\n");
+	printf("\t-C <FILE>	File containing the information about codon, tRNA, tRNA abundance and wobble.\n");
+	printf("\t\t\tThis file is an output of the code utilities/create.Scer.cod.anticod.numeric.pl\n");
+	printf("\t\t\t[DEFAULT]  -C example/input/S.cer.tRNA\n");
+	printf("\n");
+	printf("\t-J <FILE>	File containing the initial state of the system to begin simulations from.\n");
+	printf("\t\t\tThis file is an output of this simulation code containing '*_ribo_pos_*'\n");
+	printf("\t\t\t[DEFAULT]  -C example/input/output_final_ribo_pos.out\n");
+	printf("\n");
+	printf("\t-K <FILE>	Binary checkpoint of the complete state of the cell (ribosomes, tRNAs,\n");
+	printf("\t\t\taccumulated statistics and random number generator), written every\n");
+	printf("\t\t\t-Tk seconds and at the end of the simulation. With -n each replicate\n");
+	printf("\t\t\twrites <FILE>_rep<k>.\n");
+	printf("\n");
+	printf("\t-k <FILE>	Resume the simulation from a checkpoint written with -K. The genome,\n");
+	printf("\t\t\t-R, -E, -p4 and -p6 must be the same as in the run that wrote it; times,\n");
+	printf("\t\t\tdrugs and other output options are taken from the command line. A\n");
+	printf("\t\t\tresumed run is identical to an uninterrupted one. With -n all\n");
+	printf("\t\t\treplicates start from the checkpoint and continue with their own seeds.\n");
+	printf("\n");
+	printf("\t-x[INTEGER]	Specify parameters for cycloheximide action\n");
+	printf("\n");
+	printf("\t\t\t-x1:	Probability of cycloheximide binding ribosomes\n");
+	printf("\t\t\t	[DEFAULT]  -x1 0\n");
+	printf("\n");
+	printf("\t\t\t-x2:	Rate of cycloheximide dissociation from bound ribosomes\n");
+	printf("\t\t\t	[DEFAULT]  -x2 0 (irreversible binding)\n");
+	printf("\n");
+	printf("\t-y <value>	Harringtonine rate for free ribosomes. This needs to be specified by the user.\n");
+	printf("\t\t\t[DEFAULT]  -y 0\n");
+	printf("\n");
+	printf("\t-E <engine>	Method used to pick the next event of the simulation.\n");
+	printf("\t\t\tdirect:	Direct method (Gillespie) with propensity sum trees.\n");
+	printf("\t\t\tcr:	Composition-rejection. The cost of an event does not grow\n");
+	printf("\t\t\t	with the number of genes.\n");
+	printf("\t\t\tnrm:	Next reaction method (Gibson-Bruck). Only the channels changed\n");
+	printf("\t\t\t	by an event are rescheduled.\n");
+	printf("\t\t\t[DEFAULT]  -E direct\n");
+	printf("\n");
+	printf("\t-s <value>	Random number seed. *MUST SETUP*\n");
+	printf("\t\t\t[DEFAULT]  -s 1\n");
+	printf("\n");
+	printf("\t-G <name>	Random number generator.\n");
+	printf("\t\t\tmt19937:	Mersenne twister of GSL. Reproduces runs of earlier\n");
+	printf("\t\t\t	versions bit for bit.\n");
+	printf("\t\t\txoshiro:	xoshiro256++, the fastest.\n");
+	printf("\t\t\tpcg64:	PCG64 (128-bit LCG with XSL-RR output).\n");
+	printf("\t\t\tphilox:	Philox4x32-10, counter-based.\n");
+	printf("\t\t\tReplicate k (-n) and domain k (-D) draw from stream k of the seed.\n");
+	printf("\t\t\tWith mt19937 stream k is the seed s+k; with philox it is keyed by s\n");
+	printf("\t\t\tand never overlaps the others; xoshiro and pcg64 hash s and k.\n");
+	printf("\t\t\tCheckpoints can only be resumed with the generator that wrote them.\n");
+	printf("\t\t\t[DEFAULT]  -G mt19937\n");
+	printf("\n");
+	printf("\t\t\t-Gs:	Random stream of the first replicate. A run with -Gs k gives\n");
+	printf("\t\t\t	the outputs of replicate k of a run with -n, so the replicates\n");
+	printf("\t\t\t	of a study can be split across jobs.\n");
+	printf("\t\t\t	[DEFAULT]  -Gs 0\n");
+	printf("\n");
+	printf("\t-n <value>	Number of replicate cells simulated with the random streams 0...n-1\n");
+	printf("\t\t\tof the seed s (seeds s, s+1, ..., s+n-1 with -G mt19937).\n");
+	printf("\t\t\tInputs are read once and shared by all replicates. Outputs of\n");
+	printf("\t\t\treplicate k are written with the prefix <prefix>_rep<k> and the\n");
+	printf("\t\t\tmean and variance across replicates to <prefix>_*_merged.out\n");
+	printf("\t\t\t[DEFAULT]  -n 1\n");
+	printf("\n");
+	printf("\t-j <value>	Number of threads simulating replicates, the points of a sweep or\n");
+	printf("\t\t\tthe jobs of the job server (-W).\n");
+	printf("\t\t\t[DEFAULT]  -j 1\n");
+	printf("\n");
+	printf("\t-D <value>	Split the cell into this many domains, each simulated by its own\n");
+	printf("\t\t\tthread. A domain owns a share of the mRNAs of every gene and of\n");
+	printf("\t\t\tthe free ribosomes and tRNAs, which are pooled and shared out\n");
+	printf("\t\t\tagain at synchronization windows. Domain k uses random stream k (-G).\n");
+	printf("\t\t\tCannot be combined with -n, -Tv, -pt, -J, -K or -k.\n");
+	printf("\t\t\t[DEFAULT]  -D 1\n");
+	printf("\n");
+	printf("\t\t\t-Dt:	Tolerated relative error of the free pools as seen by a\n");
+	printf("\t\t\t	domain at the end of a window. Windows are lengthened or\n");
+	printf("\t\t\t	shortened to keep the error around this value.\n");
+	printf("\t\t\t	[DEFAULT]  -Dt 0.01\n");
+	printf("\n");
+	printf("\t-S <FILE>	Sweep over a grid of parameters. Each line of FILE names a parameter\n");
+	printf("\t\t\t(R, t, V, x1, x2, y, Tc or Th) followed by its values; the others\n");
+	printf("\t\t\tkeep their command-line value. Points with the same R, t and V\n");
+	printf("\t\t\tshare one burn-in up to the first drug addition and fork from it\n");
+	printf("\t\t\tin memory, continuing with the same random numbers. Point k writes\n");
+	printf("\t\t\tits outputs with the prefix <prefix>_pt<k>; the parameters and a\n");
+	printf("\t\t\tsummary of all points are written to <prefix>_sweep.out.\n");
+	printf("\t\t\tCannot be combined with -n, -D, -Tv, -pt, -K or -k.\n");
+	printf("\n");
+	printf("\t-W <socket>	Run as a job server on this Unix socket. A job is one line of\n");
+	printf("\t\t\tparameters and values, named as the options: F, C, N, R, t, V, x1,\n");
+	printf("\t\t\tx2, y, Tc, Th, Tt, Tb, Tl, s, Gs, E, G, O and p (a comma-separated\n");
+	printf("\t\t\tlist, e.g. p 1,4); the others keep their command-line value.\n");
+	printf("\t\t\tGenomes and tRNA tables are read once and kept in memory, and -j\n");
+	printf("\t\t\tthreads simulate the jobs. K <name> keeps the final state of a job\n");
+	printf("\t\t\tin memory as a snapshot and k <name> starts a job from it. Each\n");
+	printf("\t\t\tjob is answered with one line (see JOB SERVER in README.md).\n");
+	printf("\t\t\tCannot be combined with -S, -n, -D, -Tv, -pt, -ps, -J, -K or -k.\n");
+	printf("\n");
+	printf("\t\t\t-Wc:	Send the jobs read from stdin to the job server on this\n");
+	printf("\t\t\t	socket and print its answers.\n");
+	printf("\n");
+	printf("\t-O <prefix>	Specifies the prefix for the output files.\n");
+	printf("\t\t\t[DEFAULT]  -O output\n");
+	printf("\n");
+	printf("\t\t\t-Oc:	Result cache directory. A run whose binary, options and input\n");
+	printf("\t\t\t	files match an earlier run in the cache copies its outputs from\n");
+	printf("\t\t\t	there instead of simulating; other runs store their outputs in\n");
+	printf("\t\t\t	it. Points of a sweep (-S) are cached one by one.\n");
+	printf("\t\t\t	Cannot be combined with -W, -Wc or -K.\n");
+	printf("\n");
+#ifdef SMOPT_BENCH
+	printf("\t-B <value>	Stop after this number of events and print the event counts and\n");
+	printf("\t\t\ttimings as JSON (bench build only, see utilities/bench.pl).\n");
+	printf("\t\t\t[DEFAULT]  -B 0 (run to -Tt)\n");
+	printf("\n");
+#endif
+#ifdef SMOPT_TELEMETRY
+	printf("\t-L <FILE>	Write the progress of the simulation as lines of JSON to this file\n");
+	printf("\t\t\t(- for stderr): events/s, simulated seconds per wall second, ETA,\n");
+	printf("\t\t\tfree ribosomes, total event rate and event counts (telemetry build only).\n");
+	printf("\n");
+	printf("\t\t\t-Lp:	Wall seconds between progress reports.\n");
+	printf("\t\t\t	[DEFAULT]  -Lp 10\n");
+	printf("\n");
+#endif
+	printf("\n");
+	printf("\t--compile-genome <FILE> <FILE>\n");
+	printf("\t\t\tConvert a processed sequence file (-F), or a FASTA file of ORFs\n");
+	printf("\t\t\tafter -Fg/-Fm, into a compiled binary genome and exit. Compiled\n");
+	printf("\t\t\tgenomes load in milliseconds and are shared through the page\n");
+	printf("\t\t\tcache by concurrent runs.\n");
+	printf("\t\t\tExample: ./bin/SMoPT --compile-genome S.cer.genom S.cer.sgb\n");
+	printf("\n");
+	printf("\t-p[INTEGER]	Specify which output files to print\n");
+	printf("\n");
+	printf("\t\t\t-p1:	Generates a file of average elongation times\n");
+	printf("\t\t\t	of all codons.\n");
+	printf("\n");
+	printf("\t\t\t-p2:	Generates a file of total average elongation\n");
+	printf("\t\t\t	time of each gene.\n");
+	printf("\n");
+	printf("\t\t\t-p3:	Generates a file of average time between initiation\n");
+	printf("\t\t\t	events on mRNAs of each gene.\n");
+	printf("\n");
+	printf("\t\t\t-p4:	Generates a file of average number of free ribosomes,\n");
+	printf("\t\t\t	and free tRNAs of each type.\n");
+	printf("\n");
+	printf("\t\t\t-p5:	Generates a file of the final state of all mRNAs in a cell.\n");
+	printf("\t\t\t	It contains the poistions of all bound ribosomes on mRNAs.\n");
+	printf("\n");
+	printf("\t\t\t-p6:	This generates two files:\n");
+	printf("\t\t\t	A file containing the amount of time wasted by stalled\n");
+	printf("\t\t\t	ribosomes on mRNAs of each gene.\n");
+	printf("\t\t\t	A file containing the time wasted by stalled ribosomes\n");
+	printf("\t\t\t	on each codon position of Gene 0 (first gene in the\n");
+	printf("\t\t\t	processed fasta file).\n");
+	printf("\t\t\t	Stalled ribosomes are added to these times only when their\n");
+	printf("\t\t\t	number changes, so this option costs little running time.\n");
+	printf("\n");
+	printf("\t\t\t-p7:	Generates a file of state of all mRNAs in a cell every second.\n");
+	printf("\t\t\t	This is similar to -p5 printed every second.\n");
+	printf("\n");
+	printf("\t\t\t-p8:	Generates afile of number of bound ribosomes at each position of a gene.\n");
+	printf("\n");
+	printf("\t\t\t-p9:	Generates a file of average (RPF and mRNA based) of bound ribosomes\n");
+	printf("\t\t\t	at each position of a gene.\n");
+	printf("\n");
+	printf("\t\t\t-pt:	Generates a binary file of the positions of all bound ribosomes\n");
+	printf("\t\t\t	every second after -Tb, written by a background thread. Frames are\n");
+	printf("\t\t\t	decoded with utilities/read.trajectory.pl\n");
+	printf("\n");
+	printf("\t\t\t-ps:	Generates a file of the time wasted by stalled ribosomes at each\n");
+	printf("\t\t\t	position of every gene (or of the genes given with -Fs).\n");
+	printf("\t\t\t	Only positions where ribosomes stalled are listed.\n");
+	printf("\n");
+}
+
+// Read in commandline arguments
+void Read_Commandline_Args(int argc, char *argv[])
+{	int i;
+	
+	for(i=1;i<argc;i++)
+	{	if(argv[i][0] == '-')
+		{	switch(argv[i][1])
+			{	case 'h':
+				case '-':
+					if(strcmp(argv[i],"--compile-genome") == 0)
+					{	if(i+2>=argc)
+						{	printf("\nInput and output files of --compile-genome not specified\n");
+							fflush(stdout);
+							Help_out();
+							exit(1);
+						}
+						Compile_Genome(argv[i+1], argv[i+2]);
+						exit(0);
+					}
+					fflush(stdout);
+					Help_out();
+					exit(1);
+					break;
+				case 'V':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nTotal space not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	tot_space = atof(argv[++i]);
+						
+						avail_space_t = (double)floor(tot_space/pow(char_len_tRNA,3));
+						avail_space_r = (double)floor(tot_space/pow(char_len_ribo,3));
+						
+						if(avail_space_r<1e3 || avail_space_t < 1e3)
+						{	printf("\nAvailable cytoplasmic space is too small\n\n");
+							fflush(stdout);
+							Help_out();
+							exit(1);
+						}
+						break;
+					}
+				case 'E':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nSimulation engine not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	i++;
+						if(strcmp(argv[i],"direct") == 0)
+						{	engine = ENGINE_DIRECT;
+						}
+						else if(strcmp(argv[i],"cr") == 0)
+						{	engine = ENGINE_CR;
+						}
+						else if(strcmp(argv[i],"nrm") == 0)
+						{	engine = ENGINE_NRM;
+						}
+						else
+						{	printf("\nInvalid simulation engine %s\n",argv[i]);
+							fflush(stdout);
+							Help_out();
+							exit(1);
+						}
+						break;
+					}
+				case 'G':
+					if(argv[i][2] == 's' && argv[i][3] == '\0' && i<argc-1)
+					{	first_stream = atoi(argv[++i]);
+						if(first_stream<0)
+						{	printf("\nRandom stream %d should be >= 0\n",first_stream);
+							fflush(stdout);
+							Help_out();
+							exit(1);
+						}
+						break;
+					}
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nRandom number generator not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	i++;
+						if(strcmp(argv[i],"mt19937") == 0)
+						{	rng_type = RNG_MT19937;
+						}
+						else if(strcmp(argv[i],"xoshiro") == 0)
+						{	rng_type = RNG_XOSHIRO;
+						}
+						else if(strcmp(argv[i],"pcg64") == 0)
+						{	rng_type = RNG_PCG64;
+						}
+						else if(strcmp(argv[i],"philox") == 0)
+						{	rng_type = RNG_PHILOX;
+						}
+						else
+						{	printf("\nInvalid random number generator %s\n",argv[i]);
+							fflush(stdout);
+							Help_out();
+							exit(1);
+						}
+						break;
+					}
+				case 's':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nSeed for RNG not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	seed = atoi(argv[++i]);
+						break;
+					}
+				case 'n':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nNumber of replicates not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	n_replicates = atoi(argv[++i]);
+						if(n_replicates<1)
+						{	printf("\nNumber of replicates should be positive (>0)\n\n");
+							fflush(stdout);
+							Help_out();
+							exit(1);
+						}
+						break;
+					}
+				case 'j':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nNumber of threads not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	n_threads = atoi(argv[++i]);
+						if(n_threads<1)
+						{	printf("\nNumber of threads should be positive (>0)\n\n");
+							fflush(stdout);
+							Help_out();
+							exit(1);
+						}
+						break;
+					}
+				case 'D':
+					if(i==argc-1)
+					{	printf("\nNumber of domains not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					switch(argv[i][2])
+					{	case '\0':
+							n_domains = atoi(argv[++i]);
+							if(n_domains<1)
+							{	printf("\nNumber of domains should be positive (>0)\n\n");
+								fflush(stdout);
+								Help_out();
+								exit(1);
+							}
+							break;
+						case 't':
+							domain_tol = atof(argv[++i]);
+							if(domain_tol<=0)
+							{	printf("\nTolerance of the domains %g should be > 0\n",domain_tol);
+								fflush(stdout);
+								Help_out();
+								exit(1);
+							}
+							break;
+						default:
+							printf("\nInvalid domain option %s\n",argv[i]);
+							fflush(stdout);
+							Help_out();
+							exit(1);
+					}
+					break;
+				case 't':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nTotal # of tRNAs not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	tot_tRNA = atoi(argv[++i]);
+						break;
+					}
+				case 'R':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nTotal # of ribosomes not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	tot_ribo = atoi(argv[++i]);
+						break;
+					}
+				case 'N':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nTotal # of genes not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	n_genes = atoi(argv[++i]);
+						if(n_genes<1)
+						{	printf("\nTotal # of genes %s should be at least 1\n", argv[i]);
+							fflush(stdout);
+							Help_out();
+							exit(1);
+						}
+						break;
+					}
+				case 'O':
+					if(argv[i][2] == 'c' && argv[i][3] == '\0' && i<argc-1)
+					{	if(strlen(argv[i+1]) >= sizeof(cache_dir))
+						{	printf("\nResult cache directory %s is too long\n",argv[i+1]);
+							fflush(stdout);
+							Help_out();
+							exit(1);
+						}
+						strcpy(cache_dir,argv[++i]);
+						break;
+					}
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nOutput prefix not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	strcpy(out_prefix,argv[++i]);
+						break;
+					}
+				case 'F':
+					if(i==argc-1)
+					{	printf("\nFasta file not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					switch(argv[i][2])
+					{	case '\0':
+							strcpy(fasta_file,argv[++i]);
+							break;
+						case 'f':
+							strcpy(orf_fasta_file,argv[++i]);
+							break;
+						case 'g':
+							strcpy(gcode_file,argv[++i]);
+							break;
+						case 'm':
+							strcpy(abndc_file,argv[++i]);
+							break;
+						case 's':
+							strcpy(stall_genes_file,argv[++i]);
+							break;
+						default:
+							printf("\nInvalid sequence file option %s\n",argv[i]);
+							fflush(stdout);
+							Help_out();
+							exit(1);
+					}
+					break;
+#ifdef SMOPT_BENCH
+				case 'B':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nNumber of events not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	bench_events = atol(argv[++i]);
+						break;
+					}
+#endif
+#ifdef SMOPT_TELEMETRY
+				case 'L':
+					if(i==argc-1)
+					{	printf("\nTelemetry file not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					switch(argv[i][2])
+					{	case '\0':
+							strcpy(telem_file,argv[++i]);
+							break;
+						case 'p':
+							telem_period = atof(argv[++i]);
+							break;
+						default:
+							printf("\nInvalid telemetry option %s\n",argv[i]);
+							fflush(stdout);
+							Help_out();
+							exit(1);
+					}
+					break;
+#endif
+				case 'J':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nState file not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	strcpy(state_file,argv[++i]);
+						break;
+					}
+				case 'S':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nSweep file not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	strcpy(sweep_file,argv[++i]);
+						break;
+					}
+				case 'W':
+					if((argv[i][2] != '\0' && strcmp(argv[i],"-Wc") != 0) || (i==argc-1) || strlen(argv[i+1])>=sizeof(server_socket))
+					{	printf("\nSocket of the job server not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	server_client = (argv[i][2] == 'c');
+						strcpy(server_socket,argv[++i]);
+						break;
+					}
+				case 'K':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nCheckpoint file not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	strcpy(ckpt_file,argv[++i]);
+						break;
+					}
+				case 'k':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nCheckpoint file to resume from not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	strcpy(resume_file,argv[++i]);
+						break;
+					}
+				case 'C':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nS.cer Code file not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	strcpy(code_file,argv[++i]);
+						break;
+					}
+				case 'x':
+					switch(argv[i][2])
+					{	case '1':
+							chx_rb_prob = atof(argv[++i]);
+							
+							if(chx_rb_prob<0)
+							{	printf("\nCycloheximide probability for bound ribosomes should be positive (>0)\n\n");
+								fflush(stdout);
+								Help_out();
+								exit(1);
+							}
+							break;
+						case '2':
+							chx_ds_rate = atof(argv[++i]);
+							
+							if(chx_ds_rate<0)
+							{	printf("\nCycloheximide dissociation rate from bound ribosomes should be positive (>0)\n\n");
+								fflush(stdout);
+								Help_out();
+								exit(1);
+							}
+							break;
+						default:
+							printf("\nInvalid CHX options\n");
+							fflush(stdout);
+							Help_out();
+							exit(1);
+							break;
+					}
+					break;
+				case 'y':
+					if((argv[i][2] != '\0') || (i==argc-1))
+					{	printf("\nHarringtonine rate for free ribosomes not specified or Incorrect usage\n");
+						fflush(stdout);
+						Help_out();
+						exit(1);
+					}
+					else
+					{	harr_rf_rate = atof(argv[++i]);
+						
+						if(harr_rf_rate<0)
+						{	printf("\nHarringtonine rate for free ribosomes should be positive (>0)\n\n");
+							fflush(stdout);
+							Help_out();
+							exit(1);
+						}
+						break;
+					}
+				case 'P':
+				case 'p':
+					switch(argv[i][2])
+					{	case '1':
+							printOpt[0]=1;		// Elongation times of all codons
+							break;
+						case '2':
+							printOpt[1]=1;		// Average total elongation time of all genes
+							break;
+						case '3':
+							printOpt[2]=1;		// Average time between initiation events of all genes
+							break;
+						case '4':
+							printOpt[3]=1;		// Average number of free ribosomes and tRNAs of each type
+							break;
+						case '5':
+							printOpt[4]=1;		// Final state of the system - positions on mRNAs bound by ribosomes
+							break;
+						case '6':
+							printOpt[5]=1;		// Amount of time spent by ribosomes stalled on each gene
+							break;
+						case '7':
+							printOpt[6]=1;		// Print internal state of the cell every second - positions on mRNAs bound by ribosomes
+							break;
+						case '8':
+							printOpt[7]=1;		// Final state of the system - positions on genes bound by ribosomes
+							break;
+						case '9':
+							printOpt[8]=1;		// Final state of the system - avg (RPF and mRNA normalized) ribosome densities
+							break;
+						case 't':
+							traj_opt=1;			// Binary trajectory of ribosome positions every second
+							break;
+						case 's':
+							stall_opt=1;		// Amount of time spent by ribosomes stalled at each position of every gene
+							break;
+						default:
+							printf("\nInvalid print options\n");
+							fflush(stdout);
 							Help_out();
 							exit(1);
 							break;
 					}
-				case 'T':
-					switch(argv[i][2])
-					{	case 't':
-							tot_time = atof(argv[++i]);
-							if(tot_time>MAX_TIME)
-							{	printf("\nTotal time for simulation exceeds maximum allowed time = %d\n",MAX_TIME);
-								fflush(stdout);
-								Help_out();
-								exit(1);
-							}
-							break;
-						case 'b':
-							thresh_time = atof(argv[++i]);
-							if(thresh_time<0)
-							{	printf("\nTime threshold %g should be > 0 and < Total time %g\n",thresh_time,tot_time);
-								fflush(stdout);
-								Help_out();
-								exit(1);
-							}
-							break;
-						case 'c':
-							chx_time = atof(argv[++i]);
-							if(chx_time<0)
-							{	printf("\nTime for cycloheximide action %g should be > 0\n",chx_time);
-								fflush(stdout);
-								Help_out();
-								exit(1);
-							}
-							break;
-						case 'h':
-							harr_time = atof(argv[++i]);
-							if(harr_time<0)
-							{	printf("\nTime for harringtonine action %g should be > 0\n",harr_time);
-								fflush(stdout);
-								Help_out();
-								exit(1);
-							}
-							break;
+					break;
+				case 'T':
+					switch(argv[i][2])
+					{	case 't':
+							tot_time = atof(argv[++i]);
+							if(tot_time>MAX_TIME)
+							{	printf("\nTotal time for simulation exceeds maximum allowed time = %d\n",MAX_TIME);
+								fflush(stdout);
+								Help_out();
+								exit(1);
+							}
+							break;
+						case 'b':
+							thresh_time = atof(argv[++i]);
+							if(thresh_time<0)
+							{	printf("\nTime threshold %g should be > 0 and < Total time %g\n",thresh_time,tot_time);
+								fflush(stdout);
+								Help_out();
+								exit(1);
+							}
+							break;
+						case 'c':
+							chx_time = atof(argv[++i]);
+							if(chx_time<0)
+							{	printf("\nTime for cycloheximide action %g should be > 0\n",chx_time);
+								fflush(stdout);
+								Help_out();
+								exit(1);
+							}
+							break;
+						case 'k':
+							ckpt_period = atof(argv[++i]);
+							if(ckpt_period<0)
+							{	printf("\nTime between checkpoints %g should be > 0\n",ckpt_period);
+								fflush(stdout);
+								Help_out();
+								exit(1);
+							}
+							break;
+						case 'l':
+						case 'v':
+							leap_eps = atof(argv[++i]);
+							if(leap_eps<=0)
+							{	printf("\nError control of the leaped burn-in %g should be > 0\n",leap_eps);
+								fflush(stdout);
+								Help_out();
+								exit(1);
+							}
+							leap_validate = (argv[i-1][2]=='v');
+							break;
+						case 'h':
+							harr_time = atof(argv[++i]);
+							if(harr_time<0)
+							{	printf("\nTime for harringtonine action %g should be > 0\n",harr_time);
+								fflush(stdout);
+								Help_out();
+								exit(1);
+							}
+							break;
+					}
+			}
+		}
+	}
+	
+	// A cell split into domains is simulated once, from the start and in one go
+	if(n_domains>1 && (n_replicates>1 || leap_validate==1 || traj_opt==1 || strcmp(state_file, "") != 0 || strcmp(ckpt_file, "") != 0 || strcmp(resume_file, "") != 0))
+	{	printf("\nDomains (-D) cannot be combined with -n, -Tv, -pt, -J, -K or -k\n");
+		fflush(stdout);
+		Help_out();
+		exit(1);
+	}
+	
+	// Points of a sweep fork from burn-ins kept in memory and write their own outputs
+	if(strcmp(sweep_file, "") != 0 && (n_replicates>1 || n_domains>1 || leap_validate==1 || traj_opt==1 || strcmp(ckpt_file, "") != 0 || strcmp(resume_file, "") != 0))
+	{	printf("\nA sweep (-S) cannot be combined with -n, -D, -Tv, -pt, -K or -k\n");
+		fflush(stdout);
+		Help_out();
+		exit(1);
+	}
+	
+	// Jobs of the server set their own parameters and keep their states in memory
+	if(strcmp(server_socket, "") != 0 && server_client == 0 && (strcmp(sweep_file, "") != 0 || n_replicates>1 || n_domains>1 || leap_validate==1 || traj_opt==1 || stall_opt==1
+		|| strcmp(state_file, "") != 0 || strcmp(ckpt_file, "") != 0 || strcmp(resume_file, "") != 0))
+	{	printf("\nThe job server (-W) cannot be combined with -S, -n, -D, -Tv, -pt, -ps, -J, -K or -k\n");
+		fflush(stdout);
+		Help_out();
+		exit(1);
+	}
+	
+	// Only the output files of a run are cached
+	if(strcmp(cache_dir, "") != 0 && (strcmp(server_socket, "") != 0 || strcmp(ckpt_file, "") != 0))
+	{	printf("\nThe result cache (-Oc) cannot be combined with -W, -Wc or -K\n");
+		fflush(stdout);
+		Help_out();
+		exit(1);
+	}
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Add the time a counter held its last value to its time integral (sum) and hold its new value from time t
+static inline void Avg_Update(double *sum, lazy_count *held, int value, double t)
+{	*sum += (double)held->value*(t - held->since);
+	held->value = value;
+	held->since = t;
+}
+
+// Start the time averages of a cell at time t with its current counters (Rf is passed as Cell_Run keeps it in a local)
+void Avg_Start(cell *C, int Rf, double t)
+{	int c1;
+	int n_genes = C->par.n_genes;
+	int n_stall_pos = C->par.n_stall_pos;
+	
+	C->avg_started = 1;
+	for(c1=0;c1<61;c1++)
+	{	C->Tf_held[c1].value = C->Tf[c1];
+		C->Tf_held[c1].since = t;
+	}
+	C->Rf_held.value = Rf;
+	C->Rf_held.since = t;
+	for(c1=0;c1<n_genes;c1++)
+	{	C->waste_held[c1].value = C->num_waste_ribo[c1];
+		C->waste_held[c1].since = t;
+	}
+	for(c1=0;c1<C->Gene[0].len;c1++)
+	{	C->waste_pos_held[c1].value = C->num_waste_ribo_pos[c1];
+		C->waste_pos_held[c1].since = t;
+	}
+	for(c1=0;c1<n_stall_pos;c1++)
+	{	C->stall_held[c1].since = t;
+	}
+}
+
+// Change the number of stalled ribosomes at position pos of gene g_id by d at time t (-ps)
+// The stalls of a position are added to its time integral only when they change
+// Every ribosome stalling behind another one or released from such a stall goes through here
+static inline void Stall_Pos_Add(cell *C, int g_id, int pos, int d, double t)
+{	lazy_count *held;
+	
+#ifdef SMOPT_TELEMETRY
+	if(d>0)
+	{	C->telem.n_stall++;
+	}
+	else
+	{	C->telem.n_unstall++;
+	}
+#endif
+	if(C->par.stall_off == NULL || C->par.stall_off[g_id] < 0)
+	{	return;
+	}
+	held = &C->stall_held[C->par.stall_off[g_id]+pos];
+	if(C->avg_started==1)
+	{	Avg_Update(&C->stall_time[C->par.stall_off[g_id]+pos], held, held->value+d, t);
+	}
+	else
+	{	held->value += d;
+	}
+}
+
+// Add the time from the last change of each counter to the current time of the cell to the time averages
+void Avg_Flush(cell *C)
+{	int c1;
+	int n_genes = C->par.n_genes;
+	int *printOpt = C->par.printOpt;
+	int n_stall_pos = C->par.n_stall_pos;
+	
+	if(C->avg_started==0)
+	{	return;
+	}
+	if(printOpt[3]==1)
+	{	for(c1=0;c1<61;c1++)
+		{	Avg_Update(&C->avg_tRNA_abndc[c1], &C->Tf_held[c1], C->Tf[c1], C->t);
+		}
+		Avg_Update(&C->avg_Rf, &C->Rf_held, C->Rf, C->t);
+	}
+	if(printOpt[5]==1)
+	{	for(c1=0;c1<n_genes;c1++)
+		{	Avg_Update(&C->time_waste_ribo[c1], &C->waste_held[c1], C->num_waste_ribo[c1], C->t);
+		}
+		for(c1=0;c1<C->Gene[0].len;c1++)
+		{	Avg_Update(&C->time_waste_ribo_pos[c1], &C->waste_pos_held[c1], C->num_waste_ribo_pos[c1], C->t);
+		}
+	}
+	for(c1=0;c1<n_stall_pos;c1++)
+	{	Avg_Update(&C->stall_time[c1], &C->stall_held[c1], C->stall_held[c1].value, C->t);
+	}
+}
+
+
+
+int Traj_Compare(const void *a, const void *b)
+{	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+	
+	return (x > y) - (x < y);
+}
+
+// Sort, encode and write the frames queued by Traj_Frame until Traj_Close
+void *Traj_Thread(void *arg)
+{	traj_writer *W = (traj_writer *)arg;
+	traj_frame *f;
+	uint64_t prev, gap;
+	uint32_t n, n_bytes;
+	int c1;
+	
+	pthread_mutex_lock(&W->lock);
+	while(1)
+	{	while(W->n_queued == 0 && !W->done)
+		{	pthread_cond_wait(&W->cond, &W->lock);
+		}
+		if(W->n_queued == 0)
+		{	break;
+		}
+		f = &W->frame[W->head];
+		pthread_mutex_unlock(&W->lock);
+		
+		qsort(f->pos, f->n, sizeof(uint64_t), Traj_Compare);
+		n_bytes = 0;
+		prev = 0;
+		for(c1=0;c1<f->n;c1++)
+		{	gap = f->pos[c1] - prev;
+			prev = f->pos[c1];
+			while(gap >= 128)
+			{	W->buf[n_bytes++] = (uint8_t)(gap | 128);
+				gap >>= 7;
+			}
+			W->buf[n_bytes++] = (uint8_t)gap;
+		}
+		n = f->n;
+		if(fwrite(&f->t, sizeof(double), 1, W->fh) != 1 || fwrite(&n, sizeof(uint32_t), 1, W->fh) != 1 || fwrite(&n_bytes, sizeof(uint32_t), 1, W->fh) != 1 || fwrite(W->buf, 1, n_bytes, W->fh) != n_bytes)
+		{	W->failed = 1;
+		}
+		
+		pthread_mutex_lock(&W->lock);
+		W->head = (W->head+1) % TRAJ_QUEUE;
+		W->n_queued--;
+		pthread_cond_broadcast(&W->cond);
+	}
+	pthread_mutex_unlock(&W->lock);
+	return NULL;
+}
+
+// Create the trajectory file of a cell and start its writer thread
+// The header lists the gene and the length of every mRNA so that frames can be decoded without the genome
+traj_writer *Traj_Open(char *filename, transcript *mRNA, gene *Gene)
+{	traj_writer *W;
+	uint32_t head[2];
+	int c1;
+	
+	W = (traj_writer *)calloc(1, sizeof(traj_writer));
+	if(W == NULL)
+	{	printf("Out of memory\n");fflush(stdout);
+		exit(1);
+	}
+	W->fh = Output_Open(filename,"wb");
+	if(W->fh == NULL)
+	{	printf("\nCould not write trajectory file %s\n",filename);fflush(stdout);
+		exit(1);
+	}
+	
+	W->mRNA_off = (uint64_t *)malloc(sizeof(uint64_t) * (tot_mRNA+1));
+	W->buf = (uint8_t *)malloc(10 * (size_t)tot_ribo);
+	if(W->mRNA_off == NULL || W->buf == NULL)
+	{	printf("Too many ribosomes\nOut of memory\n");fflush(stdout);
+		exit(1);
+	}
+	for(c1=0;c1<TRAJ_QUEUE;c1++)
+	{	W->frame[c1].pos = (uint64_t *)malloc(sizeof(uint64_t) * tot_ribo);
+		if(W->frame[c1].pos == NULL)
+		{	printf("Too many ribosomes\nOut of memory\n");fflush(stdout);
+			exit(1);
+		}
+	}
+	
+	fwrite(TRAJ_MAGIC, 1, 8, W->fh);
+	head[0] = TRAJ_VERSION;
+	head[1] = tot_mRNA;
+	fwrite(head, sizeof(uint32_t), 2, W->fh);
+	W->mRNA_off[0] = 0;
+	for(c1=0;c1<tot_mRNA;c1++)
+	{	head[0] = mRNA[c1].gene;
+		head[1] = Gene[mRNA[c1].gene].len;
+		fwrite(head, sizeof(uint32_t), 2, W->fh);
+		W->mRNA_off[c1+1] = W->mRNA_off[c1] + Gene[mRNA[c1].gene].len;
+	}
+	
+	pthread_mutex_init(&W->lock, NULL);
+	pthread_cond_init(&W->cond, NULL);
+	if(pthread_create(&W->thread, NULL, Traj_Thread, W) != 0)
+	{	printf("\nCould not start trajectory writer thread\n");fflush(stdout);
+		exit(1);
+	}
+	return W;
+}
+
+// Queue a frame with the codons bound by the ribosomes 0...n_bound-1 (as in grid)
+// Only the positions are copied here; sorting, encoding and writing are left to the writer thread
+void Traj_Frame(traj_writer *W, double t, ribo_site *Ribo, int n_bound, ribogrid *grid)
+{	traj_frame *f;
+	int c1;
+	
+	pthread_mutex_lock(&W->lock);
+	while(W->n_queued == TRAJ_QUEUE)
+	{	pthread_cond_wait(&W->cond, &W->lock);
+	}
+	f = &W->frame[(W->head+W->n_queued) % TRAJ_QUEUE];
+	pthread_mutex_unlock(&W->lock);
+	
+	f->t = t;
+	f->n = 0;
+	for(c1=0;c1<n_bound;c1++)
+	{	if(Grid_Get(grid, Ribo[c1].mRNA, Ribo[c1].pos) == c1)
+		{	f->pos[f->n] = W->mRNA_off[Ribo[c1].mRNA] + Ribo[c1].pos;
+			f->n++;
+		}
+	}
+	
+	pthread_mutex_lock(&W->lock);
+	W->n_queued++;
+	pthread_cond_broadcast(&W->cond);
+	pthread_mutex_unlock(&W->lock);
+}
+
+// Write the remaining frames and close the trajectory file
+void Traj_Close(traj_writer *W)
+{	int c1;
+	
+	pthread_mutex_lock(&W->lock);
+	W->done = 1;
+	pthread_cond_broadcast(&W->cond);
+	pthread_mutex_unlock(&W->lock);
+	pthread_join(W->thread, NULL);
+	
+	if(fclose(W->fh) != 0 || W->failed)
+	{	printf("\nTrajectory file could not be written completely\n");fflush(stdout);
+	}
+	pthread_mutex_destroy(&W->lock);
+	pthread_cond_destroy(&W->cond);
+	for(c1=0;c1<TRAJ_QUEUE;c1++)
+	{	free(W->frame[c1].pos);
+	}
+	free(W->mRNA_off);
+	free(W->buf);
+	free(W);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Parameters given on the command line
+void Par_Default(cell_par *P)
+{	P->tot_ribo = tot_ribo;
+	P->tot_tRNA = tot_tRNA;
+	P->tot_space = tot_space;
+	P->avail_space_t = avail_space_t;
+	P->avail_space_r = avail_space_r;
+	P->chx_rb_prob = chx_rb_prob;
+	P->chx_ds_rate = chx_ds_rate;
+	P->harr_rf_rate = harr_rf_rate;
+	P->chx_time = chx_time;
+	P->harr_time = harr_time;
+	P->n_genes = n_genes;
+	P->tot_time = tot_time;
+	P->thresh_time = thresh_time;
+	P->engine = engine;
+	P->rng_type = rng_type;
+	P->seed = seed;
+	P->leap_eps = leap_eps;
+	memcpy(P->printOpt, printOpt, sizeof(printOpt));
+	P->state_file = state_file;
+	P->stall_off = stall_off;
+	P->n_stall_pos = n_stall_pos;
+}
+
+// Free a cell, also one whose setup ran out of memory
+void Cell_Free(cell *C)
+{	int c1;
+	int n_genes = C->par.n_genes;
+	
+	for(c1=0;c1<62 && C->Rb_e!=NULL;c1++)
+	{	free(C->Rb_e[c1]);
+	}
+	for(c1=0;c1<n_genes && C->free_mRNA!=NULL;c1++)
+	{	free(C->free_mRNA[c1]);
+	}
+	for(c1=0;c1<n_genes && C->gene_sp_ribo_500!=NULL;c1++)
+	{	free(C->gene_sp_ribo_500[c1]);
+	}
+	free(C->Rb_e);
+	free(C->free_mRNA);
+	free(C->gene_sp_ribo_500);
+	free(C->Ribo.site);
+	free(C->Ribo.elng);
+	free(C->Ribo.t_trans_ini);
+	free(C->Ribo.t_elong_ini);
+	free(C->mRNA);
+	free(C->chx_r_id);
+	free(C->Mf);
+	free(C->num_waste_ribo);
+	free(C->num_waste_ribo_pos);
+	free(C->time_waste_ribo);
+	free(C->time_waste_ribo_pos);
+	free(C->waste_held);
+	free(C->waste_pos_held);
+	free(C->stall_held);
+	free(C->stall_time);
+	free(C->leap_order);
+	free(C->leap_first);
+	free(C->leap_stall);
+	free(C->leap_ini);
+	for(c1=0;c1<2;c1++)
+	{	free(C->leap_s[c1]);
+		free(C->leap_p[c1]);
+	}
+	free(C->num_stall_chx);
+	Grid_Free(&C->R_grid);
+	Prop_Table_Free(&C->gene_prop);
+	Prop_Table_Free(&C->chn_prop);
+	
+	if(C->r != NULL)
+	{	Rng_Free(C->r);
+	}
+}
+
+// Set up a cell with all ribosomes free and all mRNAs initiable, or in the state read from state_file (-J)
+// Gene and code are only read, so several cells can be set up at the same time from the same inputs.
+// The cell is simulated with the parameters par, or those of the command line if par is NULL, and draws from
+// the random stream of replicate rep and partition part. Returns 0 if out of memory, with the cell freed.
+int Cell_Init(cell *C, gene *Gene, trna *code, int rep, int part, cell_par *par)
+{	int c1, c2, c3, c4;
+	int r_id, m_id, c_id;
+	int tot_gcn=0;
+	
+	memset(C, 0, sizeof(cell));						// Nothing allocated yet, so a failed setup can be freed
+	C->Gene = Gene;
+	memcpy(C->cTRNA, code, sizeof(trna) * 61);
+	if(par != NULL)
+	{	C->par = *par;
+	}
+	else
+	{	Par_Default(&C->par);
+	}
+	int tot_ribo = C->par.tot_ribo;				// Parameters of this cell in place of the command-line ones
+	int tot_tRNA = C->par.tot_tRNA;
+	double avail_space_t = C->par.avail_space_t;
+	int n_genes = C->par.n_genes;
+	double thresh_time = C->par.thresh_time;
+	int engine = C->par.engine;
+	int seed = C->par.seed;
+	double leap_eps = C->par.leap_eps;
+	char *state_file = C->par.state_file;
+	int n_stall_pos = C->par.n_stall_pos;
+	
+	// Random number generation setup
+	C->seed = seed+rep+part;
+	C->rep = rep;
+	C->part = part;
+	C->r = Rng_Alloc(C->par.rng_type, (unsigned long) seed, rep, part);
+	if(C->r == NULL)
+	{	return 0;
+	}
+	
+	// Initialize the various structures
+	C->Ribo.site = (ribo_site *)calloc(tot_ribo, sizeof(ribo_site));
+	C->Ribo.elng = (ribo_elng *)calloc(tot_ribo, sizeof(ribo_elng));
+	C->Ribo.t_trans_ini = (double *)calloc(tot_ribo, sizeof(double));
+	C->Ribo.t_elong_ini = (double *)calloc(tot_ribo, sizeof(double));
+	C->chx_r_id = (int *)malloc(sizeof(int) * tot_ribo);
+	if(C->Ribo.site == NULL || C->Ribo.elng == NULL || C->Ribo.t_trans_ini == NULL || C->Ribo.t_elong_ini == NULL || C->chx_r_id == NULL)
+	{	Cell_Free(C);
+		return 0;
+	}
+	
+	C->n_mRNA = 0;
+	for(c1=0;c1<n_genes;c1++)
+	{	C->n_mRNA += Gene[c1].exp;
+	}
+	C->mRNA = (transcript *)malloc(sizeof(transcript) * C->n_mRNA);
+	if(C->mRNA == NULL)
+	{	Cell_Free(C);
+		return 0;
+	}
+	
+	C->Mf = (int *)malloc(sizeof(int) * n_genes);
+	C->num_waste_ribo = (int *)calloc(n_genes, sizeof(int));				// Initialize stalled ribosomes and time spent
+	C->num_stall_chx = (int *)calloc(n_genes, sizeof(int));
+	C->time_waste_ribo = (double *)calloc(n_genes, sizeof(double));
+	C->num_waste_ribo_pos = (int *)calloc(Gene[0].len, sizeof(int));		// at specific positions of gene 1
+	C->time_waste_ribo_pos = (double *)calloc(Gene[0].len, sizeof(double));
+	C->waste_held = (lazy_count *)calloc(n_genes, sizeof(lazy_count));
+	C->waste_pos_held = (lazy_count *)calloc(Gene[0].len, sizeof(lazy_count));
+	C->stall_held = (lazy_count *)calloc(n_stall_pos+1, sizeof(lazy_count));		// Positions tracked with -ps
+	C->stall_time = (double *)calloc(n_stall_pos+1, sizeof(double));
+	C->free_mRNA = (int **)calloc(n_genes, sizeof(int *));
+	C->gene_sp_ribo_500 = (int **)calloc(n_genes, sizeof(int *));
+	C->Rb_e = (int **)calloc(62, sizeof(int *));
+	if(C->Mf == NULL || C->num_waste_ribo == NULL || C->num_stall_chx == NULL || C->time_waste_ribo == NULL || C->num_waste_ribo_pos == NULL || C->time_waste_ribo_pos == NULL || C->waste_held == NULL || C->waste_pos_held == NULL || C->stall_held == NULL || C->stall_time == NULL || C->free_mRNA == NULL || C->gene_sp_ribo_500 == NULL || C->Rb_e == NULL)
+	{	Cell_Free(C);
+		return 0;
+	}
+	
+	trna *cTRNA = C->cTRNA;
+	ribo_site *Ribo = C->Ribo.site;
+	ribo_elng *Ribo_e = C->Ribo.elng;
+	transcript *mRNA = C->mRNA;
+	ribogrid *R_grid = &C->R_grid;
+	int *Tf = C->Tf;
+	int *Mf = C->Mf;
+	int **free_mRNA = C->free_mRNA;
+	int **Rb_e = C->Rb_e;
+	int *n_Rb_e = C->n_Rb_e;
+	int *num_waste_ribo = C->num_waste_ribo;
+	int *num_waste_ribo_pos = C->num_waste_ribo_pos;
+	int (*tRNA_cod)[61] = C->tRNA_cod;
+	int *n_tRNA_cod = C->n_tRNA_cod;
+	
+	c3=0;
+	for(c1=0;c1<n_genes;c1++)					// Fill the mRNA struct with
+	{	for(c2=0;c2<Gene[c1].exp;c2++)			// length and ini_rate info.
+		{	mRNA[c3].gene = c1;
+			mRNA[c3].ini_n = 0;
+			mRNA[c3].last_ini = 0.0;
+			mRNA[c3].trans_n = 0;
+			mRNA[c3].avg_time_to_ini = 0.0;
+			mRNA[c3].avg_time_to_trans = 0.0;
+			c3++;
+		}
+	}
+	
+	// Variables to track the translation process
+	C->t = 0.0;
+	C->Rf = tot_ribo;							// At start all ribosomes are free
+	C->Rfh = 0;
+	C->pool_scale = 1.0;
+	C->next_avail_ribo = 0;
+	C->tot_stall_chx = 0;
+	C->avg_Rf = 0.0;
+	C->avg_started = 0;
+	C->leap_order = NULL;
+	C->leap_first = NULL;
+	C->leap_stall = NULL;
+	C->leap_ini = NULL;
+	C->leap_s[0] = C->leap_s[1] = NULL;
+	C->leap_p[0] = C->leap_p[1] = NULL;
+	C->leap_n = 0;
+	C->leap_events = 0;
+	C->leap_dropped = 0;
+#ifdef SMOPT_BENCH
+	memset(&C->bench, 0, sizeof(bench_stats));
+#endif
+	C->t_print = floor(thresh_time);
+	C->events_left = 0;
+	C->traj = NULL;
+	C->obs_max_len = 0;
+	C->obs_max_exp = 0;
+	
+	for(c1=0;c1<62;c1++)
+	{	Rb_e[c1] = (int *)malloc(sizeof(int) * tot_ribo);
+		if(Rb_e[c1] == NULL)
+		{	Cell_Free(C);
+			return 0;
+		}
+	}
+	
+	for(c1=0;c1<n_genes;c1++)
+	{	if(Gene[c1].exp > C->obs_max_exp)
+		{	C->obs_max_exp = Gene[c1].exp;
+		}
+		if(Gene[c1].len > C->obs_max_len)
+		{	C->obs_max_len = Gene[c1].len;
+		}
+		Mf[c1] = Gene[c1].exp;
+		
+		C->gene_sp_ribo_500[c1] = (int *)calloc(Gene[c1].len, sizeof(int));
+		if(C->gene_sp_ribo_500[c1] == NULL)
+		{	Cell_Free(C);
+			return 0;
+		}
+	}
+	if(leap_eps > 0)
+	{	C->leap_order = (int *)malloc(sizeof(int) * tot_ribo);
+		C->leap_stall = (int *)malloc(sizeof(int) * tot_ribo);
+		C->leap_first = (int *)malloc(sizeof(int) * (C->n_mRNA+1));
+		C->leap_ini = (uint8_t *)malloc(C->n_mRNA);
+		for(c1=0;c1<2;c1++)
+		{	C->leap_s[c1] = (double *)malloc(sizeof(double) * (C->obs_max_len+1));		// A ribosome moves at most len times
+			C->leap_p[c1] = (int *)malloc(sizeof(int) * (C->obs_max_len+1));
+		}
+		if(C->leap_order == NULL || C->leap_stall == NULL || C->leap_first == NULL || C->leap_ini == NULL
+			|| C->leap_s[0] == NULL || C->leap_s[1] == NULL || C->leap_p[0] == NULL || C->leap_p[1] == NULL)
+		{	Cell_Free(C);
+			return 0;
+		}
+	}
+	
+	for(c1=0;c1<n_genes;c1++)								// List to figure out which mRNAs can be initiated based on no bound ribosomes from pos=0->pos=10
+	{	free_mRNA[c1] = (int *)malloc(sizeof(int) * C->obs_max_exp);
+		if(free_mRNA[c1] == NULL)
+		{	Cell_Free(C);
+			return 0;
+		}
+	}
+
+	// Initialize free mRNAs
+	c3=0;
+	for(c2=0;c2<n_genes;c2++)
+	{	for(c1=0;c1<Gene[c2].exp;c1++)
+		{	free_mRNA[c2][c1]=c3;							// At the begininning all mRNAs can be initiated (store their ids here)
+			c3++;
+		}
+	}
+	
+	// Initialize free tRNAs and elongation time vectors
+	for(c1=0;c1<61;c1++)
+	{	if(cTRNA[c1].wobble==1.0)
+		{	tot_gcn += cTRNA[c1].gcn;
+		}
+		C->e_times[c1] = 0.0;
+		C->n_e_times[c1] = 0;
+		
+		Tf[c1]=0;
+		C->avg_tRNA_abndc[c1]=0.0;
+	}
+		
+	for(c1=0;c1<61;c1++)
+	{	if(cTRNA[c1].wobble==1.0)
+		{	Tf[cTRNA[c1].tid] = floor((double)cTRNA[c1].gcn*tot_tRNA/tot_gcn);			// Number of tRNAs for tRNA-type cTRNA[c1].tid
+		}
+		n_Rb_e[c1] = 0;															// Initialize number of elongatable bound ribosomes to each codon
+		cTRNA[c1].wobble = cTRNA[c1].wobble/(char_time_tRNA*avail_space_t);		// For faster computation
+	}
+	
+	// Initialize R_grid
+	// R_grid now contains the id of ribosome at each mRNA position.
+	// If there is no ribosome then that position get the value tot_ribo instead of 0 as 0 is a ribosome id
+	if(Grid_Init(R_grid, mRNA, Gene, C->n_mRNA, tot_ribo) == 0)
+	{	Cell_Free(C);
+		return 0;
+	}
+
+	// If state file is provided, reinitialize the variables and arrays
+	if(strcmp(state_file, "") != 0)												// Read in the state of the system
+	{	Read_STATE_File(state_file, R_grid, C->n_mRNA);
+
+		m_id = 0;																// mRNA id
+		r_id = 0;																// Ribosome id
+		for(c1=0;c1<n_genes;c1++)
+		{	for(c4=0;c4<Gene[c1].exp;c4++)
+			{	for(c2=0;c2<10;c2++)											// For first 10 codons - check if mRNA is initiable
+				{	if(Grid_Get(R_grid, m_id, c2)!=tot_ribo)
+					{	Grid_Set(R_grid, m_id, c2, r_id);
+						
+						Ribo[r_id].mRNA = m_id;
+						Ribo[r_id].pos = c2;
+						Ribo_e[r_id].inhbtr_bound = 0;
+						
+						c_id = Gene[mRNA[m_id].gene].seq[c2];					// Codon identity
+						if(c2>0)
+						{	Tf[cTRNA[Gene[mRNA[m_id].gene].seq[c2-1]].tid]--;
+						}
+						
+						if(Grid_Get(R_grid, m_id, c2+10)==tot_ribo)						// Check if the current ribosome can be elongated
+						{	Rb_e[c_id][n_Rb_e[c_id]] = r_id;					// If no ribosome at pos+10 then it can
+							Ribo_e[r_id].elng_cod_list = c_id;
+							Ribo_e[r_id].elng_pos_list = n_Rb_e[c_id];
+							n_Rb_e[c_id]++;
+						}
+						else
+						{	num_waste_ribo[mRNA[m_id].gene]++;
+							Stall_Pos_Add(C, mRNA[m_id].gene, c2, 1, 0);
+							if(mRNA[m_id].gene==0)
+							{	num_waste_ribo_pos[c2]++;
+							}
+						}
+						
+						Mf[c1]--;												// These mRNAs are not initiable
+						if(c4!=Mf[c1])
+						{	free_mRNA[c1][c4] = free_mRNA[c1][Mf[c1]];			// Accounting of free mRNAs for next round
+						}
+						
+						r_id++;
+						C->Rf--;
+					}
+				}
+				for(c2=10;c2<Gene[mRNA[m_id].gene].len;c2++)
+				{	if(Grid_Get(R_grid, m_id, c2)!=tot_ribo)
+					{	Grid_Set(R_grid, m_id, c2, r_id);
+						
+						Ribo[r_id].mRNA = m_id;
+						Ribo[r_id].pos = c2;
+						Ribo_e[r_id].inhbtr_bound = 0;
+						
+						c_id = Gene[mRNA[m_id].gene].seq[c2];									// Codon identity
+						Tf[cTRNA[Gene[mRNA[m_id].gene].seq[c2-1]].tid]--;
+						
+						if(Grid_Get(R_grid, m_id, c2+10)==tot_ribo || (c2+11)>=Gene[mRNA[m_id].gene].len)	// Check if the current ribosome can be elongated
+						{	Rb_e[c_id][n_Rb_e[c_id]] = r_id;									// If no ribosome at pos+10 then it can
+							Ribo_e[r_id].elng_cod_list = c_id;
+							Ribo_e[r_id].elng_pos_list = n_Rb_e[c_id];
+							n_Rb_e[c_id]++;
+						}
+						else
+						{	num_waste_ribo[mRNA[m_id].gene]++;
+							Stall_Pos_Add(C, mRNA[m_id].gene, c2, 1, 0);
+							if(mRNA[m_id].gene==0)
+							{	num_waste_ribo_pos[c2]++;
+							}
+						}
+						
+						r_id++;
+						C->Rf--;
+					}
+				}
+				m_id++;
+			}
+		}
+		
+		C->next_avail_ribo = r_id;
+	}
+	
+	// Initialize the propensities of all reaction channels
+	if(Prop_Table_Init(&C->gene_prop, n_genes, (engine == ENGINE_NRM) ? ENGINE_DIRECT : engine, C->r) == 0		// Genes are picked after the initiation channel fires
+		|| Prop_Table_Init(&C->chn_prop, N_CHN, engine, C->r) == 0)
+	{	Cell_Free(C);
+		return 0;
+	}
+	for(c1=0;c1<n_genes;c1++)
+	{	Prop_Table_Set(&C->gene_prop, c1, (double)Mf[c1]*Gene[c1].ini_prob);		// Scale gene_exp with ini_prob
+	}
+	
+	for(c1=0;c1<61;c1++)
+	{	n_tRNA_cod[c1] = 0;
+	}
+	for(c1=0;c1<61;c1++)
+	{	c2 = cTRNA[c1].tid;
+		tRNA_cod[c2][n_tRNA_cod[c2]] = c1;
+		n_tRNA_cod[c2]++;
+		Prop_Table_Set(&C->chn_prop, CHN_ELNG+c1, C->pool_scale*Tf[cTRNA[c1].tid]*cTRNA[c1].wobble*(double)n_Rb_e[c1]);
+	}
+#ifdef SMOPT_TELEMETRY
+	memset(&C->telem, 0, sizeof(telem_stats));
+	clock_gettime(CLOCK_MONOTONIC, &C->telem.start_wall);
+	C->telem.last_wall = C->telem.start_wall;
+#endif
+	return 1;
+}
+
+
+
+#ifdef SMOPT_TELEMETRY
+// Write the progress of a cell as one line of JSON to the telemetry file (-L) if telem_period wall seconds
+// have passed since the last report, or always if final is set. Rates are over the time since the last report.
+// t, Rf and Rfh are passed as Cell_Run keeps them in locals.
+void Telemetry_Report(cell *C, double t, int Rf, int Rfh, int final)
+{	int c1;
+	long n_stalled = 0;
+	double wall, dwall, sim_rate;
+	struct timespec now;
+	char line[1024];
+	int n;
+	
+	if(telem_fh == NULL)
+	{	return;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	dwall = Clock_Elapsed(&C->telem.last_wall, &now);
+	if(final==0 && dwall<telem_period)
+	{	return;
+	}
+	wall = Clock_Elapsed(&C->telem.start_wall, &now);
+	for(c1=0;c1<C->par.n_genes;c1++)
+	{	n_stalled += C->num_waste_ribo[c1];
+	}
+	sim_rate = (dwall>0) ? (t-C->telem.last_t)/dwall : 0;
+	
+	n = snprintf(line, sizeof(line), "{\"replicate\":%d,\"wall_s\":%.3f,\"t\":%.6g,\"tot_time\":%g,\"events\":%ld,\"events_per_s\":%.6g,\"sim_s_per_wall_s\":%.6g,\"eta_s\":%.6g,",
+		C->rep+C->part, wall, t, C->par.tot_time, C->telem.n_events, (dwall>0) ? (C->telem.n_events-C->telem.last_events)/dwall : 0, sim_rate, (sim_rate>0) ? fmax(C->par.tot_time-t, 0)/sim_rate : -1);
+	n += snprintf(line+n, sizeof(line)-n, "\"Rf\":%d,\"Rfh\":%d,\"bound\":%d,\"stalled\":%ld,\"stalled_chx\":%d,\"tot_rate\":%.6g,\"counts\":{",
+		Rf, Rfh, C->par.tot_ribo-Rf, n_stalled, C->tot_stall_chx, Prop_Table_Total(&C->chn_prop));
+	for(c1=0;c1<EV_TYPES;c1++)
+	{	n += snprintf(line+n, sizeof(line)-n, "\"%s\":%ld,", ev_names[c1], C->telem.n[c1]);
+	}
+	snprintf(line+n, sizeof(line)-n, "\"stall\":%ld,\"unstall\":%ld}%s}\n", C->telem.n_stall, C->telem.n_unstall, (final==1) ? ",\"done\":1" : "");
+	fputs(line, telem_fh);											// One call per line, so lines of replicates running in threads do not mix
+	fflush(telem_fh);
+	
+	C->telem.last_events = C->telem.n_events;
+	C->telem.last_t = t;
+	C->telem.last_wall = now;
+}
+#endif
+
+
+
+// Set the elongation propensities of all codons from the elongatable ribosomes and free tRNAs of the cell
+void Refresh_Elng_Prop(cell *C)
+{	int c1;
+	
+	for(c1=0;c1<61;c1++)
+	{	Prop_Table_Set(&C->chn_prop, CHN_ELNG+c1, C->pool_scale*C->Tf[C->cTRNA[c1].tid]*C->cTRNA[c1].wobble*(double)C->n_Rb_e[c1]);
+	}
+}
+
+// Stall (d=1) or release (d=-1) a ribosome at pos of an mRNA of gene g_id during a leap of the burn-in
+static inline void Leap_Stall(cell *C, int g_id, int pos, int d)
+{	C->num_waste_ribo[g_id] += d;
+	Stall_Pos_Add(C, g_id, pos, d, C->t);
+	if(g_id==0)
+	{	C->num_waste_ribo_pos[pos] += d;
+	}
+}
+
+// Move ribosome r_id during a leap of the burn-in, from time s of the leap up to its end tau, behind the ribosome
+// that moved to fp[k] at time fs[k] (k=1...nf, fp[0] is its position at the start; fp NULL if there is none)
+// A ribosome at pos moves as soon as the one ahead leaves pos+10, after a waiting time drawn with the rate of
+// its codon in k_cod. Its times and positions are stored in ms and mp, mp[0] being its starting position, and
+// a terminated ribosome ends at len with its mRNA set to -1. Returns the number of moves.
+static int Leap_Walk(cell *C, int r_id, double s, double tau, const double *k_cod, const double *fs, const int *fp, int nf, double *ms, int *mp)
+{	int m_id = C->Ribo.site[r_id].mRNA;
+	gene *G = &C->Gene[C->mRNA[m_id].gene];
+	int pos = C->Ribo.site[r_id].pos;
+	int n = 0, kf = 0;
+	int tid;
+	
+	ms[0] = s;
+	mp[0] = pos;
+	if(C->Ribo.elng[r_id].inhbtr_bound==1)									// Held by harringtonine
+	{	return 0;
+	}
+	while(1)
+	{	if(fp!=NULL && pos+10<G->len)
+		{	while(kf<=nf && fp[kf]<=pos+10)
+			{	kf++;
+			}
+			if(kf>nf)															// Stalled till the end of the leap
+			{	break;
+			}
+			s = fmax(s, fs[kf]);
+		}
+		if(k_cod[G->seq[pos]]<=0)
+		{	break;
+		}
+		s -= log(Rng_Uniform_Pos(C->r))/k_cod[G->seq[pos]];
+		if(s>tau)
+		{	break;
+		}
+		if(pos<G->len-1)
+		{	tid = C->cTRNA[G->seq[pos]].tid;
+			if(C->Tf[tid]<=0)
+			{	C->leap_dropped++;
+				break;
+			}
+			C->Tf[tid]--;
+		}
+		if(pos>0)
+		{	C->Tf[C->cTRNA[G->seq[pos-1]].tid]++;
+		}
+		Grid_Set(&C->R_grid, m_id, pos, C->par.tot_ribo);
+		pos++;
+		n++;
+		ms[n] = s;
+		mp[n] = pos;
+		if(pos==G->len)															// Termination
+		{	C->Rf++;
+			C->Ribo.site[r_id].mRNA = -1;
+			break;
+		}
+		Grid_Set(&C->R_grid, m_id, pos, r_id);
+		C->Ribo.t_elong_ini[r_id] = C->t+s;
+	}
+	C->Ribo.site[r_id].pos = pos;
+	return n;
+}
+
+// Time at which a ribosome with the moves ms, mp (n moves) reached codon 11, making its mRNA initiable, or INFINITY
+static inline double Leap_Cleared(const double *ms, const int *mp, int n)
+{	int c1;
+	
+	for(c1=1;c1<=n;c1++)
+	{	if(mp[c1]==10)
+		{	return ms[c1];
+		}
+	}
+	return INFINITY;
+}
+
+// Leap of the burn-in from the time of the cell up to t_stop at the latest (-Tl)
+// The free tRNAs and ribosomes are held at their values at the start of the leap in the rates, and every mRNA
+// is then simulated on its own over the leap: its ribosomes move front first, each as soon as the one ahead
+// lets it, and new ones initiate as soon as the first 10 codons are free. With frozen pools the mRNAs do not
+// depend on each other, so this is exact but for the pools, and each ribosome is moved in one go. The leap is
+// chosen so that each free pool is expected to change by less than leap_eps of its size (Cao, Gillespie and
+// Petzold 2006), with the expected change and its variance from the initiations, elongations and terminations
+// at the start. Moves that would take a free tRNA or ribosome that ran out are dropped. The elongatable
+// ribosomes, initiable mRNAs and stalled ribosomes are then rebuilt. Returns the number of events of the
+// leap, or 0 if it would hold fewer than LEAP_MIN_EVENTS events and an exact event should be simulated.
+// Drugs cannot act during a leap.
+long Leap_Run(cell *C, double t_stop)
+{	int c1, c2, c3, k, m_id, g_id, r_id, f, n, nf, first_new, next_ribo, p0, p1, stall_pos;
+	gene *Gene = C->Gene;
+	ribo_site *Ribo = C->Ribo.site;
+	ribo_elng *Ribo_e = C->Ribo.elng;
+	int *order = C->leap_order;
+	int *first = C->leap_first;
+	int tot_ribo = C->par.tot_ribo;
+	double leap_eps = C->par.leap_eps;
+	double k_cod[61], cons[62], rel[62];
+	double a_ini = Prop_Table_Get(&C->chn_prop, CHN_INI), a0 = a_ini;
+	double k_ini, s, s_free, tau = t_stop-C->t, x;
+	long n_ev = 0, n_ini = 0, n_term = 0;
+	uint8_t *seq;
+	
+	// Length of the leap from the flux through each free pool, tRNAs 0...60 and ribosomes 61
+	for(c1=0;c1<62;c1++)
+	{	cons[c1] = rel[c1] = 0.0;
+	}
+	cons[61] = a_ini;
+	for(c1=0;c1<61;c1++)
+	{	k_cod[c1] = C->pool_scale*C->Tf[C->cTRNA[c1].tid]*C->cTRNA[c1].wobble;
+		a0 += k_cod[c1]*(double)C->n_Rb_e[c1];
+		for(c2=0;c2<C->n_Rb_e[c1];c2++)
+		{	r_id = C->Rb_e[c1][c2];
+			g_id = C->mRNA[Ribo[r_id].mRNA].gene;
+			if(Ribo[r_id].pos==Gene[g_id].len-1)
+			{	rel[61] += k_cod[c1];
+			}
+			else
+			{	cons[C->cTRNA[c1].tid] += k_cod[c1];
+			}
+			if(Ribo[r_id].pos>0)
+			{	rel[C->cTRNA[Gene[g_id].seq[Ribo[r_id].pos-1]].tid] += k_cod[c1];
+			}
+		}
+	}
+	for(c1=0;c1<62;c1++)
+	{	if(cons[c1]+rel[c1]>0)
+		{	x = leap_eps*(double)((c1<61) ? ((C->Tf[c1]>1) ? C->Tf[c1] : 1) : ((C->Rf>1) ? C->Rf : 1));
+			tau = fmin(tau, x/fabs(cons[c1]-rel[c1]));
+			tau = fmin(tau, x*x/(cons[c1]+rel[c1]));
+		}
+	}
+	if(a0*tau < LEAP_MIN_EVENTS)
+	{	return 0;
+	}
+	
+	// Bound ribosomes by mRNA, front first
+	for(c1=0;c1<=C->n_mRNA;c1++)
+	{	first[c1] = 0;
+	}
+	for(c1=0;c1<C->next_avail_ribo;c1++)
+	{	first[Ribo[c1].mRNA+1]++;
+	}
+	for(c1=0;c1<C->n_mRNA;c1++)
+	{	first[c1+1] += first[c1];
+	}
+	for(c1=0;c1<C->next_avail_ribo;c1++)
+	{	order[first[Ribo[c1].mRNA]++] = c1;
+	}
+	for(c1=C->n_mRNA;c1>0;c1--)
+	{	first[c1] = first[c1-1];
+	}
+	first[0] = 0;
+	for(m_id=0;m_id<C->n_mRNA;m_id++)
+	{	for(c1=first[m_id]+1;c1<first[m_id+1];c1++)									// Few ribosomes per mRNA: insertion sort
+		{	k = order[c1];
+			for(c2=c1;c2>first[m_id] && Ribo[order[c2-1]].pos<Ribo[k].pos;c2--)
+			{	order[c2] = order[c2-1];
+			}
+			order[c2] = k;
+		}
+	}
+	
+	for(c1=0;c1<C->n_mRNA;c1++)
+	{	C->leap_ini[c1] = 0;
+	}
+	for(c1=0;c1<C->par.n_genes;c1++)
+	{	for(c2=0;c2<C->Mf[c1];c2++)
+		{	C->leap_ini[C->free_mRNA[c1][c2]] = 1;
+		}
+	}
+	
+	// Simulate each mRNA over the leap
+	next_ribo = C->next_avail_ribo;
+	for(m_id=0;m_id<C->n_mRNA;m_id++)
+	{	g_id = C->mRNA[m_id].gene;
+		seq = Gene[g_id].seq;
+		f = 0;
+		nf = -1;																	// No ribosome ahead
+		for(c1=first[m_id];c1<first[m_id+1];c1++)
+		{	r_id = order[c1];
+			p0 = Ribo[r_id].pos;
+			C->leap_stall[c1] = -1;
+			if(Ribo_e[r_id].inhbtr_bound==0 && c1>first[m_id] && p0+10<Gene[g_id].len && Ribo[order[c1-1]].pos==p0+10)
+			{	C->leap_stall[c1] = p0;
+			}
+		}
+		for(c1=first[m_id];c1<first[m_id+1];c1++)
+		{	r_id = order[c1];
+			n = Leap_Walk(C, r_id, 0.0, tau, k_cod, C->leap_s[f], (nf>=0) ? C->leap_p[f] : NULL, nf, C->leap_s[1-f], C->leap_p[1-f]);
+			n_ev += n;
+			f = 1-f;
+			nf = n;
+			n_term += (Ribo[r_id].mRNA<0);
+		}
+		
+		// Initiations, each as soon as the ribosome ahead cleared the first 10 codons
+		if(C->leap_ini[m_id]==1)
+		{	s_free = 0.0;
+		}
+		else
+		{	s_free = (nf>=0) ? Leap_Cleared(C->leap_s[f], C->leap_p[f], nf) : INFINITY;
+		}
+		k_ini = Gene[g_id].ini_prob*(C->pool_scale*C->Rf)/(char_time_ribo*C->par.avail_space_r);
+		first_new = next_ribo;
+		while(s_free<=tau && k_ini>0)
+		{	s = s_free-log(Rng_Uniform_Pos(C->r))/k_ini;
+			if(s>tau)
+			{	break;
+			}
+			if(C->Rf<=0 || next_ribo>=tot_ribo)
+			{	C->leap_dropped++;
+				break;
+			}
+			r_id = next_ribo++;
+			C->Rf--;
+			Ribo[r_id].mRNA = m_id;
+			Ribo[r_id].pos = 0;
+			Ribo_e[r_id].inhbtr_bound = 0;
+			C->Ribo.t_trans_ini[r_id] = C->Ribo.t_elong_ini[r_id] = C->t+s;
+			C->mRNA[m_id].last_ini = C->t+s;
+			Grid_Set(&C->R_grid, m_id, 0, r_id);
+			n_ini++;
+			n = Leap_Walk(C, r_id, s, tau, k_cod, C->leap_s[f], (nf>=0) ? C->leap_p[f] : NULL, nf, C->leap_s[1-f], C->leap_p[1-f]);
+			n_ev += n+1;
+			f = 1-f;
+			nf = n;
+			n_term += (Ribo[r_id].mRNA<0);
+			s_free = Leap_Cleared(C->leap_s[f], C->leap_p[f], nf);
+		}
+		C->leap_ini[m_id] = (s_free<=tau);
+		
+		// Stalled and elongatable ribosomes at the end of the leap, marked with elng_pos_list -1 and 0
+		p1 = -1;																	// Position of the ribosome ahead
+		for(c1=first[m_id];c1<first[m_id+1]+(next_ribo-first_new);c1++)
+		{	r_id = (c1<first[m_id+1]) ? order[c1] : first_new+c1-first[m_id+1];
+			stall_pos = (c1<first[m_id+1]) ? C->leap_stall[c1] : -1;
+			if(Ribo[r_id].mRNA<0)
+			{	if(stall_pos>=0)
+				{	Leap_Stall(C, g_id, stall_pos, -1);
+				}
+				continue;
+			}
+			p0 = Ribo[r_id].pos;
+			if(Ribo_e[r_id].inhbtr_bound==0)
+			{	Ribo_e[r_id].elng_cod_list = seq[p0];
+				Ribo_e[r_id].elng_pos_list = 0;
+				if(p1>=0 && p0+10<Gene[g_id].len && p1==p0+10)
+				{	Ribo_e[r_id].elng_pos_list = -1;
+					if(stall_pos!=p0)
+					{	Leap_Stall(C, g_id, p0, 1);
+					}
+				}
+				if(stall_pos>=0 && (stall_pos!=p0 || Ribo_e[r_id].elng_pos_list==0))
+				{	Leap_Stall(C, g_id, stall_pos, -1);
+				}
+			}
+			p1 = p0;
+		}
+	}
+	
+	// Ids of the ribosomes that terminated go to the last bound ones
+	for(c1=0;c1<next_ribo;)
+	{	if(Ribo[c1].mRNA>=0)
+		{	c1++;
+			continue;
+		}
+		next_ribo--;
+		if(c1!=next_ribo)
+		{	Ribo[c1] = Ribo[next_ribo];
+			Ribo_e[c1] = Ribo_e[next_ribo];
+			C->Ribo.t_trans_ini[c1] = C->Ribo.t_trans_ini[next_ribo];
+			C->Ribo.t_elong_ini[c1] = C->Ribo.t_elong_ini[next_ribo];
+			if(Ribo[c1].mRNA>=0)
+			{	Grid_Set(&C->R_grid, Ribo[c1].mRNA, Ribo[c1].pos, c1);
+			}
+		}
+	}
+	C->next_avail_ribo = next_ribo;
+	
+	for(c1=0;c1<61;c1++)
+	{	C->n_Rb_e[c1] = 0;
+	}
+	for(c1=0;c1<next_ribo;c1++)
+	{	if(Ribo_e[c1].inhbtr_bound==0 && Ribo_e[c1].elng_pos_list>=0)
+		{	c3 = Ribo_e[c1].elng_cod_list;
+			C->Rb_e[c3][C->n_Rb_e[c3]] = c1;
+			Ribo_e[c1].elng_pos_list = C->n_Rb_e[c3];
+			C->n_Rb_e[c3]++;
+		}
+	}
+	for(c1=0;c1<C->par.n_genes;c1++)
+	{	C->Mf[c1] = 0;
+	}
+	for(c1=0;c1<C->n_mRNA;c1++)
+	{	if(C->leap_ini[c1]==1)
+		{	g_id = C->mRNA[c1].gene;
+			C->free_mRNA[g_id][C->Mf[g_id]++] = c1;
+		}
+	}
+	for(c1=0;c1<C->par.n_genes;c1++)
+	{	Prop_Table_Set(&C->gene_prop, c1, (double)C->Mf[c1]*Gene[c1].ini_prob);
+	}
+	
+	C->t += tau;
+	Refresh_Elng_Prop(C);
+	Prop_Table_Resync(&C->chn_prop, C->t, C->r);
+	C->leap_n++;
+	C->leap_events += n_ev;
+#ifdef SMOPT_BENCH
+	C->bench.n[CHN_INI] += n_ini;
+	C->bench.n[EV_TERM] += n_term;
+	C->bench.n[EV_ELNG] += n_ev-n_ini-n_term;
+	C->bench.n_events += n_ev;
+#endif
+#ifdef SMOPT_TELEMETRY
+	C->telem.n[CHN_INI] += n_ini;
+	C->telem.n[EV_TERM] += n_term;
+	C->telem.n[EV_ELNG] += n_ev-n_ini-n_term;
+	C->telem.n_events += n_ev;
+#endif
+	return n_ev;
+}
+
+
+
+// Event loop of Cell_Run. run holds the RUN_* flags of the variant: it is a constant in every call, so the
+// compiler drops the branches of the statistics and drugs that are off
+static ALWAYS_INLINE void Cell_Run_Loop(cell *C, double t_end, const int run)
+{	int c1, c2;
+	gene *Gene = C->Gene;
+	trna *cTRNA = C->cTRNA;
+	rng *r = C->r;
+	ribo_site *Ribo = C->Ribo.site;
+	ribo_elng *Ribo_e = C->Ribo.elng;
+	double *t_trans_ini = C->Ribo.t_trans_ini;
+	double *t_elong_ini = C->Ribo.t_elong_ini;
+	transcript *mRNA = C->mRNA;
+	ribogrid *R_grid = &C->R_grid;
+	proptable *gene_prop = &C->gene_prop;
+	proptable *chn_prop = &C->chn_prop;
+	int (*tRNA_cod)[61] = C->tRNA_cod;
+	int *n_tRNA_cod = C->n_tRNA_cod;
+	int *Tf = C->Tf;
+	int *Mf = C->Mf;
+	int **free_mRNA = C->free_mRNA;
+	int **Rb_e = C->Rb_e;
+	int *n_Rb_e = C->n_Rb_e;
+	int *chx_r_id = C->chx_r_id;
+	int *n_e_times = C->n_e_times;
+	double *e_times = C->e_times;
+	int *num_waste_ribo = C->num_waste_ribo;
+	int *num_waste_ribo_pos = C->num_waste_ribo_pos;
+	double *time_waste_ribo = C->time_waste_ribo;
+	double *time_waste_ribo_pos = C->time_waste_ribo_pos;
+	int *num_stall_chx = C->num_stall_chx;
+	double *avg_tRNA_abndc = C->avg_tRNA_abndc;
+	int **gene_sp_ribo_500 = C->gene_sp_ribo_500;
+	lazy_count *Tf_held = C->Tf_held;
+	lazy_count *waste_held = C->waste_held;
+	lazy_count *waste_pos_held = C->waste_pos_held;
+	
+	// Scalars of the cell are kept in locals during the loop and stored back at the end
+	double t = C->t;
+	int Rf = C->Rf;
+	int Rfh = C->Rfh;
+	int next_avail_ribo = C->next_avail_ribo;
+	int tot_stall_chx = C->tot_stall_chx;
+	double avg_Rf = C->avg_Rf;
+	int t_print = C->t_print;
+	long events_left = C->events_left;
+	
+	// Parameters of the cell in place of the command-line ones
+	int *printOpt = C->par.printOpt;
+	double tot_time = C->par.tot_time;
+	double thresh_time = C->par.thresh_time;
+	double leap_eps = C->par.leap_eps;
+	int tot_ribo = C->par.tot_ribo;
+	double avail_space_r = C->par.avail_space_r;
+	double chx_rb_prob = C->par.chx_rb_prob;
+	double chx_ds_rate = C->par.chx_ds_rate;
+	double harr_rf_rate = C->par.harr_rf_rate;
+	double chx_time = C->par.chx_time;
+	double harr_time = C->par.harr_time;
+	
+	int x;
+	int r_id;
+	int r2_id;									// Ribosome 11 codons behind a moving ribosome
+	int m_id = 0;
+	int c_id;
+	int c2_id;
+	int g_id;
+	int termtn_now=0;
+	int dirty_cod[8];							// Codons whose number of elongatable ribosomes changed in the current event
+	int dirty_tRNA[4];							// tRNA types whose free abundance changed in the current event
+	int dirty_pos[4];							// Positions of the first gene whose number of stalled ribosomes changed in the current event
+	int n_dirty_cod = 0;
+	int n_dirty_tRNA = 0;
+	int n_dirty_pos = 0;
+	double tot_chx_ds_rate = 0.0;				// Total rate of CHX dissociaction
+	double tot_harr_rate = 0.0;					// Total rate of harringtonine action
+	double pool_scale = C->pool_scale;			// Scale of the free pools in bimolecular rates
+	long n_leap;								// Events of a leap of the burn-in (-Tl)
+	double leap_stop;
+	double prob_g;
+	double inv_rate;
+	double coin;
+#if defined(SMOPT_BENCH) || defined(SMOPT_TELEMETRY)
+	int ev_type = 0;
+#endif
+#ifdef SMOPT_BENCH
+	int bench_timed;
+	struct timespec bench_run, bench_t1, bench_t2;
+	
+	clock_gettime(CLOCK_MONOTONIC, &bench_run);
+	if(C->bench.n_events==0)
+	{	C->bench.startup_s = Clock_Elapsed(&bench_start, &bench_run);
+	}
+#endif
+	
+	
+	/////////////////////////////////////////////////
+	// Begin the actual continuous time simulation
+	/////////////////////////////////////////////////
+	
+	while(t<t_end)																	// Till current time reaches the end of this run
+	{
+#ifdef SMOPT_BENCH
+		bench_timed = ((C->bench.n_events & BENCH_SAMPLE) == 0);
+		if(bench_timed)
+		{	clock_gettime(CLOCK_MONOTONIC, &bench_t1);
+		}
+#endif
+		// Initiation rate
+		Prop_Table_Set(chn_prop, CHN_INI, Prop_Table_Total(gene_prop)*(pool_scale*Rf)/(char_time_ribo*avail_space_r));
+		
+		if((run & RUN_DRUGS) && t>harr_time)
+		{	tot_harr_rate = (double)Rf*harr_rf_rate;								// Rate of harringtonine action on free ribosomes
+			Prop_Table_Set(chn_prop, CHN_HARR, tot_harr_rate);
+		}
+
+		if((run & RUN_DRUGS) && t>chx_time)
+		{	tot_chx_ds_rate = (double)tot_stall_chx*chx_ds_rate;					// CHX dissociation rate action from bound ribosomes
+			Prop_Table_Set(chn_prop, CHN_CHX_DS, tot_chx_ds_rate);
+		}
+		
+		// Burn-in by leaps, which end before any drug acts and at the next sampling of the ribosomes
+		if(leap_eps>0 && t<thresh_time)
+		{	leap_stop = fmin(t_end, thresh_time);
+			if(run & RUN_SAMPLE)
+			{	leap_stop = fmin(leap_stop, (double)t_print);
+			}
+			if(run & RUN_DRUGS)
+			{	if(chx_rb_prob>0)
+				{	leap_stop = fmin(leap_stop, chx_time);
+				}
+				if(harr_rf_rate>0)
+				{	leap_stop = fmin(leap_stop, harr_time);
+				}
+				if(tot_stall_chx>0 || Rfh>0 || Prop_Table_Get(chn_prop, CHN_HARR)!=0 || Prop_Table_Get(chn_prop, CHN_CHX_DS)!=0)
+				{	leap_stop = t;
+				}
+			}
+			C->Rf = Rf;
+			C->next_avail_ribo = next_avail_ribo;
+			C->t = t;
+			n_leap = (leap_stop>t) ? Leap_Run(C, leap_stop) : 0;
+			if(n_leap>0)
+			{	t = C->t;
+				Rf = C->Rf;
+				next_avail_ribo = C->next_avail_ribo;
+#ifdef SMOPT_BENCH
+				if(bench_events>0 && C->bench.n_events>=bench_events)
+				{	break;
+				}
+#endif
+				if(events_left>0 && (events_left -= n_leap)<=0)					// A step of the library ends with the leap
+				{	break;
+				}
+				continue;
+			}
+		}
+		
+		inv_rate = Prop_Table_Wait(chn_prop);										// Time to the next event
+
+		if(inv_rate<0)
+		{	if(pool_scale>1)															// A domain can get free ribosomes and tRNAs again at the next window
+			{	t=t_end;
+				continue;
+			}
+			printf("\nNo further events to process.\nSimulation stopped at time %g\n\n",t);fflush(stdout);
+			t=tot_time;
+			break;
+		}
+		
+		// Time averages of free ribosomes and tRNAs (-p4) and stalled ribosomes (-p6) start at the first event after thresh_time
+		// From then on each counter is added to its average only when it changes, at the end of the event
+		if(t>thresh_time && C->avg_started==0)
+		{	Avg_Start(C, Rf, t);
+		}
+		
+		// Increment time
+		t+=inv_rate;
+		
+		c1 = Prop_Table_Pick(chn_prop, r);											// Pick an event
+#if defined(SMOPT_BENCH) || defined(SMOPT_TELEMETRY)
+		ev_type = (c1<CHN_ELNG) ? c1 : EV_ELNG;
+#endif
+
+		// Translation initiation
+		if(c1==CHN_INI)
+		{	
+			// Ribosomes are picked sequentially
+			r_id = next_avail_ribo;
+			Ribo[r_id].pos = 0;
+			t_trans_ini[r_id] = t;
+			t_elong_ini[r_id] = t;
+			next_avail_ribo++;
+			
+			// Pick a random mRNA for initiation
+			c1 = Prop_Table_Pick(gene_prop, r);									// Pick a gene randomly first as they may differ in ini_prob
+			
+			c2 = Rng_Uniform_Int(r, (unsigned long)Mf[c1]);						// Once a gene is selected pick a random mRNA
+			m_id = free_mRNA[c1][c2];
+			Mf[c1]--;
+			Prop_Table_Set(gene_prop, c1, (double)Mf[c1]*Gene[c1].ini_prob);
+			if(c2!=Mf[c1])
+			{	free_mRNA[c1][c2] = free_mRNA[c1][Mf[c1]];							// Accounting of free mRNAs for next round
+			}
+			
+			if(t>thresh_time)
+			{	mRNA[m_id].ini_n++;													// Store the # of initn events on this mRNA
+				mRNA[m_id].avg_time_to_ini += t-mRNA[m_id].last_ini;				// Time between initn
+			}	
+			mRNA[m_id].last_ini = t;
+
+			c_id = Gene[mRNA[m_id].gene].seq[0];									// Codon at pos 1
+
+			Ribo[r_id].mRNA = m_id;							
+			
+			coin = Rng_Uniform(r);
+			prob_g = (double)Rfh/(double)Rf;
+			if(coin>prob_g)
+			{	if(Grid_Get(R_grid, m_id, 10)==tot_ribo)										// Check if the current ribosome can be elongated
+				{	Rb_e[c_id][n_Rb_e[c_id]] = r_id;								// If no ribosome at pos+10 then it can
+					Ribo_e[r_id].elng_cod_list = c_id;
+					Ribo_e[r_id].elng_pos_list = n_Rb_e[c_id];
+					n_Rb_e[c_id]++;
+					dirty_cod[n_dirty_cod++] = c_id;
+				}
+				else
+				{	num_waste_ribo[mRNA[m_id].gene]++;
+					Stall_Pos_Add(C, mRNA[m_id].gene, 0, 1, t);
+					if(mRNA[m_id].gene==0)
+					{	num_waste_ribo_pos[0]++;
+						dirty_pos[n_dirty_pos++] = 0;
+					}
+				}
+				Ribo_e[r_id].inhbtr_bound = 0;
+			}
+			else
+			{	num_waste_ribo[mRNA[m_id].gene]++;
+				Stall_Pos_Add(C, mRNA[m_id].gene, 0, 1, t);
+				Rfh--;
+				Ribo_e[r_id].inhbtr_bound = 1;
+			}
+			Grid_Set(R_grid, m_id, 0, r_id);													// Update the ribosome grid uypon initiation
+			
+			Rf--;																	// Update number of free ribosomes
+		}
+		// Harringtonine action
+		else if((run & RUN_DRUGS) && c1==CHN_HARR)
+		{	Rfh++;
+		}
+		// CHX dissociaction
+		else if((run & RUN_DRUGS) && c1==CHN_CHX_DS)
+		{	x = Rng_Uniform_Int(r, (unsigned long)tot_stall_chx);				// Randomly pick a CHX bound ribosome
+			r_id = chx_r_id[x];
+			m_id = Ribo[r_id].mRNA;
+			c_id = Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos];
+			
+			if((Ribo[r_id].pos+11)>=Gene[mRNA[m_id].gene].len || Grid_Get(R_grid, m_id, Ribo[r_id].pos+11)==tot_ribo)
+			{	Rb_e[c_id][n_Rb_e[c_id]] = r_id;
+				Ribo_e[r_id].elng_cod_list = c_id;
+				Ribo_e[r_id].elng_pos_list = n_Rb_e[c_id];
+				n_Rb_e[c_id]++;
+				dirty_cod[n_dirty_cod++] = c_id;
+			}
+			if(Ribo[r_id].pos!=(Gene[mRNA[m_id].gene].len-1) && Ribo[r_id].pos>1)	// Check if the current elongation has led to termination
+			{	Tf[cTRNA[Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos-2]].tid]++;
+				dirty_tRNA[n_dirty_tRNA++] = cTRNA[Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos-2]].tid;
+			}
+			Ribo_e[r_id].inhbtr_bound = 0;
+			
+			tot_stall_chx--;
+			chx_r_id[x] = chx_r_id[tot_stall_chx];
+			num_stall_chx[mRNA[m_id].gene]--;
+		}
+		// Translation Elongation
+		else
+		{	c_id = c1-CHN_ELNG;
+			dirty_cod[n_dirty_cod++] = c_id;										// Elongation always changes the elongatable ribosomes
+			dirty_tRNA[n_dirty_tRNA++] = cTRNA[c_id].tid;							// or free tRNAs of the elongated codon
+			
+			x = Rng_Uniform_Int(r, (unsigned long)n_Rb_e[c_id]);				// Randomly pick an elongatable ribosome bound to codon c_id
+			r_id = Rb_e[c_id][x];
+			m_id = Ribo[r_id].mRNA;
+			
+			// Elongation arrest due to Cycloheximide action
+			coin = Rng_Uniform(r);													// Drawn in every variant to keep the random numbers
+			if((run & RUN_DRUGS) && coin<chx_rb_prob && t>chx_time)
+			{	n_Rb_e[c_id]--;														// Remove it from the list of elongatable codons
+				if(x!=n_Rb_e[c_id])
+				{	Ribo_e[Rb_e[c_id][n_Rb_e[c_id]]].elng_pos_list = x;				// Update the ids and number of elongatable ribosomes
+					Rb_e[c_id][x] = Rb_e[c_id][n_Rb_e[c_id]];
+				}
+				if(Ribo[r_id].pos!=(Gene[mRNA[m_id].gene].len-1))					// Check if the current elongation has led to termination
+				{	Tf[cTRNA[c_id].tid]--;
+					Grid_Set(R_grid, m_id, Ribo[r_id].pos, tot_ribo);
+					Ribo[r_id].pos++;
+					Grid_Set(R_grid, m_id, Ribo[r_id].pos, r_id);
+				}
+				else
+				{	termtn_now=1;
+				}
+				num_stall_chx[mRNA[m_id].gene]++;
+
+				Ribo_e[r_id].inhbtr_bound = 1;
+
+				chx_r_id[tot_stall_chx] = r_id;
+				tot_stall_chx++;
+			}
+			// Normal elongation cycle
+			else
+			{	if(Ribo[r_id].pos>0)													// Release the tRNA bound at the earlier position
+				{	Tf[cTRNA[Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos-1]].tid]++;
+					dirty_tRNA[n_dirty_tRNA++] = cTRNA[Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos-1]].tid;
+				}
+						
+				if(Ribo[r_id].pos==(Gene[mRNA[m_id].gene].len-1))						// Check if the current elongation has led to termination
+				{	Grid_Set(R_grid, m_id, Ribo[r_id].pos, tot_ribo);							// Update the position of ribosomes on the mRNA
+				
+					Ribo[r_id].pos++;
+					Rf++;																// Free a ribosome upon termination
+
+					n_Rb_e[c_id]--;
+					if(x!=n_Rb_e[c_id])
+					{	Ribo_e[Rb_e[c_id][n_Rb_e[c_id]]].elng_pos_list = x;				// Update the ids and number of elongatable ribosomes
+						Rb_e[c_id][x] = Rb_e[c_id][n_Rb_e[c_id]];
+					}
+			
+					if(t>thresh_time)
+					{	if(run & RUN_ETIMES)
+						{	e_times[c_id] += t-t_elong_ini[r_id];					// For estimation of avg elongation times of codons
+							n_e_times[c_id]++;
+						}
+						mRNA[m_id].trans_n++;											// Update the number of trans evnts on curr mRNA
+						mRNA[m_id].avg_time_to_trans += t-t_trans_ini[r_id];		// Update the time to translation
+					}
+
+					// Update any previously unelongatable ribosomes
+					r2_id = Grid_Get(R_grid, m_id, Ribo[r_id].pos-11);
+					if(r2_id<tot_ribo)													// When the ribosome moves, a previously unelongatable ribosome
+					{	c2_id = Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos-11];			// can now be elongatable on the same mRNA if its 11 codon behind
+						Rb_e[c2_id][n_Rb_e[c2_id]] = r2_id;
+					
+						Ribo_e[r2_id].elng_cod_list = c2_id;
+						Ribo_e[r2_id].elng_pos_list = n_Rb_e[c2_id];
+						n_Rb_e[c2_id]++;
+						dirty_cod[n_dirty_cod++] = c2_id;
+
+						num_waste_ribo[mRNA[m_id].gene]--;
+						Stall_Pos_Add(C, mRNA[m_id].gene, Ribo[r_id].pos-11, -1, t);
+						if(mRNA[m_id].gene==0)
+						{	num_waste_ribo_pos[Ribo[r_id].pos-11]--;
+							dirty_pos[n_dirty_pos++] = Ribo[r_id].pos-11;
+						}
+					}
+								
+					// Update the ribosomes avail for initiation
+					next_avail_ribo--;
+				
+					if(r_id!=next_avail_ribo)											// The last initiated ribosome's data is swapped with
+					{	Ribo[r_id].mRNA = Ribo[next_avail_ribo].mRNA;					// the ribosome that just finished translation (terminated)
+						Ribo[r_id].pos = Ribo[next_avail_ribo].pos;						// This is done to primarily keep track of ONLY ribosomes
+						t_trans_ini[r_id] = t_trans_ini[next_avail_ribo];				// that are currently bound for faster computation
+						t_elong_ini[r_id] = t_elong_ini[next_avail_ribo];
+						
+						Ribo_e[r_id].elng_cod_list = Gene[mRNA[Ribo[next_avail_ribo].mRNA].gene].seq[Ribo[next_avail_ribo].pos];
+						Ribo_e[r_id].elng_pos_list = Ribo_e[next_avail_ribo].elng_pos_list;
+						Grid_Set(R_grid, Ribo[r_id].mRNA, Ribo[r_id].pos, r_id);
+						
+						if(Grid_Get(R_grid, Ribo[r_id].mRNA, Ribo[r_id].pos+10)==tot_ribo || (Ribo[r_id].pos+10)>=Gene[mRNA[Ribo[r_id].mRNA].gene].len)
+						{	Rb_e[Ribo_e[r_id].elng_cod_list][Ribo_e[r_id].elng_pos_list] = r_id;
+						}
+					}
+					termtn_now = 1;
+				
+				}
+				else if((Ribo[r_id].pos+11)>=Gene[mRNA[m_id].gene].len || Grid_Get(R_grid, m_id, Ribo[r_id].pos+11)==tot_ribo)	// Check if the ribosome is still elongatable
+				{	Grid_Set(R_grid, m_id, Ribo[r_id].pos, tot_ribo);															// Update the position of ribosomes on the mRNA
+					
+					Ribo[r_id].pos++;
+					Grid_Set(R_grid, m_id, Ribo[r_id].pos, r_id);
+					c2_id = Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos];
+					
+					if(c2_id!=c_id)															// If the codon has changed shift the elongatable ribosome
+					{	Rb_e[c2_id][n_Rb_e[c2_id]] = r_id;									// to the other codon
+						Ribo_e[r_id].elng_cod_list = c2_id;
+						Ribo_e[r_id].elng_pos_list = n_Rb_e[c2_id];
+						n_Rb_e[c2_id]++;
+						dirty_cod[n_dirty_cod++] = c2_id;
+						
+						n_Rb_e[c_id]--;
+						if(x!=n_Rb_e[c_id])
+						{	Ribo_e[Rb_e[c_id][n_Rb_e[c_id]]].elng_pos_list = x;				// Update the ids and number of elongatable ribosomes
+							Rb_e[c_id][x] = Rb_e[c_id][n_Rb_e[c_id]];
+						}
+					}
+					Tf[cTRNA[c_id].tid]--;
+				}
+				else																		// When ribosome is not elongatable anymore
+				{	Grid_Set(R_grid, m_id, Ribo[r_id].pos, tot_ribo);								// Update the position of ribosomes on the mRNA
+				
+					Ribo[r_id].pos++;
+					Grid_Set(R_grid, m_id, Ribo[r_id].pos, r_id);
+					Ribo_e[r_id].elng_cod_list = Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos];
+
+					n_Rb_e[c_id]--;
+					if(x!=n_Rb_e[c_id])
+					{	Ribo_e[Rb_e[c_id][n_Rb_e[c_id]]].elng_pos_list = x;					// Update the ids and number of elongatable ribosomes
+						Rb_e[c_id][x] = Rb_e[c_id][n_Rb_e[c_id]];
+					}
+				
+					Tf[cTRNA[c_id].tid]--;
+					num_waste_ribo[mRNA[m_id].gene]++;
+					Stall_Pos_Add(C, mRNA[m_id].gene, Ribo[r_id].pos, 1, t);
+					if(mRNA[m_id].gene==0)
+					{	num_waste_ribo_pos[Ribo[r_id].pos]++;
+						dirty_pos[n_dirty_pos++] = Ribo[r_id].pos;
+					}
+				}
+			}
+			if(termtn_now==0)															// When elongation does not lead to termination
+			{	r2_id = (Ribo[r_id].pos>10) ? Grid_Get(R_grid, m_id, Ribo[r_id].pos-11) : tot_ribo;
+				if(r2_id<tot_ribo)														// When the ribosome moves, a previously unelongatable ribosome
+				{	if(Ribo_e[r2_id].inhbtr_bound==0)										// can now be elongated on the same mRNA if its 11 codon behind
+					{	c2_id = Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos-11];
+						Rb_e[c2_id][n_Rb_e[c2_id]] = r2_id;
+					
+						Ribo_e[r2_id].elng_cod_list = c2_id;
+						Ribo_e[r2_id].elng_pos_list = n_Rb_e[c2_id];
+						n_Rb_e[c2_id]++;
+						dirty_cod[n_dirty_cod++] = c2_id;
+					
+						num_waste_ribo[mRNA[m_id].gene]--;
+						Stall_Pos_Add(C, mRNA[m_id].gene, Ribo[r_id].pos-11, -1, t);
+						if(mRNA[m_id].gene==0)
+						{	num_waste_ribo_pos[Ribo[r_id].pos-11]--;
+							dirty_pos[n_dirty_pos++] = Ribo[r_id].pos-11;
+						}
+					}
+				}
+				if(Ribo[r_id].pos==10)													// If the current position is at codon 11 make the current mRNA initiable
+				{	g_id = mRNA[m_id].gene;
+					free_mRNA[g_id][Mf[g_id]] = m_id;
+					Mf[g_id]++;
+					Prop_Table_Set(gene_prop, g_id, (double)Mf[g_id]*Gene[g_id].ini_prob);
+				}
+
+				t_elong_ini[r_id] = t;												// Upon elongation, update the elong ini time for the next evnt
+			}
+			else
+			{	termtn_now = 0;
+#if defined(SMOPT_BENCH) || defined(SMOPT_TELEMETRY)
+				ev_type = EV_TERM;
+#endif
+			}
+			
+			if((run & RUN_SAMPLE) && t>((double)t_print))								// Sample the positions of the bound ribosomes every second
+			{	if(printOpt[6]==1)
+				{	for(c1=0;c1<next_avail_ribo;c1++)
+					{	if(Grid_Get(R_grid, Ribo[c1].mRNA, Ribo[c1].pos)==c1)				// Codons shared by two ribosomes are counted once
+						{	gene_sp_ribo_500[mRNA[Ribo[c1].mRNA].gene][Ribo[c1].pos]++;
+						}
+					}
+				}
+				if(C->traj!=NULL)
+				{	Traj_Frame(C->traj, t, Ribo, next_avail_ribo, R_grid);
+				}
+				t_print++;
+			}
+		}
+		
+		// Refresh the elongation propensities of the codons touched by this event
+		for(c1=0;c1<n_dirty_tRNA;c1++)
+		{	for(c2=0;c2<n_tRNA_cod[dirty_tRNA[c1]];c2++)
+			{	c_id = tRNA_cod[dirty_tRNA[c1]][c2];
+				Prop_Table_Set(chn_prop, CHN_ELNG+c_id, pool_scale*Tf[cTRNA[c_id].tid]*cTRNA[c_id].wobble*(double)n_Rb_e[c_id]);
+			}
+		}
+		for(c1=0;c1<n_dirty_cod;c1++)
+		{	c_id = dirty_cod[c1];
+			Prop_Table_Set(chn_prop, CHN_ELNG+c_id, pool_scale*Tf[cTRNA[c_id].tid]*cTRNA[c_id].wobble*(double)n_Rb_e[c_id]);
+		}
+		
+		// Add the counters changed by this event to the time averages
+		if((run & (RUN_POOLS | RUN_STALL)) && C->avg_started==1)
+		{	if(run & RUN_POOLS)
+			{	for(c1=0;c1<n_dirty_tRNA;c1++)
+				{	Avg_Update(&avg_tRNA_abndc[dirty_tRNA[c1]], &Tf_held[dirty_tRNA[c1]], Tf[dirty_tRNA[c1]], t);
+				}
+				if(Rf!=C->Rf_held.value)
+				{	Avg_Update(&avg_Rf, &C->Rf_held, Rf, t);
+				}
+			}
+			if(run & RUN_STALL)
+			{	g_id = mRNA[m_id].gene;											// Stalled ribosomes only change on the mRNA of the event
+				if(num_waste_ribo[g_id]!=waste_held[g_id].value)
+				{	Avg_Update(&time_waste_ribo[g_id], &waste_held[g_id], num_waste_ribo[g_id], t);
+				}
+				for(c1=0;c1<n_dirty_pos;c1++)
+				{	Avg_Update(&time_waste_ribo_pos[dirty_pos[c1]], &waste_pos_held[dirty_pos[c1]], num_waste_ribo_pos[dirty_pos[c1]], t);
+				}
+			}
+		}
+		n_dirty_tRNA = 0;
+		n_dirty_cod = 0;
+		n_dirty_pos = 0;
+#ifdef SMOPT_BENCH
+		if(bench_timed)
+		{	clock_gettime(CLOCK_MONOTONIC, &bench_t2);
+			C->bench.n_timed[ev_type]++;
+			C->bench.ns_timed[ev_type] += 1e9*Clock_Elapsed(&bench_t1, &bench_t2);
+		}
+		C->bench.n[ev_type]++;
+		C->bench.n_events++;
+		if(bench_events>0 && C->bench.n_events>=bench_events)
+		{	break;
+		}
+#endif
+#ifdef SMOPT_TELEMETRY
+		C->telem.n[ev_type]++;
+		C->telem.n_events++;
+		if((C->telem.n_events & TELEM_CHECK) == 0)
+		{	Telemetry_Report(C, t, Rf, Rfh, 0);
+		}
+#endif
+		if(events_left>0 && --events_left==0)										// End of a step of the library
+		{	break;
+		}
+	}
+#ifdef SMOPT_BENCH
+	clock_gettime(CLOCK_MONOTONIC, &bench_t2);
+	C->bench.run_s += Clock_Elapsed(&bench_run, &bench_t2);
+#endif
+	
+	C->t = t;
+	C->Rf = Rf;
+	C->Rfh = Rfh;
+	C->next_avail_ribo = next_avail_ribo;
+	C->tot_stall_chx = tot_stall_chx;
+	C->avg_Rf = avg_Rf;
+	C->t_print = t_print;
+	C->events_left = events_left;
+}
+
+#define RUN_CASE(v)		case (v): Cell_Run_Loop(C, t_end, (v)); break;
+#define RUN_CASES4(v)	RUN_CASE(v) RUN_CASE((v)+1) RUN_CASE((v)+2) RUN_CASE((v)+3)
+
+// Simulate the cell until its time reaches t_end
+// The cell stops after the first event at or beyond t_end, so running to t1 and then to t2 takes exactly
+// the same path as running to t2 directly. Each run picks the variant of the event loop for the statistics
+// gathered and, if no drug can act (no binding or action rates, no ribosome held by cycloheximide), one
+// without the drugs. All variants draw the same random numbers.
+void Cell_Run(cell *C, double t_end)
+{	int *printOpt = C->par.printOpt;
+	int run = 0;
+	
+	if(printOpt[0]==1)
+	{	run |= RUN_ETIMES;
+	}
+	if(printOpt[3]==1)
+	{	run |= RUN_POOLS;
+	}
+	if(printOpt[5]==1)
+	{	run |= RUN_STALL;
+	}
+	if(printOpt[6]==1 || C->traj!=NULL)
+	{	run |= RUN_SAMPLE;
+	}
+	if(C->par.chx_rb_prob>0 || C->par.harr_rf_rate>0 || C->tot_stall_chx>0
+		|| Prop_Table_Get(&C->chn_prop, CHN_HARR)!=0 || Prop_Table_Get(&C->chn_prop, CHN_CHX_DS)!=0)
+	{	run |= RUN_DRUGS;
+	}
+	
+	switch(run)
+	{	RUN_CASES4(0) RUN_CASES4(4) RUN_CASES4(8) RUN_CASES4(12)
+		RUN_CASES4(16) RUN_CASES4(20) RUN_CASES4(24) RUN_CASES4(28)
+	}
+}
+
+
+
+// Write the output files of the cell with the given prefix and, if Res is not NULL, store its summary statistics in Res
+// The time averages are normalized in place, so this is called once after the last Cell_Run
+void Cell_Output(cell *C, char *prefix, replicate *Res)
+{	int c1, c2, c3;
+	FILE *f2, *f3, *f4, *f5, *f6, *f7, *f8, *f9, *f10, *f11;
+	char out_file[200];
+	gene *Gene = C->Gene;
+	transcript *mRNA = C->mRNA;
+	ribogrid *R_grid = &C->R_grid;
+	int obs_max_len = C->obs_max_len;
+	int *n_e_times = C->n_e_times;
+	double *e_times = C->e_times;
+	int *num_waste_ribo = C->num_waste_ribo;
+	double *time_waste_ribo = C->time_waste_ribo;
+	double *time_waste_ribo_pos = C->time_waste_ribo_pos;
+	int *num_stall_chx = C->num_stall_chx;
+	double *avg_tRNA_abndc = C->avg_tRNA_abndc;
+	double avg_Rf = C->avg_Rf;
+	int **gene_sp_ribo_500 = C->gene_sp_ribo_500;
+	int tot_ribo = C->par.tot_ribo;				// Value of an empty codon
+	int n_genes = C->par.n_genes;
+	double tot_time = C->par.tot_time;
+	double thresh_time = C->par.thresh_time;
+	int *printOpt = C->par.printOpt;
+	int *stall_off = C->par.stall_off;
+	
+	// Process output for printing
+		
+	int n_trans[n_genes];
+	int **gene_sp_ribo;
+	gene_sp_ribo = malloc(sizeof(int *) * n_genes);
+	for(c1=0;c1<n_genes;c1++)
+	{	gene_sp_ribo[c1] = malloc(sizeof(int *) * Gene[c1].len);
+	}
+	int **gene_sp_ribo_ns;
+	gene_sp_ribo_ns = malloc(sizeof(int *) * n_genes);
+	for(c1=0;c1<n_genes;c1++)
+	{	gene_sp_ribo_ns[c1] = malloc(sizeof(int *) * Gene[c1].len);
+	}
+	
+	int n_tot=0;
+	int n_tot_ns=0;
+	int n_tot_all=0;
+	int gcount[obs_max_len];
+	double gmean = 0.0;
+	double gmean_ns = 0.0;
+	double avg_ribo_pos[4][obs_max_len];
+	double g_etimes[n_genes];
+	double g_ini[n_genes];
+	double dCST=0.0;
+	
+	if(printOpt[1]==1 || printOpt[2]==1 || printOpt[3]==1)
+	{	c3 = 0;
+		for(c1=0;c1<n_genes;c1++)
+		{	n_trans[c1] = 0;
+			g_ini[c1]=0.0;
+			g_etimes[c1]=0.0;
+			
+			for(c2=0;c2<Gene[c1].exp;c2++)
+			{	n_trans[c1] += mRNA[c3].trans_n;
+				g_ini[c1] += mRNA[c3].avg_time_to_ini;
+				g_etimes[c1] += mRNA[c3].avg_time_to_trans;
+				n_tot += mRNA[c3].trans_n;
+				c3++;
+			}
+		}
+	}
+	
+	
+	// Print the output
+	
+	// Elongation times of all codons
+	if(printOpt[0]==1)
+	{	strcpy(out_file,prefix);
+		f2 = Output_Open(strcat(out_file,"_etimes.out"),"w");
+		
+		fprintf(f2,"Codon\tNum_of_events\tAvg_elong_time(sec)\n");
+		for(c1=0;c1<61;c1++)
+		{	dCST = e_times[c1]/(double)n_e_times[c1];
+			fprintf(f2,"%d\t%d\t%g\n",c1,n_e_times[c1],dCST);
+		}
+		fclose(f2);
+	}
+	
+	// Average total elongation times of all genes
+	if(printOpt[1]==1)
+	{	strcpy(out_file,prefix);
+		f3 = Output_Open(strcat(out_file,"_gene_totetimes.out"),"w");
+		
+		fprintf(f3,"Gene\tNum_of_events\tAvg_total_elong_time(sec)\tNum_elng_stall\tNum_chx_stall\n");
+		for(c1=0;c1<n_genes;c1++)
+		{	dCST = g_etimes[c1]/(double)n_trans[c1];
+			fprintf(f3,"%d\t%d\t%g\t%d\t%d\n",c1,n_trans[c1],dCST,num_waste_ribo[c1],num_stall_chx[c1]);
+		}
+		fclose(f3);
+	}
+	
+	// Average time between initiation of all genes
+	if(printOpt[2]==1)
+	{	strcpy(out_file,prefix);
+		f4 = Output_Open(strcat(out_file,"_gene_initimes.out"),"w");
+		
+		fprintf(f4,"Gene\tNum_of_events\tAvg_initiation_time(sec)\n");
+		for(c1=0;c1<n_genes;c1++)
+		{	dCST = g_ini[c1]/(double)n_trans[c1];
+			fprintf(f4,"%d\t%d\t%g\n",c1,n_trans[c1],dCST);
+		}
+		fclose(f4);
+	}
+	
+	// Average number of free ribosomes and tRNAs at equilibrium
+	if(printOpt[3]==1)
+	{	strcpy(out_file,prefix);
+		f5 = Output_Open(strcat(out_file,"_avg_ribo_tRNA.out"),"w");
+		
+		avg_Rf = avg_Rf/(tot_time-thresh_time);
+		fprintf(f5,"Free_ribo\t%g\n",avg_Rf);
+		for(c1=0;c1<61;c1++)
+		{	if(avg_tRNA_abndc[c1]>0)
+		{	avg_tRNA_abndc[c1] = avg_tRNA_abndc[c1]/(tot_time-thresh_time);
+			fprintf(f5,"Free_tRNA%d\t%g\n",c1,avg_tRNA_abndc[c1]);
+		}
+		}
+		fclose(f5);
+	}
+	
+	// The final state of the system - positions of bound ribosomes on mRNAs
+	if(printOpt[4]==1)
+	{	strcpy(out_file,prefix);
+		f6 = Output_Open(strcat(out_file,"_final_ribo_pos.out"),"w");
+		
+		// Print final state for individual mRNAs
+		for(c1=0;c1<C->n_mRNA;c1++)
+		{	if(Grid_Get(R_grid, c1, 0)==tot_ribo)
+		{	fprintf(f6,"0");
+		}
+		else
+		{	fprintf(f6,"1");
+		}
+			
+			for(c2=1;c2<Gene[mRNA[c1].gene].len;c2++)
+			{	if(Grid_Get(R_grid, c1, c2)==tot_ribo)
+			{	fprintf(f6," 0");
+			}
+			else
+			{	fprintf(f6," 1");
+			}
+			}
+			fprintf(f6,"\n");
+		}
+		fclose(f6);
+	}
+	
+	// Time spent by stalled ribosomes on each gene
+	if(printOpt[5]==1)
+	{	strcpy(out_file,prefix);
+		f7 = Output_Open(strcat(out_file,"_gene0_pos_stall_ribo.out"),"w");
+		
+		fprintf(f7,"Pos\tAvg_ribo_stall\n");
+		for(c1=0;c1<Gene[0].len;c1++)
+		{	time_waste_ribo_pos[c1] = time_waste_ribo_pos[c1]/(tot_time-thresh_time);
+			fprintf(f7,"%d\t%g\n",c1,time_waste_ribo_pos[c1]);
+		}
+		fclose(f7);
+		
+		strcpy(out_file,prefix);
+		f8 = Output_Open(strcat(out_file,"_allgene_stall_ribo.out"),"w");
+		fprintf(f8,"Gene\tAvg_ribo_stall\n");
+		for(c1=0;c1<n_genes;c1++)
+		{	time_waste_ribo[c1] = time_waste_ribo[c1]/(tot_time-thresh_time);
+			fprintf(f8,"%d\t%g\n",c1,time_waste_ribo[c1]);
+		}
+		fclose(f8);
+	}
+	
+	// Time spent by stalled ribosomes at each position of the tracked genes, only positions where ribosomes stalled
+	if(stall_off!=NULL)
+	{	strcpy(out_file,prefix);
+		f8 = Output_Open(strcat(out_file,"_gene_pos_stall_ribo.out"),"w");
+		fprintf(f8,"Gene\tPos\tAvg_ribo_stall\n");
+		for(c1=0;c1<n_genes;c1++)
+		{	if(stall_off[c1]<0)
+			{	continue;
+			}
+			for(c2=0;c2<Gene[c1].len;c2++)
+			{	if(C->stall_time[stall_off[c1]+c2]!=0)
+				{	fprintf(f8,"%d\t%d\t%g\n",c1,c2,C->stall_time[stall_off[c1]+c2]/(tot_time-thresh_time));
+				}
+			}
+		}
+		fclose(f8);
+	}
+	
+	
+	if(printOpt[6]==1)
+	{	strcpy(out_file,prefix);
+		f9 = Output_Open(strcat(out_file,"_gene_pos_sp_ribo_500.out"),"w");
+		
+		for(c1=0;c1<n_genes;c1++)
+		{	fprintf(f9,"%d",gene_sp_ribo_500[c1][0]);
+			for(c2=1;c2<Gene[c1].len;c2++)
+			{	fprintf(f9," %d",gene_sp_ribo_500[c1][c2]);
+			}
+			fprintf(f9,"\n");
+		}
+		fclose(f9);
+	}
+	
+	
+	// The final state of the system - positions of bound ribosomes on mRNAs and genes
+	if(printOpt[7]==1 || printOpt[8]==1)
+	{	// Initialize the gene position specific ribosome density array
+		for(c1=0;c1<n_genes;c1++)
+		{	for(c2=0;c2<Gene[c1].len;c2++)
+			{	gene_sp_ribo[c1][c2] = 0;
+				gene_sp_ribo_ns[c1][c2] = 0;
+			}
+		}
+		
+		// Initialize the avg position specific ribosome density array
+		for(c1=0;c1<obs_max_len;c1++)
+		{	avg_ribo_pos[0][c1] = 0.0;
+			avg_ribo_pos[1][c1] = 0.0;
+			avg_ribo_pos[2][c1] = 0.0;
+			avg_ribo_pos[3][c1] = 0.0;
+			gcount[c1] = 0;
+		}
+		
+		// Final state for individual mRNAs
+		for(c1=0;c1<C->n_mRNA;c1++)
+		{	if(Grid_Get(R_grid, c1, 0)!=tot_ribo)
+			{	gene_sp_ribo[mRNA[c1].gene][0]++;
+				if(Grid_Get(R_grid, c1, 10)==tot_ribo)
+				{	gene_sp_ribo_ns[mRNA[c1].gene][0]++;
+				}
+			}
+			
+			for(c2=1;c2<Gene[mRNA[c1].gene].len;c2++)
+			{	if(Grid_Get(R_grid, c1, c2)!=tot_ribo)
+				{	gene_sp_ribo[mRNA[c1].gene][c2]++;
+					if(Grid_Get(R_grid, c1, c2+10)==tot_ribo || (c2+10)>Gene[mRNA[c1].gene].len)
+					{	if(c2<10 || Grid_Get(R_grid, c1, c2-10)==tot_ribo)
+						{	gene_sp_ribo_ns[mRNA[c1].gene][c2]++;
+						}
 					}
+				}
+			}
+		}
+		
+		// Calculate final density on each position of a gene
+		for(c1=0;c1<n_genes;c1++)
+		{	n_tot = 0;
+			n_tot_ns = 0;
+			
+			gcount[0]++;
+			n_tot += gene_sp_ribo[c1][0];
+			n_tot_ns += gene_sp_ribo_ns[c1][0];
+			
+			for(c2=1;c2<Gene[c1].len;c2++)
+			{	gcount[c2]++;
+				n_tot += gene_sp_ribo[c1][c2];
+				n_tot_ns += gene_sp_ribo_ns[c1][c2];
+			}
+			
+			gmean = (double)n_tot/(double)Gene[c1].len;
+			gmean_ns = (double)n_tot_ns/(double)Gene[c1].len;
+			for(c2=0;c2<Gene[c1].len;c2++)
+			{	if(gmean>0)
+				{	avg_ribo_pos[0][c2] += (double)gene_sp_ribo[c1][c2]/gmean;
+				}
+				if(gmean_ns>0)
+				{	avg_ribo_pos[2][c2] += (double)gene_sp_ribo_ns[c1][c2]/gmean_ns;
+				}
+				avg_ribo_pos[1][c2] += (double)gene_sp_ribo[c1][c2]/(double)Gene[c1].exp;
+				avg_ribo_pos[3][c2] += (double)gene_sp_ribo_ns[c1][c2]/(double)Gene[c1].exp;
+			}
+		}
+		
+		if(printOpt[7]==1)
+		{	strcpy(out_file,prefix);
+			f9 = Output_Open(strcat(out_file,"_gene_pos_sp_ribo.out"),"w");
+			
+			for(c1=0;c1<n_genes;c1++)
+			{	fprintf(f9,"%d",gene_sp_ribo[c1][0]);
+				for(c2=1;c2<Gene[c1].len;c2++)
+				{	fprintf(f9," %d",gene_sp_ribo[c1][c2]);
+				}
+				fprintf(f9,"\n");
+			}
+			fclose(f9);
+			
+			strcpy(out_file,prefix);
+			f11 = Output_Open(strcat(out_file,"_gene_pos_sp_ribo_nostall.out"),"w");
+			
+			for(c1=0;c1<n_genes;c1++)
+			{	fprintf(f11,"%d",gene_sp_ribo_ns[c1][0]);
+				for(c2=1;c2<Gene[c1].len;c2++)
+				{	fprintf(f11," %d",gene_sp_ribo_ns[c1][c2]);
+				}
+				fprintf(f11,"\n");
+			}
+			fclose(f11);
+		}
+		
+		if(printOpt[8]==1)
+		{	strcpy(out_file,prefix);
+			f10 = Output_Open(strcat(out_file,"_avg_pos_sp_ribo.out"),"w");
+			fprintf(f10,"Pos\tRPF_avg\tmRNA_avg\tRPF_avg_nostall\tmRNA_avg_nostall\n");
+			for(c2=0;c2<obs_max_len;c2++)
+			{	c1 = c2+1;
+				avg_ribo_pos[0][c2] /= (double)gcount[c2];
+				avg_ribo_pos[1][c2] /= (double)gcount[c2];
+				avg_ribo_pos[2][c2] /= (double)gcount[c2];
+				avg_ribo_pos[3][c2] /= (double)gcount[c2];
+				fprintf(f10,"%d\t%g\t%g\t%g\t%g\n",c1,avg_ribo_pos[0][c2],avg_ribo_pos[1][c2],avg_ribo_pos[2][c2],avg_ribo_pos[3][c2]);
+			}
+			fclose(f10);
+		}
+	}
+	
+	
+	// Summary statistics of this replicate for merging across replicates
+	if(Res != NULL)
+	{	Res->seed = C->seed;
+		for(c1=0;c1<61;c1++)
+		{	Res->n_etimes[c1] = n_e_times[c1];
+			Res->etimes[c1] = e_times[c1]/(double)n_e_times[c1];
+			Res->avg_tRNA[c1] = avg_tRNA_abndc[c1];
+		}
+		Res->avg_Rf = avg_Rf;
+		if(printOpt[1]==1 || printOpt[2]==1)
+		{	for(c1=0;c1<n_genes;c1++)
+			{	Res->n_trans[c1] = n_trans[c1];
+				Res->g_etimes[c1] = g_etimes[c1]/(double)n_trans[c1];
+				Res->g_ini[c1] = g_ini[c1]/(double)n_trans[c1];
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Write (save=1) or read (save=0) one block of a checkpoint
+void Checkpoint_IO(FILE *fh, int save, void *data, size_t size)
+{	size_t n;
+	
+	if(size == 0)
+	{	return;
+	}
+	n = save ? fwrite(data, 1, size, fh) : fread(data, 1, size, fh);
+	if(n != size)
+	{	printf("\nCheckpoint file could not be %s\n", save ? "written" : "read (truncated?)");fflush(stdout);
+		exit(1);
+	}
+}
+
+// Save or restore the propensities of a table in the layout of its event selection method
+void Prop_Table_IO(proptable *prop, FILE *fh, int save)
+{	int b;
+	crtable *cr = &prop->cr;
+	nrmqueue *q = &prop->nrm;
+	
+	if(prop->engine == ENGINE_CR)
+	{	Checkpoint_IO(fh, save, cr->rate, sizeof(double) * cr->n_leaves);
+		Checkpoint_IO(fh, save, cr->bin, sizeof(int) * cr->n_leaves);
+		Checkpoint_IO(fh, save, cr->bin_pos, sizeof(int) * cr->n_leaves);
+		Checkpoint_IO(fh, save, cr->n_member, sizeof(int) * CR_N_BINS);
+		for(b=0;b<CR_N_BINS;b++)
+		{	if(!save && cr->n_member[b] > cr->max_member[b])
+			{	cr->max_member[b] = cr->n_member[b];
+				cr->member[b] = (int *)realloc(cr->member[b], sizeof(int) * cr->max_member[b]);
+				if(cr->member[b] == NULL)
+				{	printf("Too many reaction channels\nOut of memory\n");fflush(stdout);
+					exit(1);
+				}
+			}
+			Checkpoint_IO(fh, save, cr->member[b], sizeof(int) * cr->n_member[b]);
+		}
+		Checkpoint_IO(fh, save, cr->bin_tree.node, sizeof(double) * 2 * cr->bin_tree.size);
+		Checkpoint_IO(fh, save, &cr->n_updates, sizeof(int));
+	}
+	else if(prop->engine == ENGINE_NRM)
+	{	Checkpoint_IO(fh, save, q->rate, sizeof(double) * q->n_leaves);
+		Checkpoint_IO(fh, save, q->tau, sizeof(double) * q->n_leaves);
+		Checkpoint_IO(fh, save, q->rem, sizeof(double) * q->n_leaves);
+		Checkpoint_IO(fh, save, q->heap, sizeof(int) * q->n_leaves);
+		Checkpoint_IO(fh, save, q->heap_pos, sizeof(int) * q->n_leaves);
+		Checkpoint_IO(fh, save, &q->now, sizeof(double));
+	}
+	else
+	{	Checkpoint_IO(fh, save, prop->tree.node, sizeof(double) * 2 * prop->tree.size);
+	}
+}
+
+// Save or restore the complete state of a cell, including the random number generator
+// The same list of fields is used in both directions so that writer and reader cannot disagree.
+// The grid is stored as the (position, ribosome id) pairs of each mRNA, which does not depend on the grid layout.
+void Cell_Checkpoint_IO(cell *C, FILE *fh, int save)
+{	int c1, c2, n;
+	int pair[2];
+	char magic[8];
+	char rng_name[32];
+	char file_rng_name[32];
+	int head[8];										// Version, size of the simulated system and the time averages kept (-p4, -p6)
+	int file_head[8];
+	int tot_ribo = C->par.tot_ribo;
+	int tot_mRNA = C->n_mRNA;
+	int n_genes = C->par.n_genes;
+	int engine = C->par.engine;
+	int n_stall_pos = C->par.n_stall_pos;
+	
+	memset(rng_name, 0, sizeof(rng_name));
+	strncpy(rng_name, Rng_Name(C->r), sizeof(rng_name)-1);
+	head[0] = CKPT_VERSION;
+	head[1] = n_genes;
+	head[2] = tot_mRNA;
+	head[3] = tot_ribo;
+	head[4] = engine;
+	head[5] = 0;
+	for(c1=0;c1<n_genes;c1++)
+	{	head[5] += C->Gene[c1].len;
+	}
+	head[6] = C->par.printOpt[3];
+	head[7] = C->par.printOpt[5];
+	
+	if(save)
+	{	memcpy(magic, CKPT_MAGIC, 8);
+		Checkpoint_IO(fh, save, magic, 8);
+		Checkpoint_IO(fh, save, head, sizeof(head));
+		Checkpoint_IO(fh, save, rng_name, sizeof(rng_name));
+	}
+	else
+	{	Checkpoint_IO(fh, save, magic, 8);
+		if(memcmp(magic, CKPT_MAGIC, 8) != 0)
+		{	printf("\nNot a checkpoint file\n");fflush(stdout);
+			exit(1);
+		}
+		Checkpoint_IO(fh, save, file_head, sizeof(file_head));
+		if(file_head[0] != CKPT_VERSION)
+		{	printf("\nCheckpoint version %d is not supported (expected %d)\n",file_head[0],CKPT_VERSION);fflush(stdout);
+			exit(1);
+		}
+		if(file_head[1] != head[1] || file_head[2] != head[2] || file_head[5] != head[5])
+		{	printf("\nCheckpoint was written for a different genome (%d genes, %d mRNAs, %d codons)\n",file_head[1],file_head[2],file_head[5]);fflush(stdout);
+			exit(1);
+		}
+		if(file_head[3] != head[3])
+		{	printf("\nCheckpoint was written for %d ribosomes\n",file_head[3]);fflush(stdout);
+			exit(1);
+		}
+		if(file_head[4] != head[4])
+		{	printf("\nCheckpoint was written with another simulation engine (-E)\n");fflush(stdout);
+			exit(1);
+		}
+		if(file_head[6] != head[6] || file_head[7] != head[7])
+		{	printf("\nCheckpoint was written with -p4 %s and -p6 %s\n",(file_head[6]==1) ? "on" : "off",(file_head[7]==1) ? "on" : "off");fflush(stdout);
+			exit(1);
+		}
+		Checkpoint_IO(fh, save, file_rng_name, sizeof(file_rng_name));
+		if(strncmp(file_rng_name, rng_name, sizeof(rng_name)) != 0)
+		{	printf("\nCheckpoint was written with another random number generator\n");fflush(stdout);
+			exit(1);
+		}
+	}
+	
+	// Scalars
+	Checkpoint_IO(fh, save, &C->t, sizeof(double));
+	Checkpoint_IO(fh, save, &C->Rf, sizeof(int));
+	Checkpoint_IO(fh, save, &C->Rfh, sizeof(int));
+	Checkpoint_IO(fh, save, &C->next_avail_ribo, sizeof(int));
+	Checkpoint_IO(fh, save, &C->tot_stall_chx, sizeof(int));
+	Checkpoint_IO(fh, save, &C->avg_Rf, sizeof(double));
+	Checkpoint_IO(fh, save, &C->t_print, sizeof(int));
+	if(!save && (C->next_avail_ribo < 0 || C->next_avail_ribo > tot_ribo || C->tot_stall_chx < 0 || C->tot_stall_chx > tot_ribo))
+	{	printf("\nCorrupt ribosome counts in checkpoint file\n");fflush(stdout);
+		exit(1);
+	}
+	
+	// Ribosomes, mRNAs, tRNAs and the lists of elongatable ribosomes and initiable mRNAs
+	Checkpoint_IO(fh, save, C->Ribo.site, sizeof(ribo_site) * tot_ribo);
+	Checkpoint_IO(fh, save, C->Ribo.elng, sizeof(ribo_elng) * tot_ribo);
+	Checkpoint_IO(fh, save, C->Ribo.t_trans_ini, sizeof(double) * tot_ribo);
+	Checkpoint_IO(fh, save, C->Ribo.t_elong_ini, sizeof(double) * tot_ribo);
+	Checkpoint_IO(fh, save, C->mRNA, sizeof(transcript) * tot_mRNA);
+	Checkpoint_IO(fh, save, C->Tf, sizeof(int) * 61);
+	Checkpoint_IO(fh, save, C->n_Rb_e, sizeof(int) * 61);
+	for(c1=0;c1<61;c1++)
+	{	if(!save && (C->n_Rb_e[c1] < 0 || C->n_Rb_e[c1] > tot_ribo))
+		{	printf("\nCorrupt lists of elongatable ribosomes in checkpoint file\n");fflush(stdout);
+			exit(1);
+		}
+		Checkpoint_IO(fh, save, C->Rb_e[c1], sizeof(int) * C->n_Rb_e[c1]);
+	}
+	Checkpoint_IO(fh, save, C->chx_r_id, sizeof(int) * C->tot_stall_chx);
+	Checkpoint_IO(fh, save, C->Mf, sizeof(int) * n_genes);
+	for(c1=0;c1<n_genes;c1++)
+	{	Checkpoint_IO(fh, save, C->free_mRNA[c1], sizeof(int) * C->Gene[c1].exp);
+	}
+	
+	// Accumulated statistics
+	Checkpoint_IO(fh, save, C->n_e_times, sizeof(int) * 61);
+	Checkpoint_IO(fh, save, C->e_times, sizeof(double) * 61);
+	Checkpoint_IO(fh, save, C->avg_tRNA_abndc, sizeof(double) * 61);
+	Checkpoint_IO(fh, save, C->num_waste_ribo, sizeof(int) * n_genes);
+	Checkpoint_IO(fh, save, C->num_stall_chx, sizeof(int) * n_genes);
+	Checkpoint_IO(fh, save, C->time_waste_ribo, sizeof(double) * n_genes);
+	Checkpoint_IO(fh, save, C->num_waste_ribo_pos, sizeof(int) * C->Gene[0].len);
+	Checkpoint_IO(fh, save, C->time_waste_ribo_pos, sizeof(double) * C->Gene[0].len);
+	Checkpoint_IO(fh, save, &C->avg_started, sizeof(int));						// Counters not yet added to the time averages
+	Checkpoint_IO(fh, save, C->Tf_held, sizeof(lazy_count) * 61);
+	Checkpoint_IO(fh, save, &C->Rf_held, sizeof(lazy_count));
+	Checkpoint_IO(fh, save, C->waste_held, sizeof(lazy_count) * n_genes);
+	Checkpoint_IO(fh, save, C->waste_pos_held, sizeof(lazy_count) * C->Gene[0].len);
+	n = n_stall_pos;
+	Checkpoint_IO(fh, save, &n, sizeof(int));
+	if(n != n_stall_pos)
+	{	printf("\nCheckpoint was written with other genes tracked by -ps\n");fflush(stdout);
+		exit(1);
+	}
+	Checkpoint_IO(fh, save, C->stall_held, sizeof(lazy_count) * n_stall_pos);
+	Checkpoint_IO(fh, save, C->stall_time, sizeof(double) * n_stall_pos);
+	for(c1=0;c1<n_genes;c1++)
+	{	Checkpoint_IO(fh, save, C->gene_sp_ribo_500[c1], sizeof(int) * C->Gene[c1].len);
+	}
+	
+	// Ribosome grid
+	if(!save)
+	{	Grid_Free(&C->R_grid);
+		if(Grid_Init(&C->R_grid, C->mRNA, C->Gene, C->n_mRNA, tot_ribo) == 0)
+		{	printf("Out of memory\n");fflush(stdout);
+			exit(1);
+		}
+	}
+	for(c1=0;c1<tot_mRNA;c1++)
+	{	n = 0;
+		if(save)
+		{	for(c2=0;c2<C->Gene[C->mRNA[c1].gene].len;c2++)
+			{	if(Grid_Get(&C->R_grid, c1, c2) != tot_ribo)
+				{	n++;
+				}
+			}
+		}
+		Checkpoint_IO(fh, save, &n, sizeof(int));
+		if(save)
+		{	for(c2=0;c2<C->Gene[C->mRNA[c1].gene].len;c2++)
+			{	if(Grid_Get(&C->R_grid, c1, c2) != tot_ribo)
+				{	pair[0] = c2;
+					pair[1] = Grid_Get(&C->R_grid, c1, c2);
+					Checkpoint_IO(fh, save, pair, sizeof(pair));
+				}
+			}
+		}
+		else
+		{	for(c2=0;c2<n;c2++)
+			{	Checkpoint_IO(fh, save, pair, sizeof(pair));
+				if(pair[0] < 0 || pair[0] >= C->Gene[C->mRNA[c1].gene].len || pair[1] < 0 || pair[1] >= tot_ribo)
+				{	printf("\nCorrupt ribosome grid in checkpoint file\n");fflush(stdout);
+					exit(1);
+				}
+				Grid_Set(&C->R_grid, c1, pair[0], pair[1]);
+			}
+		}
+	}
+	
+	// Propensities and random number generator
+	Prop_Table_IO(&C->gene_prop, fh, save);
+	Prop_Table_IO(&C->chn_prop, fh, save);
+	if(C->r->type == RNG_MT19937)
+	{	Checkpoint_IO(fh, save, gsl_rng_state(C->r->gsl), gsl_rng_size(C->r->gsl));
+	}
+	else
+	{	Checkpoint_IO(fh, save, &C->r->st, sizeof(rng_state));
+	}
+	
+	// End marker to detect truncated files
+	memcpy(magic, CKPT_MAGIC, 8);
+	if(save)
+	{	Checkpoint_IO(fh, save, magic, 8);
+	}
+	else
+	{	Checkpoint_IO(fh, save, magic, 8);
+		if(memcmp(magic, CKPT_MAGIC, 8) != 0)
+		{	printf("\nCheckpoint file is corrupt\n");fflush(stdout);
+			exit(1);
+		}
+	}
+}
+
+// Write a checkpoint of the cell
+// The file is written under a temporary name and renamed, so an interrupted run never leaves a partial checkpoint
+void Write_Checkpoint(cell *C, char *filename)
+{	FILE *fh;
+	char tmp_file[220];
+	
+	sprintf(tmp_file,"%s.tmp",filename);
+	fh = fopen(tmp_file,"wb");
+	if(fh == NULL)
+	{	printf("\nCould not write checkpoint file %s\n",tmp_file);fflush(stdout);
+		exit(1);
+	}
+	Cell_Checkpoint_IO(C, fh, 1);
+	if(fclose(fh) != 0 || rename(tmp_file, filename) != 0)
+	{	printf("\nCould not write checkpoint file %s\n",filename);fflush(stdout);
+		exit(1);
+	}
+}
+
+// Restore a cell set up by Cell_Init from a checkpoint
+void Read_Checkpoint(cell *C, char *filename)
+{	FILE *fh;
+	
+	fh = fopen(filename,"rb");
+	if(fh == NULL)
+	{	printf("\nCheckpoint file %s not found\n",filename);fflush(stdout);
+		exit(1);
+	}
+	Cell_Checkpoint_IO(C, fh, 0);
+	fclose(fh);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Result cache (-Oc)
+// A run is fully determined by the binary, its command line (but for -O, -Oc, -j, -L and -Lp) and the contents of
+// its input files. The SHA-256 of all of these keys an entry <cache_dir>/<key> holding the outputs of the run,
+// named without their prefix, and manifest.txt with their provenance. Entries are written under a temporary name
+// and renamed when complete, so concurrent runs never see half an entry. <cache_dir>/index.tsv lists the entries.
+
+static const uint32_t sha_k[64] = {
+	0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
+	0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
+	0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
+	0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2};
+
+static inline uint32_t Rotr(uint32_t x, int k)
+{	return (x >> k) | (x << (32 - k));
+}
+
+void Sha_Init(sha256 *S)
+{	static const uint32_t h0[8] = {0x6a09e667,0xbb67ae85,0x3c6ef372,0xa54ff53a,0x510e527f,0x9b05688c,0x1f83d9ab,0x5be0cd19};
+	
+	memcpy(S->h, h0, sizeof(h0));
+	S->len = 0;
+}
+
+void Sha_Block(sha256 *S, const uint8_t *p)
+{	uint32_t w[64], v[8], t1, t2;
+	int c1;
+	
+	for(c1=0;c1<16;c1++)
+	{	w[c1] = ((uint32_t)p[4*c1] << 24) | ((uint32_t)p[4*c1+1] << 16) | ((uint32_t)p[4*c1+2] << 8) | (uint32_t)p[4*c1+3];
+	}
+	for(c1=16;c1<64;c1++)
+	{	w[c1] = w[c1-16] + (Rotr(w[c1-15],7) ^ Rotr(w[c1-15],18) ^ (w[c1-15] >> 3)) + w[c1-7] + (Rotr(w[c1-2],17) ^ Rotr(w[c1-2],19) ^ (w[c1-2] >> 10));
+	}
+	memcpy(v, S->h, sizeof(v));
+	for(c1=0;c1<64;c1++)
+	{	t1 = v[7] + (Rotr(v[4],6) ^ Rotr(v[4],11) ^ Rotr(v[4],25)) + ((v[4] & v[5]) ^ (~v[4] & v[6])) + sha_k[c1] + w[c1];
+		t2 = (Rotr(v[0],2) ^ Rotr(v[0],13) ^ Rotr(v[0],22)) + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+		memmove(v+1, v, sizeof(uint32_t) * 7);
+		v[4] += t1;
+		v[0] = t1 + t2;
+	}
+	for(c1=0;c1<8;c1++)
+	{	S->h[c1] += v[c1];
+	}
+}
+
+void Sha_Update(sha256 *S, const void *data, size_t n)
+{	const uint8_t *p = (const uint8_t *)data;
+	size_t fill;
+	
+	while(n > 0)
+	{	fill = S->len % 64;
+		if(fill == 0 && n >= 64)
+		{	Sha_Block(S, p);
+			p += 64;
+			n -= 64;
+			S->len += 64;
+			continue;
+		}
+		S->buf[fill] = *p++;
+		n--;
+		S->len++;
+		if(fill == 63)
+		{	Sha_Block(S, S->buf);
+		}
+	}
+}
+
+// Pad the last block and write the hash as 64 hexadecimal digits
+void Sha_Final(sha256 *S, char *hex)
+{	uint8_t pad = 0x80, zero = 0, bits[8];
+	uint64_t len = S->len*8;
+	int c1;
+	
+	Sha_Update(S, &pad, 1);
+	while(S->len % 64 != 56)
+	{	Sha_Update(S, &zero, 1);
+	}
+	for(c1=0;c1<8;c1++)
+	{	bits[c1] = (uint8_t)(len >> (56 - 8*c1));
+	}
+	Sha_Update(S, bits, 8);
+	for(c1=0;c1<8;c1++)
+	{	sprintf(hex+8*c1, "%08x", S->h[c1]);
+	}
+}
+
+// Hash of the contents of a file as hex, "missing" if it cannot be read
+void Sha_File(char *filename, char *hex)
+{	sha256 S;
+	FILE *fh;
+	uint8_t buf[65536];
+	size_t n;
+	
+	fh = fopen(filename, "rb");
+	if(fh == NULL)
+	{	strcpy(hex, "missing");
+		return;
+	}
+	Sha_Init(&S);
+	while((n = fread(buf, 1, sizeof(buf), fh)) > 0)
+	{	Sha_Update(&S, buf, n);
+	}
+	fclose(fh);
+	Sha_Final(&S, hex);
+}
+
+// Key of the run (cache_key) and its provenance (cache_manifest), from the parsed command line
+void Cache_Key(int argc, char *argv[])
+{	sha256 S;
+	FILE *fh;
+	size_t size;
+	char hex[65];
+	int c1, c2;
+	char *skip[5] = {"-O","-Oc","-j","-L","-Lp"};				// Options that do not change the outputs, with their values
+	char *opt[9] = {"-F","-Ff","-Fg","-Fm","-C","-J","-Fs","-k","-S"};
+	char *file[9] = {fasta_file,orf_fasta_file,gcode_file,abndc_file,code_file,state_file,stall_genes_file,resume_file,sweep_file};
+	int used[9];
+	
+	used[0] = (strcmp(orf_fasta_file, "") == 0);
+	used[1] = !used[0];
+	used[2] = !used[0];
+	used[3] = !used[0];
+	used[4] = 1;
+	used[5] = (strcmp(state_file, "") != 0);
+	used[6] = (stall_opt==1 && strcmp(stall_genes_file, "") != 0);
+	used[7] = (strcmp(resume_file, "") != 0);
+	used[8] = (strcmp(sweep_file, "") != 0);
+	
+	fh = open_memstream(&cache_manifest, &size);
+	if(fh == NULL)
+	{	printf("Out of memory\n");fflush(stdout);
+		exit(1);
+	}
+	Sha_Init(&S);
+	sprintf(hex, "SMoPT result cache %d", CACHE_VERSION);
+	Sha_Update(&S, hex, strlen(hex)+1);
+	
+	Sha_File("/proc/self/exe", hex);
+	if(strcmp(hex, "missing") == 0)
+	{	Sha_File(argv[0], hex);
+	}
+	Sha_Update(&S, hex, 64);
+	fprintf(fh,"Binary\t%s\t%s\n",argv[0],hex);
+	
+	fprintf(fh,"Command\t%s",argv[0]);
+	for(c1=1;c1<argc;c1++)
+	{	fprintf(fh," %s",argv[c1]);
+		for(c2=0;c2<5 && strcmp(argv[c1], skip[c2]) != 0;c2++);
+		if(c2<5)
+		{	if(c1<argc-1)
+			{	fprintf(fh," %s",argv[++c1]);
+			}
+			continue;
+		}
+		Sha_Update(&S, argv[c1], strlen(argv[c1])+1);
+	}
+	fprintf(fh,"\n");
+	
+	for(c1=0;c1<9;c1++)
+	{	if(used[c1])
+		{	Sha_File(file[c1], hex);
+			Sha_Update(&S, opt[c1], strlen(opt[c1])+1);
+			Sha_Update(&S, hex, strlen(hex)+1);
+			fprintf(fh,"Input\t%s\t%s\t%s\n",opt[c1],file[c1],hex);
+		}
+	}
+	fclose(fh);
+	Sha_Final(&S, cache_key);
+}
+
+// Key of point k of a sweep
+void Cache_Point_Key(int k, char *key)
+{	sha256 S;
+	char tag[32];
+	
+	Sha_Init(&S);
+	Sha_Update(&S, cache_key, 64);
+	sprintf(tag, "pt%d", k);
+	Sha_Update(&S, tag, strlen(tag)+1);
+	Sha_Final(&S, key);
+}
+
+int Copy_File(char *from, char *to)
+{	FILE *fi, *fo;
+	char buf[65536];
+	size_t n;
+	int ok = 1;
+	
+	fi = fopen(from, "rb");
+	if(fi == NULL)
+	{	return 0;
+	}
+	fo = fopen(to, "wb");
+	if(fo == NULL)
+	{	fclose(fi);
+		return 0;
+	}
+	while((n = fread(buf, 1, sizeof(buf), fi)) > 0)
+	{	ok = ok && (fwrite(buf, 1, n, fo) == n);
+	}
+	fclose(fi);
+	return (fclose(fo) == 0) && ok;
+}
+
+// Copy the outputs of an entry to <prefix><name>. Returns 0 if the entry does not exist.
+int Cache_Restore(char *key, char *prefix)
+{	DIR *dir;
+	struct dirent *e;
+	char path[400], to[400];
+	int ok = 1;
+	
+	if(snprintf(path, sizeof(path), "%s/%s", cache_dir, key) >= (int)sizeof(path))
+	{	return 0;
+	}
+	dir = opendir(path);
+	if(dir == NULL)
+	{	return 0;
+	}
+	while((e = readdir(dir)) != NULL)
+	{	if(e->d_name[0] == '_')
+		{	ok = ok && snprintf(path, sizeof(path), "%s/%s/%s", cache_dir, key, e->d_name) < (int)sizeof(path);
+			ok = ok && snprintf(to, sizeof(to), "%s%s", prefix, e->d_name) < (int)sizeof(to);
+			ok = ok && Copy_File(path, to);
+		}
+	}
+	closedir(dir);
+	if(!ok)
+	{	printf("\nCannot restore the outputs of cache entry %s to %s\n",key,prefix);fflush(stdout);
+		exit(1);
+	}
+	return 1;
+}
+
+// Remove a temporary entry of the result cache
+void Cache_Remove_Tmp(char *tmp)
+{	DIR *dir;
+	struct dirent *e;
+	char path[400];
+	
+	dir = opendir(tmp);
+	while(dir != NULL && (e = readdir(dir)) != NULL)
+	{	if(snprintf(path, sizeof(path), "%s/%s", tmp, e->d_name) < (int)sizeof(path))
+		{	unlink(path);
+		}
+	}
+	if(dir != NULL)
+	{	closedir(dir);
+	}
+	rmdir(tmp);
+}
+
+// Give up writing the temporary entry tmp ("" if not created yet) of the result cache
+void Cache_Write_Error(char *tmp)
+{	if(strcmp(tmp, "") != 0)
+	{	Cache_Remove_Tmp(tmp);
+	}
+	printf("\nCannot write to the result cache %s\n",cache_dir);fflush(stdout);
+	exit(1);
+}
+
+// Store the outputs the run opened with the prefix (Output_Open) as the entry key, with the summary of a sweep
+// point if not NULL. An entry stored in the meantime by another run is kept.
+void Cache_Store(char *key, char *prefix, char *point)
+{	struct stat st;
+	FILE *fh;
+	char tmp[400], to[400], path[400], date[32];
+	char *name;
+	int c1, ok = 1;
+	time_t now = time(NULL);
+	
+	mkdir(cache_dir, 0777);
+	if(snprintf(tmp, sizeof(tmp), "%s/.%s.%d", cache_dir, key, (int)getpid()) >= (int)sizeof(tmp))
+	{	Cache_Write_Error("");
+	}
+	if(mkdir(tmp, 0777) != 0)
+	{	printf("\nCannot write to the result cache %s\n",cache_dir);fflush(stdout);
+		return;
+	}
+	strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&now));
+	fh = NULL;
+	if(snprintf(path, sizeof(path), "%s/manifest.txt", tmp) < (int)sizeof(path))
+	{	fh = fopen(path, "w");
+	}
+	if(fh == NULL)
+	{	Cache_Write_Error(tmp);
+	}
+	fprintf(fh,"Key\t%s\nCreated\t%s\nPrefix\t%s\n%s",key,date,prefix,cache_manifest);
+	
+	// Outputs are stored under their name after the prefix, <prefix>_etimes.out as _etimes.out
+	pthread_mutex_lock(&cache_lock);
+	for(c1=0;c1<n_cache_outputs && ok;c1++)
+	{	name = cache_outputs[c1]+strlen(prefix);
+		if(strncmp(cache_outputs[c1], prefix, strlen(prefix)) != 0 || name[0] != '_')
+		{	continue;
+		}
+		ok = snprintf(to, sizeof(to), "%s/%s", tmp, name) < (int)sizeof(to) && stat(cache_outputs[c1], &st) == 0 && Copy_File(cache_outputs[c1], to);
+		if(ok)
+		{	fprintf(fh,"Output\t%s\t%ld\n",name,(long)st.st_size);
+		}
+	}
+	pthread_mutex_unlock(&cache_lock);
+	if(!ok)
+	{	fclose(fh);
+		Cache_Write_Error(tmp);
+	}
+	if(fclose(fh) != 0)
+	{	Cache_Write_Error(tmp);
+	}
+	if(point != NULL)
+	{	fh = NULL;
+		if(snprintf(path, sizeof(path), "%s/sweep_point.out", tmp) < (int)sizeof(path))
+		{	fh = fopen(path, "w");
+		}
+		if(fh == NULL)
+		{	Cache_Write_Error(tmp);
+		}
+		fprintf(fh,"%s\n",point);
+		if(fclose(fh) != 0)
+		{	Cache_Write_Error(tmp);
+		}
+	}
+	
+	if(snprintf(path, sizeof(path), "%s/%s", cache_dir, key) >= (int)sizeof(path) || rename(tmp, path) != 0)
+	{	Cache_Remove_Tmp(tmp);
+		return;
+	}
+	fh = NULL;
+	if(snprintf(path, sizeof(path), "%s/index.tsv", cache_dir) < (int)sizeof(path))
+	{	fh = fopen(path, "a");
+	}
+	if(fh != NULL)
+	{	fprintf(fh,"%s\t%s\t%s\n",key,date,prefix);
+		fclose(fh);
+	}
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifdef SMOPT_BENCH
+// Print the event counts and timings of a cell as one line of JSON (bench build)
+// ns_per_event of each type is estimated from the timed events, which include the cost of reading the clock
+void Bench_Report(cell *C, int rep)
+{	int c1;
+	struct rusage usage;
+	char *engines[3] = {"direct","cr","nrm"};
+	
+	getrusage(RUSAGE_SELF, &usage);
+	printf("{\"bench\":1,\"replicate\":%d,\"engine\":\"%s\",\"domains\":%d,\"events\":%ld,\"sim_time\":%.17g,\"run_s\":%.6f,",rep,engines[engine],n_domains,C->bench.n_events,C->t,C->bench.run_s);
+	printf("\"events_per_s\":%.6g,\"ns_per_event\":%.6g,",(C->bench.run_s>0) ? C->bench.n_events/C->bench.run_s : 0,(C->bench.n_events>0) ? 1e9*C->bench.run_s/C->bench.n_events : 0);
+	printf("\"startup_s\":%.6f,\"peak_rss_kb\":%ld,\"by_type\":{",C->bench.startup_s,(long)usage.ru_maxrss);		// ru_maxrss is in bytes on OSX
+	for(c1=0;c1<EV_TYPES;c1++)
+	{	printf("%s\"%s\":{\"events\":%ld,\"ns_per_event\":%.6g}",(c1>0) ? "," : "",ev_names[c1],C->bench.n[c1],(C->bench.n_timed[c1]>0) ? C->bench.ns_timed[c1]/C->bench.n_timed[c1] : 0);
+	}
+	printf("}}\n");
+	fflush(stdout);
+}
+#endif
+
+// Simulate the translation process in one cell
+// Gene and code are only read, so several cells can be simulated at the same time from the same inputs.
+// Replicate rep draws from its random stream (the seed seed+rep with MT19937). Output files are written with the given prefix and,
+// if Res is not NULL, summary statistics are stored in Res.
+void Simulate_Cell(gene *Gene, trna *code, int rep, char *prefix, replicate *Res)
+{	cell C;
+	char ckpt_name[200];
+	char traj_name[200];
+	double t_stop = tot_time;
+	
+	if(Cell_Init(&C, Gene, code, first_stream+rep, 0, NULL) == 0)
+	{	printf("Out of memory\n");fflush(stdout);
+		exit(1);
+	}
+	
+	// Resume from a checkpoint. Replicates start from the same checkpoint and continue with their own seeds
+	if(strcmp(resume_file, "") != 0)
+	{	Read_Checkpoint(&C, resume_file);
+		if(n_replicates > 1)
+		{	Rng_Set(C.r, (unsigned long) seed, C.rep, C.part);
+		}
+	}
+	
+	if(traj_opt==1)
+	{	strcpy(traj_name,prefix);
+		C.traj = Traj_Open(strcat(traj_name,"_ribo_traj.bin"), C.mRNA, Gene);
+	}
+	
+	if(n_replicates > 1)
+	{	sprintf(ckpt_name,"%s_rep%d",ckpt_file,rep);
+	}
+	else
+	{	strcpy(ckpt_name,ckpt_file);
+	}
+	
+	while(C.t<tot_time)
+	{	if(strcmp(ckpt_file, "") != 0 && ckpt_period > 0)
+		{	t_stop = fmin(ckpt_period*(floor(C.t/ckpt_period)+1), tot_time);
+		}
+		Cell_Run(&C, t_stop);
+		
+		if(strcmp(ckpt_file, "") != 0)
+		{	Write_Checkpoint(&C, ckpt_name);
+		}
+#ifdef SMOPT_BENCH
+		if(bench_events>0 && C.bench.n_events>=bench_events)
+		{	break;
+		}
+#endif
+	}
+#ifdef SMOPT_BENCH
+	Bench_Report(&C, rep);
+#endif
+#ifdef SMOPT_TELEMETRY
+	Telemetry_Report(&C, C.t, C.Rf, C.Rfh, 1);
+#endif
+	
+	if(C.traj != NULL)
+	{	Traj_Close(C.traj);
+	}
+	Avg_Flush(&C);
+	Cell_Output(&C, prefix, Res);
+	if(Res != NULL)
+	{	Res->leap_events = C.leap_events;
+		Res->leap_dropped = C.leap_dropped;
+	}
+	Cell_Free(&C);
+}
+
+
+
+// Free pool p of a cell: free tRNAs of type p (p<61), free ribosomes (61) or free ribosomes bound by harringtonine (62)
+static inline int *Domain_Pool(cell *C, int p)
+{	return (p<61) ? &C->Tf[p] : ((p==61) ? &C->Rf : &C->Rfh);
+}
+
+// Sum the free pools of the domains at the end of a window and share them out evenly again
+// The remainders go to different domains in turn (rot). Returns the largest relative error, over domains and pools,
+// of the whole pools as seen by the domains at the end of the window (pool_scale times their share).
+double Domain_Share(domain_set *S, int rot)
+{	int c1, k, x, n = S->n;
+	int tot;
+	double err = 0.0;
+	cell *C;
+	
+	for(c1=0;c1<63;c1++)
+	{	tot = 0;
+		for(k=0;k<n;k++)
+		{	tot += *Domain_Pool(&S->C[k], c1);
+		}
+		if(c1<62)																	// Harringtonine only enters rates as a fraction of Rf
+		{	for(k=0;k<n;k++)
+			{	err = fmax(err, fabs((double)n*(*Domain_Pool(&S->C[k], c1)) - tot)/fmax((double)tot, (double)n*DOMAIN_MIN_SHARE));
+			}
+		}
+		
+		for(k=0;k<n;k++)
+		{	C = &S->C[k];
+			x = tot/n + (((k+rot)%n < tot%n) ? 1 : 0);								// Rfh and Rf get their remainders in the same domains, so Rfh <= Rf
+			if(C->avg_started==1 && C->par.printOpt[3]==1 && c1<61 && x!=C->Tf[c1])
+			{	Avg_Update(&C->avg_tRNA_abndc[c1], &C->Tf_held[c1], x, C->t);
+			}
+			if(C->avg_started==1 && C->par.printOpt[3]==1 && c1==61 && x!=C->Rf)
+			{	Avg_Update(&C->avg_Rf, &C->Rf_held, x, C->t);
+			}
+			*Domain_Pool(C, c1) = x;
+		}
+	}
+	for(k=0;k<n;k++)
+	{	Refresh_Elng_Prop(&S->C[k]);
+	}
+	return err;
+}
+
+// Simulate the windows of one domain as they are started by Simulate_Domains
+void *Domain_Thread(void *arg)
+{	domain_set *S = (domain_set *)arg;
+	int k;
+	long window = 0;
+	double t_sync;
+	
+	pthread_mutex_lock(&S->lock);
+	k = S->next_id;
+	S->next_id++;
+	pthread_mutex_unlock(&S->lock);
+	
+	while(1)
+	{	pthread_mutex_lock(&S->lock);
+		while(S->window == window)
+		{	pthread_cond_wait(&S->go, &S->lock);
+		}
+		window = S->window;
+		t_sync = S->t_sync;
+		pthread_mutex_unlock(&S->lock);
+		
+		if(t_sync < 0)
+		{	break;
+		}
+		Cell_Run(&S->C[k], t_sync);
+		
+		pthread_mutex_lock(&S->lock);
+		S->n_done++;
+		if(S->n_done == S->n)
+		{	pthread_cond_signal(&S->done);
+		}
+		pthread_mutex_unlock(&S->lock);
+	}
+	return NULL;
+}
+
+// Gather the final state and the statistics of the domains into the whole cell M for Cell_Output
+// The mRNAs of each gene are numbered as in a cell simulated in one piece: those of domain 0 first, then domain 1...
+void Domain_Merge(domain_set *S, cell *M)
+{	int c1, c2, k, g_id, m_id;
+	int n_genes = M->par.n_genes;						// The whole cell has the parameters of the domains
+	int n_stall_pos = M->par.n_stall_pos;
+	int next_m[n_genes];
+	cell *C;
+	
+	next_m[0] = 0;
+	for(c1=1;c1<n_genes;c1++)
+	{	next_m[c1] = next_m[c1-1]+M->Gene[c1-1].exp;
+	}
+	M->t = 0.0;
+	for(k=0;k<S->n;k++)
+	{	C = &S->C[k];
+		M->t = fmax(M->t, C->t);
+		for(c1=0;c1<C->n_mRNA;c1++)
+		{	g_id = C->mRNA[c1].gene;
+			m_id = next_m[g_id]++;
+			M->mRNA[m_id] = C->mRNA[c1];
+			for(c2=0;c2<M->Gene[g_id].len;c2++)
+			{	if(Grid_Get(&C->R_grid, c1, c2) != C->par.tot_ribo)
+				{	Grid_Set(&M->R_grid, m_id, c2, Grid_Get(&C->R_grid, c1, c2));
+				}
+			}
+		}
+		
+		for(c1=0;c1<61;c1++)
+		{	M->n_e_times[c1] += C->n_e_times[c1];
+			M->e_times[c1] += C->e_times[c1];
+			M->avg_tRNA_abndc[c1] += C->avg_tRNA_abndc[c1];
+		}
+		M->avg_Rf += C->avg_Rf;
+		for(c1=0;c1<n_genes;c1++)
+		{	M->num_waste_ribo[c1] += C->num_waste_ribo[c1];
+			M->num_stall_chx[c1] += C->num_stall_chx[c1];
+			M->time_waste_ribo[c1] += C->time_waste_ribo[c1];
+			for(c2=0;c2<M->Gene[c1].len;c2++)
+			{	M->gene_sp_ribo_500[c1][c2] += C->gene_sp_ribo_500[c1][c2];
+			}
+		}
+		for(c1=0;c1<M->Gene[0].len;c1++)
+		{	M->num_waste_ribo_pos[c1] += C->num_waste_ribo_pos[c1];
+			M->time_waste_ribo_pos[c1] += C->time_waste_ribo_pos[c1];
+		}
+		for(c1=0;c1<n_stall_pos;c1++)
+		{	M->stall_time[c1] += C->stall_time[c1];
+		}
+#ifdef SMOPT_BENCH
+		M->bench.n_events += C->bench.n_events;
+		for(c1=0;c1<EV_TYPES;c1++)
+		{	M->bench.n[c1] += C->bench.n[c1];
+			M->bench.n_timed[c1] += C->bench.n_timed[c1];
+			M->bench.ns_timed[c1] += C->bench.ns_timed[c1];
+		}
+#endif
+	}
+}
+
+// Simulate one cell split into n_domains domains (-D), each simulated by its own thread
+// Domain k owns a share of the mRNAs of every gene and uses random stream k. Its rates use its share of the free
+// ribosomes and tRNAs scaled by the number of domains as the estimate of the whole pools. The domains run on their own
+// until the end of a synchronization window, when the free pools are summed and shared out evenly again. The next
+// window is lengthened or shortened so that the error of the estimates at the end of a window stays around domain_tol.
+void Simulate_Domains(gene *Gene, trna *code, char *prefix)
+{	int c1, k, n = n_domains;
+	domain_set S;
+	cell M;
+	double t = 0.0, dt = DOMAIN_WINDOW0, err;
+	pthread_t thread[n];
+	pthread_attr_t attr;
+#ifdef SMOPT_BENCH
+	long n_events;
+	struct timespec wall1, wall2;
+#endif
+	
+	S.n = n;
+	S.C = (cell *)malloc(sizeof(cell) * n);
+	S.Gene = (gene **)malloc(sizeof(gene *) * n);
+	if(S.C == NULL || S.Gene == NULL)
+	{	printf("Too many domains\nOut of memory\n");fflush(stdout);
+		exit(1);
+	}
+	for(k=0;k<n;k++)
+	{	S.Gene[k] = (gene *)malloc(sizeof(gene) * n_genes);
+		if(S.Gene[k] == NULL)
+		{	printf("Too many domains\nOut of memory\n");fflush(stdout);
+			exit(1);
+		}
+		for(c1=0;c1<n_genes;c1++)
+		{	S.Gene[k][c1] = Gene[c1];
+			S.Gene[k][c1].exp = (int)(((long)Gene[c1].exp*(k+1))/n - ((long)Gene[c1].exp*k)/n);
+		}
+		if(Cell_Init(&S.C[k], S.Gene[k], code, first_stream, k, NULL) == 0)
+		{	printf("Out of memory\n");fflush(stdout);
+			exit(1);
+		}
+		S.C[k].pool_scale = (double)n;
+		if(k>0)																		// Domain 0 holds the whole free pools until they are shared out
+		{	for(c1=0;c1<63;c1++)
+			{	*Domain_Pool(&S.C[k], c1) = 0;
 			}
 		}
 	}
+	Domain_Share(&S, 0);
+	
+	S.t_sync = 0.0;
+	S.window = 0;
+	S.n_done = 0;
+	S.next_id = 0;
+	pthread_mutex_init(&S.lock, NULL);
+	pthread_cond_init(&S.go, NULL);
+	pthread_cond_init(&S.done, NULL);
+	
+	// Cell_Run keeps its per-gene arrays on the stack
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, THREAD_STACK_SIZE);
+#ifdef SMOPT_BENCH
+	clock_gettime(CLOCK_MONOTONIC, &wall1);
+#endif
+	for(k=0;k<n;k++)
+	{	if(pthread_create(&thread[k], &attr, Domain_Thread, &S) != 0)
+		{	printf("\nCould not start simulation thread %d\n",k);fflush(stdout);
+			exit(1);
+		}
+	}
+	
+	while(t<tot_time)
+	{	pthread_mutex_lock(&S.lock);
+		S.t_sync = fmin(t+dt, tot_time);
+		S.n_done = 0;
+		S.window++;
+		pthread_cond_broadcast(&S.go);
+		while(S.n_done < n)
+		{	pthread_cond_wait(&S.done, &S.lock);
+		}
+		pthread_mutex_unlock(&S.lock);
+		
+		err = Domain_Share(&S, (int)(S.window%n));
+		dt *= (err>0) ? fmin(2.0, fmax(0.5, 0.8*domain_tol/err)) : 2.0;
+		t = S.t_sync;
+#ifdef SMOPT_BENCH
+		n_events = 0;
+		for(k=0;k<n;k++)
+		{	n_events += S.C[k].bench.n_events;
+		}
+		if(bench_events>0 && n_events>=bench_events)
+		{	break;
+		}
+#endif
+	}
+	
+	pthread_mutex_lock(&S.lock);
+	S.t_sync = -1.0;
+	S.window++;
+	pthread_cond_broadcast(&S.go);
+	pthread_mutex_unlock(&S.lock);
+	for(k=0;k<n;k++)
+	{	pthread_join(thread[k], NULL);
+	}
+	pthread_attr_destroy(&attr);
+	pthread_mutex_destroy(&S.lock);
+	pthread_cond_destroy(&S.go);
+	pthread_cond_destroy(&S.done);
+	
+	// Whole cell for the outputs
+	if(Cell_Init(&M, Gene, code, 0, 0, NULL) == 0)
+	{	printf("Out of memory\n");fflush(stdout);
+		exit(1);
+	}
+	for(k=0;k<n;k++)
+	{
+#ifdef SMOPT_TELEMETRY
+		Telemetry_Report(&S.C[k], S.C[k].t, S.C[k].Rf, S.C[k].Rfh, 1);
+#endif
+		Avg_Flush(&S.C[k]);
+	}
+	Domain_Merge(&S, &M);
+#ifdef SMOPT_BENCH
+	clock_gettime(CLOCK_MONOTONIC, &wall2);
+	M.bench.run_s = Clock_Elapsed(&wall1, &wall2);
+	M.bench.startup_s = S.C[0].bench.startup_s;
+	Bench_Report(&M, 0);
+#endif
+	Cell_Output(&M, prefix, NULL);
+	
+	Cell_Free(&M);
+	for(k=0;k<n;k++)
+	{	Cell_Free(&S.C[k]);
+		free(S.Gene[k]);
+	}
+	free(S.C);
+	free(S.Gene);
 }
 
 
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Simulate replicates handed out by the pool until none are left
+void *Replicate_Thread(void *arg)
+{	replicate_pool *pool = (replicate_pool *)arg;
+	int k;
+	char prefix[200];
+	
+	while(1)
+	{	pthread_mutex_lock(&pool->lock);
+		k = pool->next_rep;
+		pool->next_rep++;
+		pthread_mutex_unlock(&pool->lock);
+		
+		if(k >= n_replicates)
+		{	break;
+		}
+		
+		sprintf(prefix,"%s_rep%d",pool->prefix,k);
+		Simulate_Cell(pool->Gene, pool->cTRNA, k, prefix, &pool->Rep[k]);
+	}
+	return NULL;
+}
 
 
-// Main Function
-int main(int argc, char *argv[])
-{	int c1, c2, c3, c4;
-	FILE *f1, *f2, *f3, *f4, *f5, *f6, *f7, *f8, *f9, *f10, *f11;
 
-	// Read in arguments from the commandline
-	Read_Commandline_Args(argc, argv);
+// Mean and variance across replicates of a statistic, skipping replicates where it is undefined (no events)
+void Replicate_Moments(double *x, int n, double *mean, double *var, int *n_used)
+{	int c1;
+	double sum = 0.0, sum_sq = 0.0;
 	
-	// Random number generation setup
-	gsl_rng * r;
-	gsl_rng_env_setup();
+	*n_used = 0;
+	for(c1=0;c1<n;c1++)
+	{	if(isfinite(x[c1]))
+		{	sum += x[c1];
+			(*n_used)++;
+		}
+	}
+	*mean = (*n_used>0) ? sum/(double)(*n_used) : NAN;
 	
-	r = gsl_rng_alloc (gsl_rng_mt19937);
-	gsl_rng_set (r, (unsigned long) seed);
+	for(c1=0;c1<n;c1++)
+	{	if(isfinite(x[c1]))
+		{	sum_sq += (x[c1]-*mean)*(x[c1]-*mean);
+		}
+	}
+	*var = (*n_used>1) ? sum_sq/(double)(*n_used-1) : NAN;
+}
+
+
 
+// Print the mean and variance across replicates of the per-codon and per-gene averages
+void Print_Merged_Replicates(replicate *Rep)
+{	int c1, c2, n_used;
+	double mean, var, n_mean;
+	double x[n_replicates];
+	char out_file[200];
+	FILE *fh;
 	
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////	
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	strcpy(out_file,out_prefix);
+	fh = Output_Open(strcat(out_file,"_replicate_seeds.out"),"w");
+	if(rng_type == RNG_MT19937)
+	{	fprintf(fh,"Replicate\tSeed\n");
+		for(c2=0;c2<n_replicates;c2++)
+		{	fprintf(fh,"%d\t%d\n",c2,Rep[c2].seed);
+		}
+	}
+	else
+	{	fprintf(fh,"Replicate\tSeed\tStream\n");
+		for(c2=0;c2<n_replicates;c2++)
+		{	fprintf(fh,"%d\t%d\t%d\n",c2,seed,first_stream+c2);
+		}
+	}
+	fclose(fh);
 	
-	// User specified parameters for quick test
-	gene *Gene = (gene *)malloc(sizeof(gene) * n_genes);
-	if(Gene == NULL)
-	{	printf("Too many genes\nOut of memory\n");fflush(stdout);
-		exit(1);
+	if(printOpt[0]==1)
+	{	strcpy(out_file,out_prefix);
+		fh = Output_Open(strcat(out_file,"_etimes_merged.out"),"w");
+		
+		fprintf(fh,"Codon\tNum_replicates\tMean_num_of_events\tMean_avg_elong_time(sec)\tVar_avg_elong_time\n");
+		for(c1=0;c1<61;c1++)
+		{	n_mean = 0.0;
+			for(c2=0;c2<n_replicates;c2++)
+			{	x[c2] = Rep[c2].etimes[c1];
+				n_mean += (double)Rep[c2].n_etimes[c1]/(double)n_replicates;
+			}
+			Replicate_Moments(x, n_replicates, &mean, &var, &n_used);
+			fprintf(fh,"%d\t%d\t%g\t%g\t%g\n",c1,n_used,n_mean,mean,var);
+		}
+		fclose(fh);
 	}
 	
-	// Initialize the various structures
-	ribosome *Ribo = (ribosome *)malloc(sizeof(ribosome) * tot_ribo);
-	if(Ribo == NULL)
-	{	printf("Too many ribosomes\nOut of memory\n");fflush(stdout);
-		exit(1);
+	if(printOpt[1]==1)
+	{	strcpy(out_file,out_prefix);
+		fh = Output_Open(strcat(out_file,"_gene_totetimes_merged.out"),"w");
+		
+		fprintf(fh,"Gene\tNum_replicates\tMean_num_of_events\tMean_avg_total_elong_time(sec)\tVar_avg_total_elong_time\n");
+		for(c1=0;c1<n_genes;c1++)
+		{	n_mean = 0.0;
+			for(c2=0;c2<n_replicates;c2++)
+			{	x[c2] = Rep[c2].g_etimes[c1];
+				n_mean += (double)Rep[c2].n_trans[c1]/(double)n_replicates;
+			}
+			Replicate_Moments(x, n_replicates, &mean, &var, &n_used);
+			fprintf(fh,"%d\t%d\t%g\t%g\t%g\n",c1,n_used,n_mean,mean,var);
+		}
+		fclose(fh);
 	}
+	
+	if(printOpt[2]==1)
+	{	strcpy(out_file,out_prefix);
+		fh = Output_Open(strcat(out_file,"_gene_initimes_merged.out"),"w");
 		
-	trna *cTRNA = (trna *)malloc(sizeof(trna) * 61);
-	if(cTRNA == NULL)
-	{	printf("Too many tRNAs\nOut of memory\n");fflush(stdout);
-		exit(1);
+		fprintf(fh,"Gene\tNum_replicates\tMean_num_of_events\tMean_avg_initiation_time(sec)\tVar_avg_initiation_time\n");
+		for(c1=0;c1<n_genes;c1++)
+		{	n_mean = 0.0;
+			for(c2=0;c2<n_replicates;c2++)
+			{	x[c2] = Rep[c2].g_ini[c1];
+				n_mean += (double)Rep[c2].n_trans[c1]/(double)n_replicates;
+			}
+			Replicate_Moments(x, n_replicates, &mean, &var, &n_used);
+			fprintf(fh,"%d\t%d\t%g\t%g\t%g\n",c1,n_used,n_mean,mean,var);
+		}
+		fclose(fh);
 	}
-
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////	
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	
-	// Read in the numeric seq
-	Read_FASTA_File(fasta_file, Gene);
+	if(printOpt[3]==1)
+	{	strcpy(out_file,out_prefix);
+		fh = Output_Open(strcat(out_file,"_avg_ribo_tRNA_merged.out"),"w");
+		
+		fprintf(fh,"Pool\tMean\tVar\n");
+		for(c2=0;c2<n_replicates;c2++)
+		{	x[c2] = Rep[c2].avg_Rf;
+		}
+		Replicate_Moments(x, n_replicates, &mean, &var, &n_used);
+		fprintf(fh,"Free_ribo\t%g\t%g\n",mean,var);
+		for(c1=0;c1<61;c1++)
+		{	for(c2=0;c2<n_replicates;c2++)
+			{	x[c2] = Rep[c2].avg_tRNA[c1];
+			}
+			Replicate_Moments(x, n_replicates, &mean, &var, &n_used);
+			if(mean>0)
+			{	fprintf(fh,"Free_tRNA%d\t%g\t%g\n",c1,mean,var);
+			}
+		}
+		fclose(fh);
+	}
+}
 
-	// Read in the trna code file
-	Read_tRNA_File(code_file, cTRNA);
-	
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////	
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	tot_mRNA = 0;
-	for(c1=0;c1<n_genes;c1++)
-	{	tot_mRNA += Gene[c1].exp;
-	}
+
+// Allocate the summary statistics of n_replicates cells
+replicate *Replicate_Alloc()
+{	int c1;
+	replicate *Rep = (replicate *)malloc(sizeof(replicate) * n_replicates);
 	
-	transcript *mRNA = (transcript *)malloc(sizeof(transcript) * tot_mRNA);
-	if(mRNA == NULL)
-	{	printf("Too many mRNAs\nOut of memory\n");fflush(stdout);
+	if(Rep == NULL)
+	{	printf("Too many replicates\nOut of memory\n");fflush(stdout);
 		exit(1);
 	}
-
-	c3=0;
-	for(c1=0;c1<n_genes;c1++)					// Fill the mRNA struct with
-	{	for(c2=0;c2<Gene[c1].exp;c2++)			// length and ini_rate info.
-		{	mRNA[c3].gene = c1;
-			mRNA[c3].ini_n = 0;
-			mRNA[c3].last_ini = 0.0;
-			mRNA[c3].trans_n = 0;
-			mRNA[c3].avg_time_to_ini = 0.0;
-			mRNA[c3].avg_time_to_trans = 0.0;
-			c3++;
+	for(c1=0;c1<n_replicates;c1++)
+	{	Rep[c1].g_etimes = (double *)malloc(sizeof(double) * n_genes);
+		Rep[c1].g_ini = (double *)malloc(sizeof(double) * n_genes);
+		Rep[c1].n_trans = (int *)malloc(sizeof(int) * n_genes);
+		if(Rep[c1].g_etimes == NULL || Rep[c1].g_ini == NULL || Rep[c1].n_trans == NULL)
+		{	printf("Too many replicates\nOut of memory\n");fflush(stdout);
+			exit(1);
 		}
 	}
+	return Rep;
+}
+
+void Replicate_Free(replicate *Rep)
+{	int c1;
 	
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////	
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	
-	
-	
-	// Variables to track the translation process
-	int Tf[61];									// Number of free tRNAs of each type
-	int Rf = tot_ribo;							// Total number of free ribosomes (at start all ribosomes are free)
-	int Rfh = 0;								// Number of free ribosomes bound by harringtonine
-	int Rb[61];									// Number of ribosomes bound to each codon
-	int Mf[n_genes];							// Number of initiable mRNAs of each gene (first 10 codons unbound by ribosomes)
-	int tot_Mf;									// Total number of initiable mRNAs
-	int x;
-	int n_Rb_e[61];								// Number of elongable bound ribosomes to each codon
-	int r_id;
-	int m_id;
-	int c_id;
-	int c2_id;
-	int g_id;
-	int tot_gcn=0;
-	int obs_max_len = 0;						// Observed max gene length
-	int obs_max_exp = 0;						// Observed max gene expression
-	int next_avail_ribo = 0;
-	int termtn_now=0;
-	int n_e_times[61];							// Number of times a codon type is elongated
-	double e_times[61];
-	int num_waste_ribo[n_genes];				// Number of stalled ribosomes on mRNAs of each gene
-	int num_waste_ribo_pos[Gene[0].len];		// Number of stalled ribosomes by codon position on mRNAs of the first gene
-	double time_waste_ribo[n_genes];			// Total time spent by stalled ribosomes on mRNAs of each gene
-	double time_waste_ribo_pos[Gene[0].len];	// Total time spent by stalled ribosomes at each codon position on mRNAs of the first gene
-	double scld_Mf[n_genes];
-	double tot_scld_Mf = 0.0;
-	double r_ini;
-	double r_elng[61];
-	double avg_tRNA_abndc[61];					// Average number of free tRNAs of each type (averaged by time)
-	double avg_Rf = {0.0};						// Average number of free ribosomes (averaged by time)
-	
-	int tot_stall_chx = 0;						// Total number of stalled ribosomes on mRNAs due to cycloheximide
-	int num_stall_chx[n_genes];					// Number of stalled ribosomes on mRNAs of each gene due to cycloheximide
-	int chx_r_id[tot_ribo];
-	double cod_chx[61];							// Codon specific rate of cycloheximide action
-	double tot_chx_ds_rate = 0.0;				// Total rate of CHX dissociaction
-	double prob_chx_ds;
+	for(c1=0;c1<n_replicates;c1++)
+	{	free(Rep[c1].g_etimes);
+		free(Rep[c1].g_ini);
+		free(Rep[c1].n_trans);
+	}
+	free(Rep);
+}
+
 
-	double tot_harr_rate = 0.0;					// Total rate of harringtonine action
-	double prob_harr;
 
+// Simulate n_replicates cells with seeds seed, seed+1, ... on n_threads threads sharing the same inputs
+// The outputs of replicate k are written with the prefix <prefix>_rep<k> and its summary statistics to Rep[k]
+void Replicate_Pool_Run(gene *Gene, trna *cTRNA, replicate *Rep, char *prefix)
+{	int c1;
+	replicate_pool pool;
+	pthread_t *thread;
+	pthread_attr_t attr;
 	
-	// Begin simulation of the translation process
-	double t = 0.0;
-	double prob_ini;
-	double tmp_elng_prob;
-	double prob_e[61];
-	double prob_g;
-	double tot_rate = 0.0;
-	double inv_rate;
-	double coin;
-	int t_print = floor(thresh_time);
-	char tmp_t[10];
+	pool.Gene = Gene;
+	pool.cTRNA = cTRNA;
+	pool.Rep = Rep;
+	pool.prefix = prefix;
+	pool.next_rep = 0;
+	pthread_mutex_init(&pool.lock, NULL);
 	
-	int **Rb_e;									// Bound ribosomes to each codon that can be elongated
-	Rb_e = malloc(sizeof(int *) * 62);
-	for(c1=0;c1<62;c1++)
-	{	Rb_e[c1] = malloc(sizeof(int *) * tot_ribo);
+	thread = (pthread_t *)malloc(sizeof(pthread_t) * n_threads);
+	if(thread == NULL)
+	{	printf("Too many threads\nOut of memory\n");fflush(stdout);
+		exit(1);
 	}
 	
-	int **gene_sp_ribo_500;
-	gene_sp_ribo_500 = malloc(sizeof(int *) * n_genes);
-	for(c1=0;c1<n_genes;c1++)
-	{	gene_sp_ribo_500[c1] = malloc(sizeof(int *) * Gene[c1].len);
-	}
-
+	// Simulate_Cell keeps its per-gene and per-position arrays on the stack
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, THREAD_STACK_SIZE);
 	
-	for(c1=0;c1<n_genes;c1++)
-	{	if(Gene[c1].exp > obs_max_exp)
-		{	obs_max_exp = Gene[c1].exp;
-		}
-		if(Gene[c1].len > obs_max_len)
-		{	obs_max_len = Gene[c1].len;
+	for(c1=0;c1<n_threads;c1++)
+	{	if(pthread_create(&thread[c1], &attr, Replicate_Thread, &pool) != 0)
+		{	printf("\nCould not start simulation thread %d\n",c1);fflush(stdout);
+			exit(1);
 		}
-		Mf[c1] = Gene[c1].exp;
-		scld_Mf[c1] = Mf[c1]*Gene[c1].ini_prob;
-		tot_scld_Mf += scld_Mf[c1];							// Scale gene_exp with ini_prob
-		
-		num_waste_ribo[c1] = 0;								// Initialize stalled ribosomes and time spent
-		num_stall_chx[c1] = 0;								// Initialize stalled ribosomes and time spent
-		time_waste_ribo[c1] = 0.0;
 	}
+	for(c1=0;c1<n_threads;c1++)
+	{	pthread_join(thread[c1], NULL);
+	}
+	pthread_attr_destroy(&attr);
+	pthread_mutex_destroy(&pool.lock);
+	free(thread);
+}
 
-	for(c1=0;c1<Gene[0].len;c1++)							// Initialize stalled ribosomes and time spent at specific positions of gene 1
-	{	num_waste_ribo_pos[c1] = 0;
-		time_waste_ribo_pos[c1] = 0.0;
-	}	
+void Run_Replicates(gene *Gene, trna *cTRNA)
+{	replicate *Rep = Replicate_Alloc();
 	
-	int **free_mRNA;										// List to figure out which mRNAs can be initiated based on no bound ribosomes from pos=0->pos=10
-	free_mRNA = malloc(sizeof(int *) * n_genes);
-	for(c1=0;c1<n_genes;c1++)
-	{	free_mRNA[c1] = malloc(sizeof(int *) * obs_max_exp);
-	}
+	Replicate_Pool_Run(Gene, cTRNA, Rep, out_prefix);
+	Print_Merged_Replicates(Rep);
+	Replicate_Free(Rep);
+}
 
-	// Initialize free mRNAs
-	c3=0;
-	for(c2=0;c2<n_genes;c2++)
-	{	for(c1=0;c1<Gene[c2].exp;c1++)
-		{	free_mRNA[c2][c1]=c3;							// At the begininning all mRNAs can be initiated (store their ids here)
-			c3++;
-		}
+
+
+// Parameters that can be swept, named as their options
+const char *sweep_par_name[SWEEP_N_PAR] = {"R","t","V","x1","x2","y","Tc","Th"};
+
+// Set swept parameter p of a cell to v, 0 if v is not a valid value
+int Sweep_Set(cell_par *P, int p, double v)
+{	switch(p)
+	{	case 0:
+			P->tot_ribo = (int)v;
+			return (v>=1 && v==floor(v));
+		case 1:
+			P->tot_tRNA = (int)v;
+			return (v>=0 && v==floor(v));
+		case 2:
+			P->tot_space = v;
+			P->avail_space_t = (double)floor(v/pow(char_len_tRNA,3));
+			P->avail_space_r = (double)floor(v/pow(char_len_ribo,3));
+			return (P->avail_space_r>=1e3 && P->avail_space_t>=1e3);
+		case 3:
+			P->chx_rb_prob = v;
+			break;
+		case 4:
+			P->chx_ds_rate = v;
+			break;
+		case 5:
+			P->harr_rf_rate = v;
+			break;
+		case 6:
+			P->chx_time = v;
+			break;
+		case 7:
+			P->harr_time = v;
+			break;
 	}
+	return (v>=0);
+}
+
+// Read the grid of a sweep: one line per swept parameter, "<parameter> <value> <value> ...", with the parameters
+// named as their options (R, t, V, x1, x2, y, Tc, Th). # starts a comment. Parameters not listed keep their
+// command-line value and have no values (n_val 0).
+void Read_Sweep_File(char *filename, double val[][SWEEP_MAX_VALUES], int *n_val)
+{	FILE *fh;
+	char *line = NULL;
+	size_t cap = 0;
+	char *tok, *end;
+	int listed[SWEEP_N_PAR] = {0};
+	int p;
+	cell_par P;
 	
-	// Initialize free tRNAs and elongation time vectors
-	for(c1=0;c1<61;c1++)
-	{	if(cTRNA[c1].wobble==1.0)
-		{	tot_gcn += cTRNA[c1].gcn;
-		}
-		e_times[c1] = 0.0;
-		n_e_times[c1] = 0;
-		
-		Tf[c1]=0;
-		avg_tRNA_abndc[c1]=0.0;
+	for(p=0;p<SWEEP_N_PAR;p++)
+	{	n_val[p] = 0;
 	}
-	c2 = 0;
-		
-	for(c1=0;c1<61;c1++)
-	{	if(cTRNA[c1].wobble==1.0)
-		{	Tf[cTRNA[c1].tid] = floor((double)cTRNA[c1].gcn*tot_tRNA/tot_gcn);			// Number of tRNAs for tRNA-type cTRNA[c1].tid
-		}
-		n_Rb_e[c1] = 0;															// Initialize number of elongatable bound ribosomes to each codon
-		cTRNA[c1].wobble = cTRNA[c1].wobble/(char_time_tRNA*avail_space_t);		// For faster computation
+	
+	fh = fopen(filename, "r");
+	if(fh == NULL)
+	{	printf("\nSweep file %s not found\n",filename);fflush(stdout);
+		exit(1);
 	}
 	
-	// Initialize R_grid
-	// R_grid now contains the id of ribosome at each mRNA position.
-	// If there is no ribosome then that position get the value tot_ribo instead of 0 as 0 is a ribosome id
-	int **R_grid;							// The state of the system with respect to mRNAs and bound ribosomes
-	R_grid = malloc(sizeof(int *) * tot_mRNA);
-	for(c1=0;c1<tot_mRNA;c1++)
-	{	R_grid[c1] = malloc(sizeof(int *) * obs_max_len);
-		for(c2=0;c2<Gene[mRNA[c1].gene].len;c2++)
-		{	R_grid[c1][c2] = tot_ribo;
+	while(getline(&line, &cap, fh) != -1)
+	{	if((tok = strchr(line, '#')) != NULL)
+		{	*tok = '\0';
 		}
-	}
-
-	// If state file is provided, reinitialize the variables and arrays
-	if(strcmp(state_file, "") != 0)												// Read in the state of the system
-	{	Read_STATE_File(state_file, R_grid);
-
-		m_id = 0;																// mRNA id
-		r_id = 0;																// Ribosome id
-		for(c1=0;c1<n_genes;c1++)
-		{	for(c4=0;c4<Gene[c1].exp;c4++)
-			{	for(c2=0;c2<10;c2++)											// For first 10 codons - check if mRNA is initiable
-				{	if(R_grid[m_id][c2]==0)
-					{	R_grid[m_id][c2] = tot_ribo;
-					}
-					else
-					{	R_grid[m_id][c2] = r_id;
-						
-						Ribo[r_id].mRNA = m_id;
-						Ribo[r_id].pos = c2;
-						Ribo[r_id].inhbtr_bound = 0;
-						
-						c_id = Gene[mRNA[m_id].gene].seq[c2];					// Codon identity
-						if(c2>0)
-						{	Tf[cTRNA[Gene[mRNA[m_id].gene].seq[c2-1]].tid]--;
-						}
-						
-						if(R_grid[m_id][c2+10]==0)								// Check if the current ribosome can be elongated
-						{	Rb_e[c_id][n_Rb_e[c_id]] = r_id;					// If no ribosome at pos+10 then it can
-							Ribo[r_id].elng_cod_list = c_id;
-							Ribo[r_id].elng_pos_list = n_Rb_e[c_id];
-							n_Rb_e[c_id]++;
-						}
-						else
-						{	num_waste_ribo[mRNA[m_id].gene]++;
-							if(mRNA[m_id].gene==0)
-							{	num_waste_ribo_pos[c2]++;
-							}
-						}
-						
-						Mf[c1]--;
-						scld_Mf[c1]-=Gene[c1].ini_prob;							// These mRNAs are not initiable
-						tot_scld_Mf-=Gene[c1].ini_prob;
-						if(c4!=Mf[c1])
-						{	free_mRNA[c1][c4] = free_mRNA[c1][Mf[c1]];			// Accounting of free mRNAs for next round
-						}
-						
-						r_id++;
-						Rf--;
-					}
-				}
-				for(c2=10;c2<Gene[mRNA[m_id].gene].len;c2++)
-				{	if(R_grid[m_id][c2]==0)
-					{	R_grid[m_id][c2] = tot_ribo;
-					}
-					else
-					{	R_grid[m_id][c2] = r_id;
-						
-						Ribo[r_id].mRNA = m_id;
-						Ribo[r_id].pos = c2;
-						Ribo[r_id].inhbtr_bound = 0;
-						
-						c_id = Gene[mRNA[m_id].gene].seq[c2];									// Codon identity
-						Tf[cTRNA[Gene[mRNA[m_id].gene].seq[c2-1]].tid]--;
-						
-						if(R_grid[m_id][c2+10]==0 || (c2+11)>=Gene[mRNA[m_id].gene].len)		// Check if the current ribosome can be elongated
-						{	Rb_e[c_id][n_Rb_e[c_id]] = r_id;									// If no ribosome at pos+10 then it can
-							Ribo[r_id].elng_cod_list = c_id;
-							Ribo[r_id].elng_pos_list = n_Rb_e[c_id];
-							n_Rb_e[c_id]++;
-						}
-						else
-						{	num_waste_ribo[mRNA[m_id].gene]++;
-							if(mRNA[m_id].gene==0)
-							{	num_waste_ribo_pos[c2]++;
-							}
-						}
-						
-						r_id++;
-						Rf--;
-					}
-				}
-				m_id++;
+		tok = strtok(line, " \t\r\n");
+		if(tok == NULL)
+		{	continue;
+		}
+		for(p=0;p<SWEEP_N_PAR && strcmp(tok, sweep_par_name[p]) != 0;p++);
+		if(p == SWEEP_N_PAR || listed[p])
+		{	printf("\nUnknown or repeated parameter %s in sweep file %s\n",tok,filename);fflush(stdout);
+			exit(1);
+		}
+		listed[p] = 1;
+		n_val[p] = 0;
+		while((tok = strtok(NULL, " \t\r\n")) != NULL)
+		{	if(n_val[p] == SWEEP_MAX_VALUES)
+			{	printf("\nMore than %d values of %s in sweep file %s\n",SWEEP_MAX_VALUES,sweep_par_name[p],filename);fflush(stdout);
+				exit(1);
+			}
+			val[p][n_val[p]] = strtod(tok, &end);
+			if(*end != '\0' || !Sweep_Set(&P, p, val[p][n_val[p]]))
+			{	printf("\nInvalid value %s of %s in sweep file %s\n",tok,sweep_par_name[p],filename);fflush(stdout);
+				exit(1);
 			}
+			n_val[p]++;
 		}
-		
-		next_avail_ribo = r_id;
+		if(n_val[p] == 0)
+		{	printf("\nNo values of %s in sweep file %s\n",sweep_par_name[p],filename);fflush(stdout);
+			exit(1);
+		}
+	}
+	free(line);
+	fclose(fh);
+}
+
+// Simulate the burn-in of a group up to its fork time and keep the state of the cell in memory
+void Sweep_Burn_In(sweep_set *S, int g)
+{	cell C;
+	FILE *fh;
+	sweep_group *G = &S->grp[g];
+	
+	if(Cell_Init(&C, S->Gene, S->cTRNA, first_stream, 0, &G->par) == 0)
+	{	printf("Out of memory\n");fflush(stdout);
+		exit(1);
+	}
+	Cell_Run(&C, G->t_fork);
+	fh = open_memstream(&G->state, &G->size);
+	if(fh == NULL)
+	{	printf("Out of memory\n");fflush(stdout);
+		exit(1);
+	}
+	Cell_Checkpoint_IO(&C, fh, 1);
+	fclose(fh);
+	Cell_Free(&C);
+}
+
+// Simulate a point from the state of its group to the end, writing its outputs with the prefix <prefix>_pt<k>
+void Sweep_Point(sweep_set *S, int k)
+{	cell C;
+	FILE *fh;
+	int c1;
+	char prefix[200], key[65], summary[200];
+	sweep_point *P = &S->pt[k];
+	sweep_group *G = &S->grp[P->group];
+	
+	if(Cell_Init(&C, S->Gene, S->cTRNA, first_stream, 0, &P->par) == 0)
+	{	printf("Out of memory\n");fflush(stdout);
+		exit(1);
+	}
+	fh = fmemopen(G->state, G->size, "rb");
+	if(fh == NULL)
+	{	printf("Out of memory\n");fflush(stdout);
+		exit(1);
 	}
+	Cell_Checkpoint_IO(&C, fh, 0);
+	fclose(fh);
+	Cell_Run(&C, tot_time);
+	Avg_Flush(&C);
 	
+	P->free_ribo = C.avg_Rf/(tot_time-thresh_time);
+	P->n_elng = 0;
+	P->etime = 0.0;
+	for(c1=0;c1<61;c1++)
+	{	P->n_elng += C.n_e_times[c1];
+		P->etime += C.e_times[c1];
+	}
+	P->etime = P->etime/(double)P->n_elng;
+	P->n_chx = C.tot_stall_chx;
+	
+	sprintf(prefix,"%s_pt%d",out_prefix,k);
+	Cell_Output(&C, prefix, NULL);
+	Cell_Free(&C);
+	
+	if(strcmp(cache_dir, "") != 0)
+	{	Cache_Point_Key(k, key);
+		sprintf(summary,"%.17g\t%ld\t%.17g\t%d",P->free_ribo,P->n_elng,P->etime,P->n_chx);
+		Cache_Store(key, prefix, summary);
+	}
+}
 
-	/////////////////////////////////////////////////
-	// Begin the actual continuous time simulation
-	/////////////////////////////////////////////////
+// Restore the outputs and summary of point k from the result cache. Returns 0 if it is not cached.
+int Sweep_Cached(sweep_set *S, int k)
+{	FILE *fh;
+	char key[65], prefix[200], path[400];
+	sweep_point *P = &S->pt[k];
+	int ok;
 	
-	while(t<tot_time)																// Till current time is less than max time
-	{	r_ini = tot_scld_Mf*Rf/(char_time_ribo*avail_space_r);						// Initiation rate
-		tot_rate = r_ini;
-		
-		for(c1=0;c1<61;c1++)
-		{	r_elng[c1] = Tf[cTRNA[c1].tid]*cTRNA[c1].wobble;						// Elongation rate of codon c1
-			r_elng[c1] *= (double)n_Rb_e[c1];
-			tot_rate += r_elng[c1];
-		}
-		
-		if(t>harr_time)
-		{	tot_harr_rate = (double)Rf*harr_rf_rate;								// Rate of harringtonine action on free ribosomes
-			tot_rate += tot_harr_rate;
-		}
+	Cache_Point_Key(k, key);
+	fh = NULL;
+	if(snprintf(path, sizeof(path), "%s/%s/sweep_point.out", cache_dir, key) < (int)sizeof(path))
+	{	fh = fopen(path, "r");
+	}
+	if(fh == NULL)
+	{	return 0;
+	}
+	ok = (fscanf(fh,"%lf%ld%lf%d",&P->free_ribo,&P->n_elng,&P->etime,&P->n_chx) == 4);
+	fclose(fh);
+	sprintf(prefix,"%s_pt%d",out_prefix,k);
+	return ok && Cache_Restore(key, prefix);
+}
 
-		if(t>chx_time)
-		{	tot_chx_ds_rate = (double)tot_stall_chx*chx_ds_rate;					// CHX dissociation rate action from bound ribosomes
-			tot_rate += tot_chx_ds_rate;
+// Simulate points whose burn-in is ready and, when there are none, the burn-in of the next group
+void *Sweep_Thread(void *arg)
+{	sweep_set *S = (sweep_set *)arg;
+	int c1, k, g;
+	
+	pthread_mutex_lock(&S->lock);
+	while(S->n_started < S->n_pt)
+	{	k = -1;
+		g = -1;
+		for(c1=0;c1<S->n_pt;c1++)
+		{	if(!S->pt[c1].started && S->grp[S->pt[c1].group].status == 2)
+			{	k = c1;
+				break;
+			}
 		}
-
-		if(tot_rate>0)
-		{	inv_rate = 1/tot_rate;
+		if(k >= 0)
+		{	S->pt[k].started = 1;
+			S->n_started++;
+		}
+		else if(S->next_grp < S->n_grp)
+		{	g = S->next_grp++;
+			S->grp[g].status = 1;
+			if(S->grp[g].n_left == 0)										// All points of the group were in the result cache
+			{	S->grp[g].status = 2;
+				continue;
+			}
 		}
 		else
-		{	printf("\nNo further events to process.\nSimulation stopped at time %g\n\n",t);fflush(stdout);
-			t=tot_time;
+		{	pthread_cond_wait(&S->ready, &S->lock);
 			continue;
 		}
+		pthread_mutex_unlock(&S->lock);
 		
-		// Increment time
-		if(t>thresh_time)
-		{	if(printOpt[3]==1)														// Tracking free ribosomes and tRNAs
-			{	for(c1=0;c1<61;c1++)
-				{	avg_tRNA_abndc[c1] += (double)Tf[c1]*inv_rate;
-				}
-				avg_Rf += (double)Rf*inv_rate;
+		if(k >= 0)
+		{	Sweep_Point(S, k);
+		}
+		else
+		{	Sweep_Burn_In(S, g);
+		}
+		
+		pthread_mutex_lock(&S->lock);
+		if(k >= 0)
+		{	g = S->pt[k].group;
+			if(--S->grp[g].n_left == 0)									// The state is not needed anymore
+			{	free(S->grp[g].state);
+				S->grp[g].state = NULL;
 			}
-			
-			if(printOpt[5]==1)														// Tracking time wasted by ribosome stalling
-			{	for(c1=0;c1<n_genes;c1++)
-				{	time_waste_ribo[c1] += (double)num_waste_ribo[c1]*inv_rate;
-				}
-				for(c1=0;c1<Gene[0].len;c1++)
-				{	time_waste_ribo_pos[c1] += (double)num_waste_ribo_pos[c1]*inv_rate;
-				}
+		}
+		else
+		{	S->grp[g].status = 2;
+			pthread_cond_broadcast(&S->ready);
+		}
+	}
+	pthread_mutex_unlock(&S->lock);
+	return NULL;
+}
+
+// Simulate every point of the grid of sweep_file on n_threads threads
+// Points that differ only in the drugs (-x1, -x2, -y, -Tc, -Th) fork from one burn-in of their group and
+// continue with the same random numbers. The parameters and a summary of each point are written to <prefix>_sweep.out.
+void Run_Sweep(gene *Gene, trna *cTRNA)
+{	int c1, c2, r_k, g;
+	double val[SWEEP_N_PAR][SWEEP_MAX_VALUES];
+	int n_val[SWEEP_N_PAR];
+	int listed[SWEEP_N_PAR];
+	int n_drug = 1;
+	sweep_set S;
+	sweep_point *P;
+	sweep_group *G;
+	pthread_t *thread;
+	pthread_attr_t attr;
+	char out_file[200];
+	FILE *fh;
+	
+	Read_Sweep_File(sweep_file, val, n_val);
+	for(c1=0;c1<SWEEP_N_PAR;c1++)
+	{	listed[c1] = (n_val[c1] > 0);
+		n_val[c1] = listed[c1] ? n_val[c1] : 1;
+		n_drug *= (c1 >= 3) ? n_val[c1] : 1;
+	}
+	S.Gene = Gene;
+	S.cTRNA = cTRNA;
+	S.n_grp = n_val[0]*n_val[1]*n_val[2];
+	S.n_pt = S.n_grp*n_drug;
+	S.n_started = 0;
+	S.next_grp = 0;
+	S.pt = (sweep_point *)malloc(sizeof(sweep_point) * S.n_pt);
+	S.grp = (sweep_group *)malloc(sizeof(sweep_group) * S.n_grp);
+	thread = (pthread_t *)malloc(sizeof(pthread_t) * n_threads);
+	if(S.pt == NULL || S.grp == NULL || thread == NULL)
+	{	printf("Too many points in the sweep\nOut of memory\n");fflush(stdout);
+		exit(1);
+	}
+	
+	// Parameters of each point, the last parameter changing fastest
+	for(c1=0;c1<S.n_pt;c1++)
+	{	P = &S.pt[c1];
+		Par_Default(&P->par);
+		r_k = c1;
+		for(c2=SWEEP_N_PAR-1;c2>=0;c2--)
+		{	if(listed[c2])
+			{	Sweep_Set(&P->par, c2, val[c2][r_k % n_val[c2]]);
 			}
+			r_k /= n_val[c2];
 		}
-		t+=inv_rate;
-		
-		// Calculate prob of events
-		prob_ini = r_ini*inv_rate;													// Prob of initiation in current t
-		prob_harr = prob_ini + tot_harr_rate*inv_rate;								// Prob of harr action in current t
-		prob_chx_ds = prob_harr + tot_chx_ds_rate*inv_rate;							// Prob of CHX dissociaction in current t
-			
-		coin = gsl_rng_uniform(r);													// Pick a random uniform to pick an event
+		P->group = c1/n_drug;
+		P->started = 0;
+	}
+	
+	// A group forks when the first drug of its points acts. The burn-in has no drugs.
+	for(g=0;g<S.n_grp;g++)
+	{	G = &S.grp[g];
+		G->par = S.pt[g*n_drug].par;
+		G->par.chx_rb_prob = 0.0;
+		G->par.harr_rf_rate = 0.0;
+		G->t_fork = tot_time;
+		for(c1=g*n_drug;c1<(g+1)*n_drug;c1++)
+		{	if(S.pt[c1].par.chx_rb_prob > 0)
+			{	G->t_fork = fmin(G->t_fork, S.pt[c1].par.chx_time);
+			}
+			if(S.pt[c1].par.harr_rf_rate > 0)
+			{	G->t_fork = fmin(G->t_fork, S.pt[c1].par.harr_time);
+			}
+		}
+		G->status = 0;
+		G->n_left = n_drug;
+		G->state = NULL;
+	}
+	
+	// Points already in the result cache are restored and their burn-ins skipped if no other point needs them
+	if(strcmp(cache_dir, "") != 0)
+	{	for(c1=0;c1<S.n_pt;c1++)
+		{	if(Sweep_Cached(&S, c1))
+			{	S.pt[c1].started = 1;
+				S.n_started++;
+				S.grp[S.pt[c1].group].n_left--;
+			}
+		}
+		printf("\n%d of %d points of the sweep restored from the result cache\n",S.n_started,S.n_pt);fflush(stdout);
+	}
+	
+	pthread_mutex_init(&S.lock, NULL);
+	pthread_cond_init(&S.ready, NULL);
+	
+	// Cell_Output keeps its per-gene and per-position arrays on the stack
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, THREAD_STACK_SIZE);
+	
+	for(c1=0;c1<n_threads;c1++)
+	{	if(pthread_create(&thread[c1], &attr, Sweep_Thread, &S) != 0)
+		{	printf("\nCould not start simulation thread %d\n",c1);fflush(stdout);
+			exit(1);
+		}
+	}
+	for(c1=0;c1<n_threads;c1++)
+	{	pthread_join(thread[c1], NULL);
+	}
+	pthread_attr_destroy(&attr);
+	pthread_cond_destroy(&S.ready);
+	pthread_mutex_destroy(&S.lock);
+	
+	// Index of the points
+	sprintf(out_file,"%s_sweep.out",out_prefix);
+	fh = Output_Open(out_file,"w");
+	if(fh == NULL)
+	{	printf("\nCannot write %s\n",out_file);fflush(stdout);
+		exit(1);
+	}
+	fprintf(fh,"Point\tGroup\tFork_time\tR\tt\tV\tx1\tx2\ty\tTc\tTh\tFree_ribo\tElng_events\tAvg_etime\tStalled_chx\tPrefix\n");
+	for(c1=0;c1<S.n_pt;c1++)
+	{	P = &S.pt[c1];
+		fprintf(fh,"%d\t%d\t%g\t%d\t%d\t%g\t%g\t%g\t%g\t%g\t%g\t%g\t%ld\t%g\t%d\t%s_pt%d\n",c1,P->group,S.grp[P->group].t_fork,
+			P->par.tot_ribo,P->par.tot_tRNA,P->par.tot_space,P->par.chx_rb_prob,P->par.chx_ds_rate,P->par.harr_rf_rate,P->par.chx_time,P->par.harr_time,
+			P->free_ribo,P->n_elng,P->etime,P->n_chx,out_prefix,c1);
+	}
+	fclose(fh);
+	
+	free(S.pt);
+	free(S.grp);
+	free(thread);
+}
 
-		// Translation initiation
-		if(coin<prob_ini)
-		{	
-			// Ribosomes are picked sequentially
-			r_id = next_avail_ribo;
-			Ribo[r_id].pos = 0;
-			Ribo[r_id].t_trans_ini = t;
-			Ribo[r_id].t_elong_ini = t;
-			next_avail_ribo++;
-			
-			// Pick a random mRNA for initiation
-			coin = gsl_rng_uniform(r);
-			prob_g = 0.0;
-			
-			for(c1=0;c1<n_genes;c1++)
-			{	prob_g += scld_Mf[c1]/tot_scld_Mf;									// Pick a gene randomly first as they may differ in ini_prob
-				if(coin<prob_g)
-				{	c2 = gsl_rng_uniform_int(r, (unsigned long)Mf[c1]);				// Once a gene is selected pick a random mRNA
-					m_id = free_mRNA[c1][c2];
-					Mf[c1]--;
-					scld_Mf[c1]-=Gene[c1].ini_prob;
-					tot_scld_Mf-=Gene[c1].ini_prob;
-					if(c2!=Mf[c1])
-					{	free_mRNA[c1][c2] = free_mRNA[c1][Mf[c1]];					// Accounting of free mRNAs for next round
-					}
-					break;
-				}
-			}			
-			
-			if(t>thresh_time)
-			{	mRNA[m_id].ini_n++;													// Store the # of initn events on this mRNA
-				mRNA[m_id].avg_time_to_ini += t-mRNA[m_id].last_ini;				// Time between initn
-			}	
-			mRNA[m_id].last_ini = t;
 
-			c_id = Gene[mRNA[m_id].gene].seq[0];									// Codon at pos 1
 
-			Ribo[r_id].mRNA = m_id;							
-			
-			coin = gsl_rng_uniform(r);
-			prob_g = (double)Rfh/(double)Rf;
-			if(coin>prob_g)
-			{	if(R_grid[m_id][10]==tot_ribo)										// Check if the current ribosome can be elongated
-				{	Rb_e[c_id][n_Rb_e[c_id]] = r_id;								// If no ribosome at pos+10 then it can
-					Ribo[r_id].elng_cod_list = c_id;
-					Ribo[r_id].elng_pos_list = n_Rb_e[c_id];
-					n_Rb_e[c_id]++;
-				}
-				else
-				{	num_waste_ribo[mRNA[m_id].gene]++;
-					if(mRNA[m_id].gene==0)
-					{	num_waste_ribo_pos[0]++;
-					}
-				}
-				Ribo[r_id].inhbtr_bound = 0;
-			}
-			else
-			{	num_waste_ribo[mRNA[m_id].gene]++;
-				Rfh--;
-				Ribo[r_id].inhbtr_bound = 1;
-			}
-			R_grid[m_id][0] = r_id;													// Update the ribosome grid uypon initiation
-			
-			Rf--;																	// Update number of free ribosomes
+// Compare a statistic after the exact (x) and the leaped (y) burn-in: means across replicates, relative difference
+// and, with more than one replicate, the z-score of the difference of the means and its two-sided p-value.
+// The difference is flagged as significant, and n_sig increased, if the p-value is below 0.05 after a Bonferroni
+// correction for the n_tests statistics compared.
+void Leap_Compare(FILE *fh, char *name, double *x, double *y, int n_tests, int *n_sig)
+{	int n_x, n_y;
+	double mean_x, var_x, mean_y, var_y;
+	double den, se, z, p;
+	
+	Replicate_Moments(x, n_replicates, &mean_x, &var_x, &n_x);
+	Replicate_Moments(y, n_replicates, &mean_y, &var_y, &n_y);
+	if(n_x==0 || n_y==0)
+	{	return;
+	}
+	den = (fabs(mean_x)+fabs(mean_y))/2;
+	fprintf(fh,"%s\t%g\t%g\t%g",name,mean_x,mean_y,(den>0) ? (mean_y-mean_x)/den : 0.0);
+	se = sqrt(var_x/(double)n_x+var_y/(double)n_y);
+	if(n_x>1 && n_y>1 && se>0)
+	{	z = (mean_y-mean_x)/se;
+		p = erfc(fabs(z)/sqrt(2.0));
+		fprintf(fh,"\t%g\t%g\t%s\n",z,p,(p<0.05/n_tests) ? "*" : "");
+		if(p<0.05/n_tests)
+		{	(*n_sig)++;
 		}
-		// Harringtonine action
-		else if(coin<prob_harr)
-		{	Rfh++;
+	}
+	else
+	{	fprintf(fh,"\tNA\tNA\t\n");
+	}
+}
+
+// Validation of the leaped burn-in (-Tv): the cells are simulated once with an exact burn-in (outputs <prefix>_exact)
+// and once with the leaped one, and the statistics collected after the burn-in are compared
+void Leap_Validation(gene *Gene, trna *cTRNA)
+{	int c1, c2;
+	int n_tests = 0, n_sig = 0;
+	double eps = leap_eps;
+	double wall[2];
+	long n_ev[2], n_drop[2];
+	double x[n_replicates], y[n_replicates];
+	char exact_prefix[200], out_file[200], name[50];
+	struct timespec ts1, ts2;
+	replicate *Rep[2];
+	FILE *fh;
+	
+	sprintf(exact_prefix,"%s_exact",out_prefix);
+	for(c1=0;c1<2;c1++)
+	{	Rep[c1] = Replicate_Alloc();
+		leap_eps = (c1==0) ? 0 : eps;
+		clock_gettime(CLOCK_MONOTONIC, &ts1);
+		if(n_replicates > 1)
+		{	Replicate_Pool_Run(Gene, cTRNA, Rep[c1], (c1==0) ? exact_prefix : out_prefix);
 		}
-		// CHX dissociaction
-		else if(coin<prob_chx_ds)
-		{	x = gsl_rng_uniform_int(r, (unsigned long)tot_stall_chx);				// Randomly pick a CHX bound ribosome
-			r_id = chx_r_id[x];
-			m_id = Ribo[r_id].mRNA;
-			c_id = Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos];
-			
-			if((Ribo[r_id].pos+11)>=Gene[mRNA[m_id].gene].len || R_grid[m_id][Ribo[r_id].pos+11]==tot_ribo)
-			{	Rb_e[c_id][n_Rb_e[c_id]] = r_id;
-				Ribo[r_id].elng_cod_list = c_id;
-				Ribo[r_id].elng_pos_list = n_Rb_e[c_id];
-				n_Rb_e[c_id]++;
+		else
+		{	Simulate_Cell(Gene, cTRNA, 0, (c1==0) ? exact_prefix : out_prefix, Rep[c1]);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &ts2);
+		wall[c1] = (double)(ts2.tv_sec-ts1.tv_sec)+1e-9*(double)(ts2.tv_nsec-ts1.tv_nsec);
+		n_ev[c1] = n_drop[c1] = 0;
+		for(c2=0;c2<n_replicates;c2++)
+		{	n_ev[c1] += Rep[c1][c2].leap_events;
+			n_drop[c1] += Rep[c1][c2].leap_dropped;
+		}
+	}
+	if(n_replicates > 1)
+	{	Print_Merged_Replicates(Rep[1]);
+	}
+	
+	strcpy(out_file,out_prefix);
+	fh = Output_Open(strcat(out_file,"_leap_validation.out"),"w");
+	if(fh == NULL)
+	{	printf("\nCannot write %s\n",out_file);fflush(stdout);
+		exit(1);
+	}
+	fprintf(fh,"Burn_in\tError_control\tWall_time(sec)\tLeaped_events\tDropped_events\n");
+	fprintf(fh,"Exact\t0\t%g\t%ld\t%ld\n",wall[0],n_ev[0],n_drop[0]);
+	fprintf(fh,"Leaped\t%g\t%g\t%ld\t%ld\n",eps,wall[1],n_ev[1],n_drop[1]);
+	fprintf(fh,"\nStatistic\tExact_mean\tLeaped_mean\tRel_diff\tZ_score\tP_value\tSignificant\n");
+	n_tests = 62*printOpt[3]+61*printOpt[0]+n_genes*(printOpt[1]+printOpt[2]);
+	if(printOpt[3]==1)
+	{	for(c2=0;c2<n_replicates;c2++)
+		{	x[c2] = Rep[0][c2].avg_Rf;
+			y[c2] = Rep[1][c2].avg_Rf;
+		}
+		Leap_Compare(fh, "Free_ribo", x, y, n_tests, &n_sig);
+		for(c1=0;c1<61;c1++)
+		{	for(c2=0;c2<n_replicates;c2++)
+			{	x[c2] = Rep[0][c2].avg_tRNA[c1];
+				y[c2] = Rep[1][c2].avg_tRNA[c1];
 			}
-			if(Ribo[r_id].pos!=(Gene[mRNA[m_id].gene].len-1) && Ribo[r_id].pos>1)	// Check if the current elongation has led to termination
-			{	Tf[cTRNA[Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos-2]].tid]++;
+			sprintf(name,"Free_tRNA%d",c1);
+			Leap_Compare(fh, name, x, y, n_tests, &n_sig);
+		}
+	}
+	if(printOpt[0]==1)
+	{	for(c1=0;c1<61;c1++)
+		{	for(c2=0;c2<n_replicates;c2++)
+			{	x[c2] = Rep[0][c2].etimes[c1];
+				y[c2] = Rep[1][c2].etimes[c1];
 			}
-			Ribo[r_id].inhbtr_bound = 0;
-			
-			tot_stall_chx--;
-			chx_r_id[x] = chx_r_id[tot_stall_chx];
-			num_stall_chx[mRNA[m_id].gene]--;
+			sprintf(name,"Elong_time_codon%d",c1);
+			Leap_Compare(fh, name, x, y, n_tests, &n_sig);
 		}
-		// Translation Elongation
-		else
-		{	tmp_elng_prob = prob_chx_ds;
-			for(c1=0;c1<61;c1++)	
-			{	prob_e[c1] = tmp_elng_prob + r_elng[c1]*inv_rate;					// Prob of elongn of codon 1
-				if(coin<prob_e[c1])
-				{	c_id = c1;
-					break;
-				}
-				tmp_elng_prob = prob_e[c1];
+	}
+	if(printOpt[1]==1)
+	{	for(c1=0;c1<n_genes;c1++)
+		{	for(c2=0;c2<n_replicates;c2++)
+			{	x[c2] = Rep[0][c2].g_etimes[c1];
+				y[c2] = Rep[1][c2].g_etimes[c1];
 			}
-			
-			x = gsl_rng_uniform_int(r, (unsigned long)n_Rb_e[c_id]);				// Randomly pick an elongatable ribosome bound to codon c_id
-			r_id = Rb_e[c_id][x];
-			m_id = Ribo[r_id].mRNA;
-			
-			// Elongation arrest due to Cycloheximide action
-			coin = gsl_rng_uniform(r);
-			if(coin<chx_rb_prob && t>chx_time)
-			{	n_Rb_e[c_id]--;														// Remove it from the list of elongatable codons
-				if(x!=n_Rb_e[c_id])
-				{	Ribo[Rb_e[c_id][n_Rb_e[c_id]]].elng_pos_list = x;				// Update the ids and number of elongatable ribosomes
-					Rb_e[c_id][x] = Rb_e[c_id][n_Rb_e[c_id]];
-				}
-				if(Ribo[r_id].pos!=(Gene[mRNA[m_id].gene].len-1))					// Check if the current elongation has led to termination
-				{	Tf[cTRNA[c_id].tid]--;
-					R_grid[m_id][Ribo[r_id].pos] = tot_ribo;
-					Ribo[r_id].pos++;
-					R_grid[m_id][Ribo[r_id].pos] = r_id;
-				}
-				else
-				{	termtn_now=1;
-				}
-				num_stall_chx[mRNA[m_id].gene]++;
-
-				Ribo[r_id].inhbtr_bound = 1;
-
-				chx_r_id[tot_stall_chx] = r_id;
-				tot_stall_chx++;
+			sprintf(name,"Total_elong_time_gene%d",c1);
+			Leap_Compare(fh, name, x, y, n_tests, &n_sig);
+		}
+	}
+	if(printOpt[2]==1)
+	{	for(c1=0;c1<n_genes;c1++)
+		{	for(c2=0;c2<n_replicates;c2++)
+			{	x[c2] = Rep[0][c2].g_ini[c1];
+				y[c2] = Rep[1][c2].g_ini[c1];
 			}
-			// Normal elongation cycle
-			else
-			{	if(Ribo[r_id].pos>0)													// Release the tRNA bound at the earlier position
-				{	Tf[cTRNA[Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos-1]].tid]++;
-				}
-						
-				if(Ribo[r_id].pos==(Gene[mRNA[m_id].gene].len-1))						// Check if the current elongation has led to termination
-				{	R_grid[m_id][Ribo[r_id].pos] = tot_ribo;							// Update the position of ribosomes on the mRNA
-				
-					Ribo[r_id].pos++;
-					Rf++;																// Free a ribosome upon termination
+			sprintf(name,"Initiation_time_gene%d",c1);
+			Leap_Compare(fh, name, x, y, n_tests, &n_sig);
+		}
+	}
+	fclose(fh);
+	
+	if(n_replicates<2)
+	{	printf("\nThe leaped burn-in cannot be tested for significant differences with one replicate (-n)\n");
+	}
+	else if(n_sig>0)
+	{	printf("\n%d of %d statistics differ significantly after the exact and the leaped burn-in (see %s)\n",n_sig,n_tests,out_file);
+		printf("Use a smaller error control than -Tl %g for this cell\n",eps);
+	}
+	else
+	{	printf("\nNo statistic differs significantly after the exact and the leaped burn-in\n");
+	}
+	fflush(stdout);
+	
+	leap_eps = eps;
+	Replicate_Free(Rep[0]);
+	Replicate_Free(Rep[1]);
+}
 
-					n_Rb_e[c_id]--;
-					if(x!=n_Rb_e[c_id])
-					{	Ribo[Rb_e[c_id][n_Rb_e[c_id]]].elng_pos_list = x;				// Update the ids and number of elongatable ribosomes
-						Rb_e[c_id][x] = Rb_e[c_id][n_Rb_e[c_id]];
-					}
-			
-					if(t>thresh_time)
-					{	if(printOpt[0]==1)
-						{	e_times[c_id] += t-Ribo[r_id].t_elong_ini;					// For estimation of avg elongation times of codons
-							n_e_times[c_id]++;
-						}
-						mRNA[m_id].trans_n++;											// Update the number of trans evnts on curr mRNA
-						mRNA[m_id].avg_time_to_trans += t-Ribo[r_id].t_trans_ini;		// Update the time to translation
-					}
 
-					// Update any previously unelongatable ribosomes
-					if(R_grid[m_id][Ribo[r_id].pos-11]<tot_ribo)						// When the ribosome moves, a previously unelongatable ribosome
-					{	c2_id = Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos-11];			// can now be elongatable on the same mRNA if its 11 codon behind
-						Rb_e[c2_id][n_Rb_e[c2_id]] = R_grid[m_id][Ribo[r_id].pos-11];
-					
-						Ribo[R_grid[m_id][Ribo[r_id].pos-11]].elng_cod_list = c2_id;
-						Ribo[R_grid[m_id][Ribo[r_id].pos-11]].elng_pos_list = n_Rb_e[c2_id];
-						n_Rb_e[c2_id]++;
 
-						num_waste_ribo[mRNA[m_id].gene]--;
-						if(mRNA[m_id].gene==0)
-						{	num_waste_ribo_pos[Ribo[r_id].pos-11]--;
-						}
-					}
-								
-					// Update the ribosomes avail for initiation
-					next_avail_ribo--;
-				
-					if(r_id!=next_avail_ribo)											// The last initiated ribosome's data is swapped with
-					{	Ribo[r_id].mRNA = Ribo[next_avail_ribo].mRNA;					// the ribosome that just finished translation (terminated)
-						Ribo[r_id].pos = Ribo[next_avail_ribo].pos;						// This is done to primarily keep track of ONLY ribosomes
-						Ribo[r_id].t_trans_ini = Ribo[next_avail_ribo].t_trans_ini;		// that are currently bound for faster computation
-						Ribo[r_id].t_elong_ini = Ribo[next_avail_ribo].t_elong_ini;
-						
-						Ribo[r_id].elng_cod_list = Gene[mRNA[Ribo[next_avail_ribo].mRNA].gene].seq[Ribo[next_avail_ribo].pos];
-						Ribo[r_id].elng_pos_list = Ribo[next_avail_ribo].elng_pos_list;
-						R_grid[Ribo[r_id].mRNA][Ribo[r_id].pos] = r_id;
-						
-						if(R_grid[Ribo[r_id].mRNA][Ribo[r_id].pos+10]==tot_ribo || (Ribo[r_id].pos+10)>=Gene[mRNA[Ribo[r_id].mRNA].gene].len)
-						{	Rb_e[Ribo[r_id].elng_cod_list][Ribo[r_id].elng_pos_list] = r_id;
-						}
-					}
-					termtn_now = 1;
-				
-				}
-				else if((Ribo[r_id].pos+11)>=Gene[mRNA[m_id].gene].len || R_grid[m_id][Ribo[r_id].pos+11]==tot_ribo)	// Check if the ribosome is still elongatable
-				{	R_grid[m_id][Ribo[r_id].pos] = tot_ribo;															// Update the position of ribosomes on the mRNA
-					
-					Ribo[r_id].pos++;
-					R_grid[m_id][Ribo[r_id].pos] = r_id;
-					c2_id = Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos];
-					
-					if(c2_id!=c_id)															// If the codon has changed shift the elongatable ribosome
-					{	Rb_e[c2_id][n_Rb_e[c2_id]] = r_id;									// to the other codon
-						Ribo[r_id].elng_cod_list = c2_id;
-						Ribo[r_id].elng_pos_list = n_Rb_e[c2_id];
-						n_Rb_e[c2_id]++;
-						
-						n_Rb_e[c_id]--;
-						if(x!=n_Rb_e[c_id])
-						{	Ribo[Rb_e[c_id][n_Rb_e[c_id]]].elng_pos_list = x;				// Update the ids and number of elongatable ribosomes
-							Rb_e[c_id][x] = Rb_e[c_id][n_Rb_e[c_id]];
-						}
-					}
-					Tf[cTRNA[c_id].tid]--;
-				}
-				else																		// When ribosome is not elongatable anymore
-				{	R_grid[m_id][Ribo[r_id].pos] = tot_ribo;								// Update the position of ribosomes on the mRNA
-				
-					Ribo[r_id].pos++;
-					R_grid[m_id][Ribo[r_id].pos] = r_id;
-					Ribo[r_id].elng_cod_list = Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos];
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-					n_Rb_e[c_id]--;
-					if(x!=n_Rb_e[c_id])
-					{	Ribo[Rb_e[c_id][n_Rb_e[c_id]]].elng_pos_list = x;					// Update the ids and number of elongatable ribosomes
-						Rb_e[c_id][x] = Rb_e[c_id][n_Rb_e[c_id]];
-					}
-				
-					Tf[cTRNA[c_id].tid]--;
-					num_waste_ribo[mRNA[m_id].gene]++;
-					if(mRNA[m_id].gene==0)
-					{	num_waste_ribo_pos[Ribo[r_id].pos]++;
-					}
-				}
-			}
-			if(termtn_now==0)															// When elongation does not lead to termination
-			{	if(Ribo[r_id].pos>10 && R_grid[m_id][Ribo[r_id].pos-11]<tot_ribo)		// When the ribosome moves, a previously unelongatable ribosome
-				{	if(Ribo[R_grid[m_id][Ribo[r_id].pos-11]].inhbtr_bound==0)			// can now be elongated on the same mRNA if its 11 codon behind
-					{	c2_id = Gene[mRNA[m_id].gene].seq[Ribo[r_id].pos-11];
-						Rb_e[c2_id][n_Rb_e[c2_id]] = R_grid[m_id][Ribo[r_id].pos-11];
-					
-						Ribo[R_grid[m_id][Ribo[r_id].pos-11]].elng_cod_list = c2_id;
-						Ribo[R_grid[m_id][Ribo[r_id].pos-11]].elng_pos_list = n_Rb_e[c2_id];
-						n_Rb_e[c2_id]++;
-					
-						num_waste_ribo[mRNA[m_id].gene]--;
-						if(mRNA[m_id].gene==0)
-						{	num_waste_ribo_pos[Ribo[r_id].pos-11]--;
-						}
-					}
-				}
-				if(Ribo[r_id].pos==10)													// If the current position is at codon 11 make the current mRNA initiable
-				{	g_id = mRNA[m_id].gene;
-					free_mRNA[g_id][Mf[g_id]] = m_id;
-					Mf[g_id]++;
-					scld_Mf[g_id] += Gene[g_id].ini_prob;
-					tot_scld_Mf += Gene[g_id].ini_prob;
-				}
 
-				Ribo[r_id].t_elong_ini = t;												// Upon elongation, update the elong ini time for the next evnt
+// Job server (-W) and its client (-Wc)
+// A job is one line of "<parameter> <value>" pairs, with the parameters named as their options (see Help_out).
+// Every job is answered with one line, in the order the jobs finish.
+
+// Genome of a job, read on first use and kept
+// The files are read without holding S->lock, so other jobs go on meanwhile; the genome is added under the lock
+// unless another job read it in the meantime. Returns NULL and the reason in err if the files cannot be read.
+server_genome *Server_Genome(job_server *S, char *genome_file, char *code, int n, char *err)
+{	server_genome *G, *H;
+	FILE *fh;
+	char magic[8];
+	int n_read = 0, is_sgb;
+	
+	pthread_mutex_lock(&S->lock);
+	for(G=S->genome;G!=NULL;G=G->next)
+	{	if(strcmp(G->genome_file, genome_file) == 0 && strcmp(G->code_file, code) == 0 && G->n_genes == n)
+		{	break;
+		}
+	}
+	pthread_mutex_unlock(&S->lock);
+	if(G != NULL)
+	{	return G;
+	}
+	
+	fh = fopen(genome_file, "rb");
+	if(fh == NULL)
+	{	sprintf(err,"Sequence file %s not found",genome_file);
+		return NULL;
+	}
+	is_sgb = (fread(magic, 1, 8, fh) == 8 && memcmp(magic, SGB_MAGIC, 8) == 0);
+	fclose(fh);
+	fh = fopen(code, "r");
+	if(fh == NULL)
+	{	sprintf(err,"tRNA file %s not found",code);
+		return NULL;
+	}
+	fclose(fh);
+	
+	G = (server_genome *)malloc(sizeof(server_genome));
+	if(G != NULL)
+	{	G->Gene = (gene *)malloc(sizeof(gene) * n);
+	}
+	if(G == NULL || G->Gene == NULL)
+	{	sprintf(err,"Too many genes (%d), out of memory",n);
+		free(G);
+		return NULL;
+	}
+	G->map_size = 0;
+	if(is_sgb)
+	{	G->codon_buf = Map_Genome_File(genome_file, G->Gene, n, &n_read, &G->map_size, err);
+	}
+	else
+	{	G->codon_buf = Read_FASTA_File(genome_file, G->Gene, n, &n_read, err);
+	}
+	if(G->codon_buf == NULL || n_read<n)
+	{	if(G->codon_buf != NULL)
+		{	sprintf(err,"Sequence file %s contains %d genes, fewer than %d",genome_file,n_read,n);
+			if(G->map_size > 0)
+			{	munmap(G->codon_buf, G->map_size);
 			}
 			else
-			{	termtn_now = 0;
+			{	free(G->codon_buf);
 			}
-			
-			if(t>((double)t_print) && printOpt[6]==1)
-			{	for(c1=0;c1<tot_mRNA;c1++)
-				{	for(c2=0;c2<Gene[mRNA[c1].gene].len;c2++)
-					{	if(R_grid[c1][c2]!=tot_ribo)
-						{	gene_sp_ribo_500[mRNA[c1].gene][c2]++;
-						}
-					}
+		}
+		free(G->Gene);
+		free(G);
+		return NULL;
+	}
+	Read_tRNA_File(code, G->cTRNA);
+	strcpy(G->genome_file, genome_file);
+	strcpy(G->code_file, code);
+	G->n_genes = n;
+	
+	pthread_mutex_lock(&S->lock);
+	for(H=S->genome;H!=NULL;H=H->next)
+	{	if(strcmp(H->genome_file, genome_file) == 0 && strcmp(H->code_file, code) == 0 && H->n_genes == n)
+		{	break;
+		}
+	}
+	if(H == NULL)
+	{	G->next = S->genome;
+		S->genome = G;
+	}
+	pthread_mutex_unlock(&S->lock);
+	if(H != NULL)															// Read by another job in the meantime
+	{	if(G->map_size > 0)
+		{	munmap(G->codon_buf, G->map_size);
+		}
+		else
+		{	free(G->codon_buf);
+		}
+		free(G->Gene);
+		free(G);
+		return H;
+	}
+	return G;
+}
+
+// Snapshot of the given name, added if create is set (called with S->lock held)
+server_snapshot *Server_Snapshot(job_server *S, char *name, int create)
+{	server_snapshot *P;
+	
+	for(P=S->snap;P!=NULL;P=P->next)
+	{	if(strcmp(P->name, name) == 0)
+		{	return P;
+		}
+	}
+	if(!create)
+	{	return NULL;
+	}
+	P = (server_snapshot *)calloc(1, sizeof(server_snapshot));
+	if(P == NULL)
+	{	printf("Out of memory\n");fflush(stdout);
+		exit(1);
+	}
+	strcpy(P->name, name);
+	P->next = S->snap;
+	S->snap = P;
+	return P;
+}
+
+// Read a job line into J: the command-line values, changed by the pairs of the line, and queue it
+// The saves of a snapshot are counted and the job queued in one hold of the lock, so a job resuming from a snapshot
+// is always queued after the jobs saving it that it waits for
+// Returns 0 and the reason in err if the line is invalid
+int Server_Parse_Job(job_server *S, char *line, server_job *J, char *err)
+{	char *tok, *val, *end, *save;
+	char genome_file[150], code[150];
+	char *engines[3] = {"direct","cr","nrm"};
+	char *rngs[4] = {"mt19937","xoshiro","pcg64","philox"};
+	int n = n_genes;
+	int c1, p, ok, num;
+	double x;
+	server_snapshot *P;
+	
+	Par_Default(&J->par);
+	J->par.state_file = "";
+	J->par.stall_off = NULL;
+	J->par.n_stall_pos = 0;
+	J->stream = first_stream;
+	J->resume[0] = '\0';
+	J->save[0] = '\0';
+	J->prefix[0] = '\0';
+	J->reseed = 0;
+	J->n_wait = 0;
+	strcpy(genome_file, fasta_file);
+	strcpy(code, code_file);
+	
+	for(tok=strtok_r(line, " \t\r\n", &save);tok!=NULL;tok=strtok_r(NULL, " \t\r\n", &save))
+	{	val = strtok_r(NULL, " \t\r\n", &save);
+		if(val == NULL)
+		{	sprintf(err,"No value of %.32s",tok);
+			return 0;
+		}
+		x = strtod(val, &end);
+		num = (*end == '\0');
+		for(p=0;p<SWEEP_N_PAR && strcmp(tok, sweep_par_name[p]) != 0;p++);
+		
+		if(p<SWEEP_N_PAR)
+		{	ok = num && Sweep_Set(&J->par, p, x);
+		}
+		else if(strcmp(tok, "F") == 0 || strcmp(tok, "C") == 0 || strcmp(tok, "O") == 0)
+		{	ok = (strlen(val) < 150);
+			if(ok)
+			{	strcpy((tok[0]=='F') ? genome_file : ((tok[0]=='C') ? code : J->prefix), val);
+			}
+		}
+		else if(strcmp(tok, "k") == 0 || strcmp(tok, "K") == 0)
+		{	ok = (strlen(val) < 64);
+			if(ok)
+			{	strcpy((tok[0]=='k') ? J->resume : J->save, val);
+			}
+		}
+		else if(strcmp(tok, "N") == 0)
+		{	n = (int)x;
+			ok = num && x>=1 && x<=INT_MAX && x==floor(x);
+		}
+		else if(strcmp(tok, "Tt") == 0)
+		{	J->par.tot_time = x;
+			ok = num && x>0 && x<=MAX_TIME;
+		}
+		else if(strcmp(tok, "Tb") == 0)
+		{	J->par.thresh_time = x;
+			ok = num && x>=0;
+		}
+		else if(strcmp(tok, "Tl") == 0)
+		{	J->par.leap_eps = x;
+			ok = num && x>=0;
+		}
+		else if(strcmp(tok, "s") == 0)
+		{	J->par.seed = (int)x;
+			J->reseed = 1;
+			ok = num && x==floor(x);
+		}
+		else if(strcmp(tok, "Gs") == 0)
+		{	J->stream = (int)x;
+			J->reseed = 1;
+			ok = num && x>=0 && x==floor(x);
+		}
+		else if(strcmp(tok, "E") == 0 || strcmp(tok, "G") == 0)
+		{	ok = 0;
+			for(c1=0;c1<((tok[0]=='E') ? 3 : 4);c1++)
+			{	if(strcmp(val, (tok[0]=='E') ? engines[c1] : rngs[c1]) == 0)
+				{	*((tok[0]=='E') ? &J->par.engine : &J->par.rng_type) = c1;
+					ok = 1;
+				}
+			}
+		}
+		else if(strcmp(tok, "p") == 0)									// Comma-separated print options, 0 for none
+		{	memset(J->par.printOpt, 0, sizeof(J->par.printOpt));
+			ok = 1;
+			for(val=strtok_r(val, ",", &end);val!=NULL;val=strtok_r(NULL, ",", &end))
+			{	c1 = atoi(val);
+				ok = ok && (strlen(val) == 1 && c1>=0 && c1<=9);
+				if(ok && c1>0)
+				{	J->par.printOpt[c1-1] = 1;
 				}
-				t_print++;
 			}
 		}
+		else
+		{	sprintf(err,"Unknown parameter %.32s",tok);
+			return 0;
+		}
+		if(!ok)
+		{	sprintf(err,"Invalid value of %.32s",tok);
+			return 0;
+		}
+	}
+	J->par.n_genes = n;
+	if(J->par.thresh_time>=J->par.tot_time)
+	{	sprintf(err,"Tb should be < Tt");
+		return 0;
+	}
+	
+	J->genome = Server_Genome(S, genome_file, code, n, err);
+	if(J->genome == NULL)
+	{	return 0;
+	}
+	
+	pthread_mutex_lock(&S->lock);
+	ok = 1;
+	if(J->resume[0] != '\0')
+	{	P = Server_Snapshot(S, J->resume, 0);
+		if(P == NULL)
+		{	sprintf(err,"Unknown snapshot %s",J->resume);
+			ok = 0;
+		}
+		else
+		{	J->n_wait = P->n_queued;
+		}
+	}
+	if(ok && J->save[0] != '\0')
+	{	Server_Snapshot(S, J->save, 1)->n_queued++;
+	}
+	if(ok)
+	{	if(S->tail == NULL)
+		{	S->head = J;
+		}
+		else
+		{	S->tail->next = J;
+		}
+		S->tail = J;
+		pthread_cond_signal(&S->ready);
+	}
+	pthread_mutex_unlock(&S->lock);
+	return ok;
+}
+
+// Send a line to the client of a job and count the job as answered
+void Server_Reply(server_job *J, char *msg)
+{	server_conn *K = J->conn;
+	size_t done = 0;
+	ssize_t n;
+	
+	pthread_mutex_lock(&K->lock);
+	while(done < strlen(msg))												// A client that left is ignored (SIGPIPE is ignored)
+	{	n = write(K->fd, msg+done, strlen(msg)-done);
+		if(n <= 0 && errno != EINTR)
+		{	break;
+		}
+		done += (n > 0) ? n : 0;
+	}
+	K->n_left--;
+	pthread_cond_signal(&K->done);
+	pthread_mutex_unlock(&K->lock);
+}
+
+// Simulate a job: from a new cell or a snapshot up to Tt, keep the final state if asked, write the outputs with
+// prefix O if given, and answer with a summary: time and free ribosomes at the end, elongation events and their
+// average time after Tb (with p 1), ribosomes stalled by cycloheximide at the end and the wall time of the job
+void Server_Run_Job(job_server *S, server_job *J)
+{	cell C;
+	FILE *fh;
+	int c1;
+	long n_elng = 0;
+	double etime = 0.0;
+	char *state;
+	size_t size;
+	char msg[400];
+	server_snapshot *P;
+	struct timespec t1, t2;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	if(Cell_Init(&C, J->genome->Gene, J->genome->cTRNA, J->stream, 0, &J->par) == 0)
+	{	printf("Out of memory\n");fflush(stdout);
+		exit(1);
 	}
 	
+	// The snapshot is read once the earlier jobs saving it are done. Its cell must have the same size.
+	if(J->resume[0] != '\0')
+	{	pthread_mutex_lock(&S->lock);
+		P = Server_Snapshot(S, J->resume, 0);
+		while(P->n_saved < J->n_wait)
+		{	pthread_cond_wait(&S->saved, &S->lock);
+		}
+		if(P->state == NULL || P->genome != J->genome || P->tot_ribo != J->par.tot_ribo || P->engine != J->par.engine || P->rng_type != J->par.rng_type
+			|| P->avg_pools != J->par.printOpt[3] || P->avg_stall != J->par.printOpt[5])
+		{	pthread_mutex_unlock(&S->lock);
+			sprintf(msg,"%d\terror\tSnapshot %s is not of a cell with these F, C, N, R, E, G, p4 and p6\n",J->id,J->resume);
+			Cell_Free(&C);
+			if(J->save[0] != '\0')
+			{	pthread_mutex_lock(&S->lock);
+				Server_Snapshot(S, J->save, 0)->n_saved++;
+				pthread_cond_broadcast(&S->saved);
+				pthread_mutex_unlock(&S->lock);
+			}
+			Server_Reply(J, msg);
+			return;
+		}
+		fh = fmemopen(P->state, P->size, "rb");
+		if(fh == NULL)
+		{	printf("Out of memory\n");fflush(stdout);
+			exit(1);
+		}
+		Cell_Checkpoint_IO(&C, fh, 0);
+		fclose(fh);
+		pthread_mutex_unlock(&S->lock);
+		if(J->reseed)
+		{	Rng_Set(C.r, (unsigned long) J->par.seed, C.rep, C.part);
+		}
+	}
 	
+	Cell_Run(&C, J->par.tot_time);
 	
+	if(J->save[0] != '\0')
+	{	fh = open_memstream(&state, &size);
+		if(fh == NULL)
+		{	printf("Out of memory\n");fflush(stdout);
+			exit(1);
+		}
+		Cell_Checkpoint_IO(&C, fh, 1);
+		fclose(fh);
+		pthread_mutex_lock(&S->lock);
+		P = Server_Snapshot(S, J->save, 0);
+		free(P->state);
+		P->state = state;
+		P->size = size;
+		P->genome = J->genome;
+		P->tot_ribo = J->par.tot_ribo;
+		P->engine = J->par.engine;
+		P->rng_type = J->par.rng_type;
+		P->avg_pools = J->par.printOpt[3];
+		P->avg_stall = J->par.printOpt[5];
+		P->t = C.t;
+		P->n_saved++;
+		pthread_cond_broadcast(&S->saved);
+		pthread_mutex_unlock(&S->lock);
+	}
 	
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////	
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	Avg_Flush(&C);
+	for(c1=0;c1<61;c1++)
+	{	n_elng += C.n_e_times[c1];
+		etime += C.e_times[c1];
+	}
+	if(strcmp(J->prefix, "") != 0)
+	{	Cell_Output(&C, J->prefix, NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+	sprintf(msg,"%d\tdone\t%g\t%d\t%ld\t%g\t%d\t%.3f\t%s\n",J->id,C.t,C.Rf,n_elng,etime/(double)n_elng,C.tot_stall_chx,Clock_Elapsed(&t1, &t2),J->prefix);
+	Cell_Free(&C);
+	Server_Reply(J, msg);
+}
+
+// Simulate the queued jobs, oldest first
+void *Server_Worker(void *arg)
+{	job_server *S = (job_server *)arg;
+	server_job *J;
 	
-	// Process output for printing
+	while(1)
+	{	pthread_mutex_lock(&S->lock);
+		while(S->head == NULL)
+		{	pthread_cond_wait(&S->ready, &S->lock);
+		}
+		J = S->head;
+		S->head = J->next;
+		if(S->head == NULL)
+		{	S->tail = NULL;
+		}
+		pthread_mutex_unlock(&S->lock);
 		
-	int n_trans[n_genes];
-	int **gene_sp_ribo;
-	gene_sp_ribo = malloc(sizeof(int *) * n_genes);
-	for(c1=0;c1<n_genes;c1++)
-	{	gene_sp_ribo[c1] = malloc(sizeof(int *) * Gene[c1].len);
+		Server_Run_Job(S, J);
+		free(J);
 	}
-	int **gene_sp_ribo_ns;
-	gene_sp_ribo_ns = malloc(sizeof(int *) * n_genes);
-	for(c1=0;c1<n_genes;c1++)
-	{	gene_sp_ribo_ns[c1] = malloc(sizeof(int *) * Gene[c1].len);
+	return NULL;
+}
+
+// Read the jobs of a client, queue them and close the connection once the client has sent all its jobs and
+// every one of them has been answered
+void *Server_Connection(void *arg)
+{	server_conn *K = (server_conn *)arg;
+	job_server *S = K->server;
+	server_job *J;
+	FILE *fh;
+	char *line = NULL;
+	size_t cap = 0;
+	char *hash;
+	char err[300];
+	char msg[400];
+	int id = 0;
+	
+	fh = fdopen(dup(K->fd), "r");
+	while(fh != NULL && getline(&line, &cap, fh) != -1)
+	{	if((hash = strchr(line, '#')) != NULL)
+		{	*hash = '\0';
+		}
+		if(strspn(line, " \t\r\n") == strlen(line))
+		{	continue;
+		}
+		J = (server_job *)malloc(sizeof(server_job));
+		if(J == NULL)
+		{	printf("Out of memory\n");fflush(stdout);
+			exit(1);
+		}
+		J->id = id++;
+		J->conn = K;
+		J->next = NULL;
+		pthread_mutex_lock(&K->lock);
+		K->n_left++;
+		pthread_mutex_unlock(&K->lock);
+		
+		if(!Server_Parse_Job(S, line, J, err))
+		{	sprintf(msg,"%d\terror\t%s\n",J->id,err);
+			Server_Reply(J, msg);
+			free(J);
+		}
+	}
+	free(line);
+	if(fh != NULL)
+	{	fclose(fh);
 	}
 	
-	int n_tot=0;
-	int n_tot_ns=0;
-	int n_tot_all=0;
-	int gcount[obs_max_len];
-	double gmean = 0.0;
-	double gmean_ns = 0.0;
-	double avg_ribo_pos[4][obs_max_len];
-	double g_etimes[n_genes];
-	double g_ini[n_genes];
-	double dCST=0.0;
+	pthread_mutex_lock(&K->lock);
+	while(K->n_left > 0)
+	{	pthread_cond_wait(&K->done, &K->lock);
+	}
+	pthread_mutex_unlock(&K->lock);
+	close(K->fd);
+	pthread_mutex_destroy(&K->lock);
+	pthread_cond_destroy(&K->done);
+	free(K);
+	return NULL;
+}
+
+// Serve jobs sent to server_socket, simulated by n_threads threads, until the process is ended
+void Run_Server()
+{	job_server S;
+	server_conn *K;
+	struct sockaddr_un addr;
+	pthread_t thread;
+	pthread_attr_t attr;
+	int c1, fd, lfd;
 	
-	if(printOpt[1]==1 || printOpt[2]==1 || printOpt[3]==1)
-	{	c3 = 0;
-		for(c1=0;c1<n_genes;c1++)
-		{	n_trans[c1] = 0;
-			g_ini[c1]=0.0;
-			g_etimes[c1]=0.0;
-			
-			for(c2=0;c2<Gene[c1].exp;c2++)
-			{	n_trans[c1] += mRNA[c3].trans_n;
-				g_ini[c1] += mRNA[c3].avg_time_to_ini;
-				g_etimes[c1] += mRNA[c3].avg_time_to_trans;
-				n_tot += mRNA[c3].trans_n;
-				c3++;
-			}
+	signal(SIGPIPE, SIG_IGN);
+	memset(&S, 0, sizeof(job_server));
+	pthread_mutex_init(&S.lock, NULL);
+	pthread_cond_init(&S.ready, NULL);
+	pthread_cond_init(&S.saved, NULL);
+	
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, server_socket);
+	unlink(server_socket);
+	lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(lfd < 0 || bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(lfd, 64) != 0)
+	{	printf("\nCannot listen on socket %s\n",server_socket);fflush(stdout);
+		exit(1);
+	}
+	
+	// Cell_Output keeps its per-gene and per-position arrays on the stack
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, THREAD_STACK_SIZE);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	for(c1=0;c1<n_threads;c1++)
+	{	if(pthread_create(&thread, &attr, Server_Worker, &S) != 0)
+		{	printf("\nCould not start simulation thread %d\n",c1);fflush(stdout);
+			exit(1);
 		}
 	}
+	printf("Job server listening on %s with %d threads\n",server_socket,n_threads);fflush(stdout);
 	
+	while(1)
+	{	fd = accept(lfd, NULL, NULL);
+		if(fd < 0)
+		{	continue;
+		}
+		K = (server_conn *)malloc(sizeof(server_conn));
+		if(K == NULL)
+		{	printf("Out of memory\n");fflush(stdout);
+			exit(1);
+		}
+		K->fd = fd;
+		K->n_left = 0;
+		K->server = &S;
+		pthread_mutex_init(&K->lock, NULL);
+		pthread_cond_init(&K->done, NULL);
+		if(pthread_create(&thread, &attr, Server_Connection, K) != 0)
+		{	printf("\nCould not start connection thread\n");fflush(stdout);
+			exit(1);
+		}
+	}
+}
+
+// Send the jobs read from stdin to the server at server_socket and copy its answers to stdout
+void *Client_Send(void *arg)
+{	int fd = *(int *)arg;
+	char buf[65536];
+	ssize_t n, done, w;
 	
-	// Print the output
+	while((n = read(0, buf, sizeof(buf))) > 0)
+	{	for(done=0;done<n;done+=w)
+		{	w = write(fd, buf+done, n-done);
+			if(w <= 0)
+			{	shutdown(fd, SHUT_WR);
+				return NULL;
+			}
+		}
+	}
+	shutdown(fd, SHUT_WR);
+	return NULL;
+}
+
+void Run_Client()
+{	struct sockaddr_un addr;
+	pthread_t thread;
+	char buf[65536];
+	ssize_t n;
+	int fd;
 	
-	// Elongation times of all codons
-	if(printOpt[0]==1)
-	{	strcpy(out_file,out_prefix);
-		f2 = fopen(strcat(out_file,"_etimes.out"),"w");
-		
-		fprintf(f2,"Codon\tNum_of_events\tAvg_elong_time(sec)\n");
-		for(c1=0;c1<61;c1++)
-		{	dCST = e_times[c1]/(double)n_e_times[c1];
-			fprintf(f2,"%d\t%d\t%g\n",c1,n_e_times[c1],dCST);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, server_socket);
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+	{	printf("\nNo job server on socket %s\n",server_socket);fflush(stdout);
+		exit(1);
+	}
+	if(pthread_create(&thread, NULL, Client_Send, &fd) != 0)
+	{	printf("\nCould not start client thread\n");fflush(stdout);
+		exit(1);
+	}
+	while((n = read(fd, buf, sizeof(buf))) > 0)
+	{	fwrite(buf, 1, n, stdout);
+		fflush(stdout);
+	}
+	pthread_join(thread, NULL);
+	close(fd);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Library interface (smopt.h)
+
+struct smopt_sim
+{	cell C;
+	gene *Gene;					// Copy of the genome
+	uint8_t *codons;
+	trna code[61];				// Copy of the tRNA table
+	int print_opt[9];			// Statistics gathered by the cell
+	long *row_off;				// Offset of the row of each mRNA in the occupancy grid, and the size of the grid
+	int *mRNA_gene;				// Gene of each mRNA
+};
+
+void smopt_default_params(smopt_params *P)
+{	P->tot_ribo = 2e5;
+	P->tot_tRNA = 3.3e6;
+	P->volume = 4.2e-17;
+	P->chx_rb_prob = 0.0;
+	P->chx_ds_rate = 0.0;
+	P->harr_rf_rate = 0.0;
+	P->chx_time = 1500;
+	P->harr_time = 1500;
+	P->thresh_time = 1000;
+	P->engine = ENGINE_DIRECT;
+	P->rng = RNG_MT19937;
+	P->seed = 1;
+	P->stream = 0;
+	P->leap_eps = 0;
+}
+
+smopt_sim *smopt_create(const smopt_params *P, int n_genes, const int *len, const uint8_t *const *seq, const double *ini_prob,
+	const int *n_mRNA, const int *tid, const int *gcn, const double *wobble)
+{	int c1, c2;
+	size_t n_codons = 0;
+	cell_par par;
+	smopt_sim *S;
+	
+	if(P->tot_ribo < 1 || P->tot_tRNA < 0 || P->engine < ENGINE_DIRECT || P->engine > ENGINE_NRM || P->rng < RNG_MT19937 || P->rng > RNG_PHILOX || P->leap_eps < 0 || n_genes < 1)
+	{	return NULL;
+	}
+	if(Sweep_Set(&par, 2, P->volume) == 0 || Sweep_Set(&par, 3, P->chx_rb_prob) == 0 || Sweep_Set(&par, 4, P->chx_ds_rate) == 0 || Sweep_Set(&par, 5, P->harr_rf_rate) == 0 || Sweep_Set(&par, 6, P->chx_time) == 0 || Sweep_Set(&par, 7, P->harr_time) == 0)
+	{	return NULL;
+	}
+	for(c1=0;c1<n_genes;c1++)
+	{	if(len[c1] < 1 || n_mRNA[c1] < 0 || ini_prob[c1] < 0)
+		{	return NULL;
 		}
-		fclose(f2);
+		for(c2=0;c2<len[c1];c2++)
+		{	if(seq[c1][c2] > 60)
+			{	return NULL;
+			}
+		}
+		n_codons += len[c1];
+	}
+	for(c1=0;c1<61;c1++)
+	{	if(tid[c1] < 0 || tid[c1] > 60 || gcn[c1] < 0)
+		{	return NULL;
+		}
+	}
+	
+	S = (smopt_sim *)calloc(1, sizeof(smopt_sim));
+	if(S == NULL)
+	{	return NULL;
+	}
+	S->Gene = (gene *)malloc(sizeof(gene) * n_genes);
+	S->codons = (uint8_t *)malloc(n_codons);
+	if(S->Gene == NULL || S->codons == NULL)
+	{	free(S->Gene);
+		free(S->codons);
+		free(S);
+		return NULL;
+	}
+	n_codons = 0;
+	for(c1=0;c1<n_genes;c1++)
+	{	S->Gene[c1].seq = S->codons + n_codons;
+		memcpy(S->Gene[c1].seq, seq[c1], len[c1]);
+		S->Gene[c1].len = len[c1];
+		S->Gene[c1].exp = n_mRNA[c1];
+		S->Gene[c1].ini_prob = ini_prob[c1];
+		n_codons += len[c1];
+	}
+	for(c1=0;c1<61;c1++)
+	{	strcpy(S->code[c1].codon, "");
+		S->code[c1].tid = tid[c1];
+		S->code[c1].gcn = gcn[c1];
+		S->code[c1].wobble = wobble[c1];
+	}
+	
+	// Elongation times (-p1), times of genes (-p2, -p3), free pools (-p4) and stalled ribosomes (-p6)
+	for(c1=0;c1<9;c1++)
+	{	S->print_opt[c1] = (c1<4 || c1==5);
+	}
+	par.tot_ribo = P->tot_ribo;
+	par.tot_tRNA = P->tot_tRNA;
+	par.n_genes = n_genes;
+	par.tot_time = P->thresh_time;
+	par.thresh_time = P->thresh_time;
+	par.engine = P->engine;
+	par.rng_type = P->rng;
+	par.seed = P->seed;
+	par.leap_eps = P->leap_eps;
+	memcpy(par.printOpt, S->print_opt, sizeof(par.printOpt));
+	par.state_file = "";
+	par.stall_off = NULL;
+	par.n_stall_pos = 0;
+	
+	if(Cell_Init(&S->C, S->Gene, S->code, P->stream, 0, &par) == 0)
+	{	free(S->codons);
+		free(S->Gene);
+		free(S);
+		return NULL;
+	}
+	
+	S->row_off = (long *)malloc(sizeof(long) * (S->C.n_mRNA+1));
+	S->mRNA_gene = (int *)malloc(sizeof(int) * S->C.n_mRNA);
+	if(S->row_off == NULL || S->mRNA_gene == NULL)
+	{	smopt_destroy(S);
+		return NULL;
+	}
+	S->row_off[0] = 0;
+	for(c1=0;c1<S->C.n_mRNA;c1++)
+	{	S->mRNA_gene[c1] = S->C.mRNA[c1].gene;
+		S->row_off[c1+1] = S->row_off[c1]+S->Gene[S->mRNA_gene[c1]].len+GRID_PAD;
+	}
+	return S;
+}
+
+void smopt_run(smopt_sim *S, double t)
+{	S->C.par.tot_time = t;								// A cell without events jumps to the end of the run
+	Cell_Run(&S->C, t);
+	Avg_Flush(&S->C);
+}
+
+long smopt_step(smopt_sim *S, long n_events)
+{	long n_left;
+	
+	if(n_events <= 0)
+	{	return 0;
+	}
+	S->C.par.tot_time = S->C.t;							// A cell without events stays where it is
+	S->C.events_left = n_events;
+	Cell_Run(&S->C, INFINITY);
+	Avg_Flush(&S->C);
+	n_left = S->C.events_left;
+	S->C.events_left = 0;
+	return n_events-n_left;
+}
+
+int smopt_set_drugs(smopt_sim *S, const smopt_params *P)
+{	cell_par par = S->C.par;
+	
+	if(Sweep_Set(&par, 3, P->chx_rb_prob) == 0 || Sweep_Set(&par, 4, P->chx_ds_rate) == 0 || Sweep_Set(&par, 5, P->harr_rf_rate) == 0 || Sweep_Set(&par, 6, P->chx_time) == 0 || Sweep_Set(&par, 7, P->harr_time) == 0)
+	{	return 0;
 	}
+	S->C.par = par;
+	return 1;
+}
+
+double smopt_time(smopt_sim *S)
+{	return S->C.t;
+}
+
+int smopt_n_mRNA(smopt_sim *S)
+{	return S->C.n_mRNA;
+}
+
+const int *smopt_Tf(smopt_sim *S)
+{	return S->C.Tf;
+}
+
+const int *smopt_n_Rb_e(smopt_sim *S)
+{	return S->C.n_Rb_e;
+}
+
+const int *smopt_Mf(smopt_sim *S)
+{	return S->C.Mf;
+}
+
+const int *smopt_grid(smopt_sim *S, const long **row_off, const int **mRNA_gene)
+{	*row_off = S->row_off;
+	*mRNA_gene = S->mRNA_gene;
+#ifdef SPARSE_RGRID
+	return NULL;
+#else
+	return S->C.R_grid.cells;
+#endif
+}
+
+void smopt_codon_etimes(smopt_sim *S, int *n_events, double *avg_time)
+{	int c1;
 	
-	// Average total elongation times of all genes
-	if(printOpt[1]==1)
-	{	strcpy(out_file,out_prefix);
-		f3 = fopen(strcat(out_file,"_gene_totetimes.out"),"w");
-		
-		fprintf(f3,"Gene\tNum_of_events\tAvg_total_elong_time(sec)\tNum_elng_stall\tNum_chx_stall\n");
-		for(c1=0;c1<n_genes;c1++)
-		{	dCST = g_etimes[c1]/(double)n_trans[c1];
-			fprintf(f3,"%d\t%d\t%g\t%d\t%d\n",c1,n_trans[c1],dCST,num_waste_ribo[c1],num_stall_chx[c1]);
-		}
-		fclose(f3);
+	for(c1=0;c1<61;c1++)
+	{	n_events[c1] = S->C.n_e_times[c1];
+		avg_time[c1] = (S->C.n_e_times[c1] > 0) ? S->C.e_times[c1]/(double)S->C.n_e_times[c1] : 0;
 	}
+}
+
+void smopt_gene_times(smopt_sim *S, int *n_trans, double *avg_ini, double *avg_elng)
+{	int c1, c2, c3 = 0;
+	double ini, elng;
+	transcript *mRNA = S->C.mRNA;
 	
-	// Average time between initiation of all genes
-	if(printOpt[2]==1)
-	{	strcpy(out_file,out_prefix);
-		f4 = fopen(strcat(out_file,"_gene_initimes.out"),"w");
-		
-		fprintf(f4,"Gene\tNum_of_events\tAvg_initiation_time(sec)\n");
-		for(c1=0;c1<n_genes;c1++)
-		{	dCST = g_ini[c1]/(double)n_trans[c1];
-			fprintf(f4,"%d\t%d\t%g\n",c1,n_trans[c1],dCST);
+	for(c1=0;c1<S->C.par.n_genes;c1++)
+	{	n_trans[c1] = 0;
+		ini = 0.0;
+		elng = 0.0;
+		for(c2=0;c2<S->Gene[c1].exp;c2++)
+		{	n_trans[c1] += mRNA[c3].trans_n;
+			ini += mRNA[c3].avg_time_to_ini;
+			elng += mRNA[c3].avg_time_to_trans;
+			c3++;
 		}
-		fclose(f4);
+		avg_ini[c1] = (n_trans[c1] > 0) ? ini/(double)n_trans[c1] : 0;
+		avg_elng[c1] = (n_trans[c1] > 0) ? elng/(double)n_trans[c1] : 0;
 	}
+}
+
+void smopt_avg_pools(smopt_sim *S, double *avg_ribo, double *avg_tRNA)
+{	int c1;
+	double span = S->C.t-S->C.par.thresh_time;
 	
-	// Average number of free ribosomes and tRNAs at equilibrium
-	if(printOpt[3]==1)
-	{	strcpy(out_file,out_prefix);
-		f5 = fopen(strcat(out_file,"_avg_ribo_tRNA.out"),"w");
-		
-		avg_Rf = avg_Rf/(tot_time-thresh_time);
-		fprintf(f5,"Free_ribo\t%g\n",avg_Rf);
-		for(c1=0;c1<61;c1++)
-		{	if(avg_tRNA_abndc[c1]>0)
-		{	avg_tRNA_abndc[c1] = avg_tRNA_abndc[c1]/(tot_time-thresh_time);
-			fprintf(f5,"Free_tRNA%d\t%g\n",c1,avg_tRNA_abndc[c1]);
-		}
+	if(S->C.avg_started == 0 || span <= 0)
+	{	span = 0;
+	}
+	if(avg_ribo != NULL)
+	{	*avg_ribo = (span > 0) ? S->C.avg_Rf/span : 0;
+	}
+	if(avg_tRNA != NULL)
+	{	for(c1=0;c1<61;c1++)
+		{	avg_tRNA[c1] = (span > 0) ? S->C.avg_tRNA_abndc[c1]/span : 0;
 		}
-		fclose(f5);
 	}
+}
+
+void smopt_free_pools(smopt_sim *S, int *ribo, int *tRNA)
+{	if(ribo != NULL)
+	{	*ribo = S->C.Rf;
+	}
+	if(tRNA != NULL)
+	{	memcpy(tRNA, S->C.Tf, sizeof(int) * 61);
+	}
+}
+
+void smopt_occupancy(smopt_sim *S, int gene, int *count)
+{	int c1, c2;
 	
-	// The final state of the system - positions of bound ribosomes on mRNAs
-	if(printOpt[4]==1)
-	{	strcpy(out_file,out_prefix);
-		f6 = fopen(strcat(out_file,"_final_ribo_pos.out"),"w");
-		
-		// Print final state for individual mRNAs
-		for(c1=0;c1<tot_mRNA;c1++)
-		{	if(R_grid[c1][0]==tot_ribo)
-		{	fprintf(f6,"0");
-		}
-		else
-		{	fprintf(f6,"1");
+	memset(count, 0, sizeof(int) * S->Gene[gene].len);
+	for(c1=0;c1<S->C.n_mRNA;c1++)
+	{	if(S->C.mRNA[c1].gene != gene)
+		{	continue;
 		}
-			
-			for(c2=1;c2<Gene[mRNA[c1].gene].len;c2++)
-			{	if(R_grid[c1][c2]==tot_ribo)
-			{	fprintf(f6," 0");
+		for(c2=0;c2<S->Gene[gene].len;c2++)
+		{	if(Grid_Get(&S->C.R_grid, c1, c2) != S->C.par.tot_ribo)
+			{	count[c2]++;
 			}
-			else
-			{	fprintf(f6," 1");
-			}
-			}
-			fprintf(f6,"\n");
 		}
-		fclose(f6);
 	}
+}
+
+void smopt_destroy(smopt_sim *S)
+{	Cell_Free(&S->C);
+	free(S->row_off);
+	free(S->mRNA_gene);
+	free(S->codons);
+	free(S->Gene);
+	free(S);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Main Function
+// Left out of the library (-DSMOPT_LIB)
+#ifndef SMOPT_LIB
+int main(int argc, char *argv[])
+{	int c1;
+#ifdef SMOPT_BENCH
+	clock_gettime(CLOCK_MONOTONIC, &bench_start);
+#endif
+
+	// Read in arguments from the commandline
+	Read_Commandline_Args(argc, argv);
 	
-	// Time spent by stalled ribosomes on each gene
-	if(printOpt[5]==1)
-	{	strcpy(out_file,out_prefix);
-		f7 = fopen(strcat(out_file,"_gene0_pos_stall_ribo.out"),"w");
-		
-		fprintf(f7,"Pos\tAvg_ribo_stall\n");
-		for(c1=0;c1<Gene[0].len;c1++)
-		{	time_waste_ribo_pos[c1] = time_waste_ribo_pos[c1]/(tot_time-thresh_time);
-			fprintf(f7,"%d\t%g\n",c1,time_waste_ribo_pos[c1]);
+	// Random number generation setup
+	gsl_rng_env_setup();
+	
+	// The job server and its client read no genome here, jobs name their own
+	if(server_client == 1)
+	{	Run_Client();
+		return 0;
+	}
+	if(strcmp(server_socket, "") != 0)
+	{	Run_Server();
+	}
+	
+	// A run already in the result cache is not simulated again (the points of a sweep are looked up one by one)
+	if(strcmp(cache_dir, "") != 0)
+	{	Cache_Key(argc, argv);
+		if(strcmp(sweep_file, "") == 0 && Cache_Restore(cache_key, out_prefix))
+		{	printf("\nOutputs restored from the result cache (entry %s)\n",cache_key);fflush(stdout);
+			return 0;
 		}
-		fclose(f7);
-		
-		strcpy(out_file,out_prefix);
-		f8 = fopen(strcat(out_file,"_allgene_stall_ribo.out"),"w");
-		fprintf(f8,"Gene\tAvg_ribo_stall\n");
-		for(c1=0;c1<n_genes;c1++)
-		{	time_waste_ribo[c1] = time_waste_ribo[c1]/(tot_time-thresh_time);
-			fprintf(f8,"%d\t%g\n",c1,time_waste_ribo[c1]);
+	}
+	
+#ifdef SMOPT_TELEMETRY
+	if(strcmp(telem_file, "-") == 0)
+	{	telem_fh = stderr;
+	}
+	else if(strcmp(telem_file, "") != 0)
+	{	telem_fh = fopen(telem_file, "w");
+		if(telem_fh == NULL)
+		{	printf("\nCannot write telemetry file %s\n",telem_file);fflush(stdout);
+			exit(1);
 		}
-		fclose(f8);
 	}
+#endif
+
 	
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////	
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	
-	if(printOpt[6]==1)
-	{	strcpy(out_file,out_prefix);
-		f9 = fopen(strcat(out_file,"_gene_pos_sp_ribo_500.out"),"w");
-		
-		for(c1=0;c1<n_genes;c1++)
-		{	fprintf(f9,"%d",gene_sp_ribo_500[c1][0]);
-			for(c2=1;c2<Gene[c1].len;c2++)
-			{	fprintf(f9," %d",gene_sp_ribo_500[c1][c2]);
-			}
-			fprintf(f9,"\n");
-		}
-		fclose(f9);
+	// User specified parameters for quick test
+	gene *Gene = (gene *)malloc(sizeof(gene) * n_genes);
+	if(Gene == NULL)
+	{	printf("Too many genes\nOut of memory\n");fflush(stdout);
+		exit(1);
 	}
 	
+	trna *cTRNA = (trna *)malloc(sizeof(trna) * 61);
+	if(cTRNA == NULL)
+	{	printf("Too many tRNAs\nOut of memory\n");fflush(stdout);
+		exit(1);
+	}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////	
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	
-	// The final state of the system - positions of bound ribosomes on mRNAs and genes
-	if(printOpt[7]==1 || printOpt[8]==1)
-	{	// Initialize the gene position specific ribosome density array
-		for(c1=0;c1<n_genes;c1++)
-		{	for(c2=0;c2<Gene[c1].len;c2++)
-			{	gene_sp_ribo[c1][c2] = 0;
-				gene_sp_ribo_ns[c1][c2] = 0;
-			}
-		}
-		
-		// Initialize the avg position specific ribosome density array
-		for(c1=0;c1<obs_max_len;c1++)
-		{	avg_ribo_pos[0][c1] = 0.0;
-			avg_ribo_pos[1][c1] = 0.0;
-			avg_ribo_pos[2][c1] = 0.0;
-			avg_ribo_pos[3][c1] = 0.0;
-			gcount[c1] = 0;
-		}
-		
-		// Final state for individual mRNAs
-		for(c1=0;c1<tot_mRNA;c1++)
-		{	if(R_grid[c1][0]!=tot_ribo)
-			{	gene_sp_ribo[mRNA[c1].gene][0]++;
-				if(R_grid[c1][10]==tot_ribo)
-				{	gene_sp_ribo_ns[mRNA[c1].gene][0]++;
-				}
-			}
-			
-			for(c2=1;c2<Gene[mRNA[c1].gene].len;c2++)
-			{	if(R_grid[c1][c2]!=tot_ribo)
-				{	gene_sp_ribo[mRNA[c1].gene][c2]++;
-					if(R_grid[c1][c2+10]==tot_ribo || (c2+10)>Gene[mRNA[c1].gene].len)
-					{	if(R_grid[c1][c2-10]==tot_ribo || c2<10)
-						{	gene_sp_ribo_ns[mRNA[c1].gene][c2]++;
-						}
-					}
-				}
-			}
-		}
-		
-		// Calculate final density on each position of a gene
-		for(c1=0;c1<n_genes;c1++)
-		{	n_tot = 0;
-			n_tot_ns = 0;
-			
-			gcount[0]++;
-			n_tot += gene_sp_ribo[c1][0];
-			n_tot_ns += gene_sp_ribo_ns[c1][0];
-			
-			for(c2=1;c2<Gene[c1].len;c2++)
-			{	gcount[c2]++;
-				n_tot += gene_sp_ribo[c1][c2];
-				n_tot_ns += gene_sp_ribo_ns[c1][c2];
-			}
-			
-			gmean = (double)n_tot/(double)Gene[c1].len;
-			gmean_ns = (double)n_tot_ns/(double)Gene[c1].len;
-			for(c2=0;c2<Gene[c1].len;c2++)
-			{	if(gmean>0)
-				{	avg_ribo_pos[0][c2] += (double)gene_sp_ribo[c1][c2]/gmean;
-				}
-				if(gmean_ns>0)
-				{	avg_ribo_pos[2][c2] += (double)gene_sp_ribo_ns[c1][c2]/gmean_ns;
-				}
-				avg_ribo_pos[1][c2] += (double)gene_sp_ribo[c1][c2]/(double)Gene[c1].exp;
-				avg_ribo_pos[3][c2] += (double)gene_sp_ribo_ns[c1][c2]/(double)Gene[c1].exp;
-			}
-		}
-		
-		if(printOpt[7]==1)
-		{	strcpy(out_file,out_prefix);
-			f9 = fopen(strcat(out_file,"_gene_pos_sp_ribo.out"),"w");
-			
-			for(c1=0;c1<n_genes;c1++)
-			{	fprintf(f9,"%d",gene_sp_ribo[c1][0]);
-				for(c2=1;c2<Gene[c1].len;c2++)
-				{	fprintf(f9," %d",gene_sp_ribo[c1][c2]);
-				}
-				fprintf(f9,"\n");
-			}
-			fclose(f9);
-			
-			strcpy(out_file,out_prefix);
-			f11 = fopen(strcat(out_file,"_gene_pos_sp_ribo_nostall.out"),"w");
-			
-			for(c1=0;c1<n_genes;c1++)
-			{	fprintf(f11,"%d",gene_sp_ribo_ns[c1][0]);
-				for(c2=1;c2<Gene[c1].len;c2++)
-				{	fprintf(f11," %d",gene_sp_ribo_ns[c1][c2]);
-				}
-				fprintf(f11,"\n");
-			}
-			fclose(f11);
-		}
-		
-		if(printOpt[8]==1)
-		{	strcpy(out_file,out_prefix);
-			f10 = fopen(strcat(out_file,"_avg_pos_sp_ribo.out"),"w");
-			fprintf(f10,"Pos\tRPF_avg\tmRNA_avg\tRPF_avg_nostall\tmRNA_avg_nostall\n");
-			for(c2=0;c2<obs_max_len;c2++)
-			{	c1 = c2+1;
-				avg_ribo_pos[0][c2] /= (double)gcount[c2];
-				avg_ribo_pos[1][c2] /= (double)gcount[c2];
-				avg_ribo_pos[2][c2] /= (double)gcount[c2];
-				avg_ribo_pos[3][c2] /= (double)gcount[c2];
-				fprintf(f10,"%d\t%g\t%g\t%g\t%g\n",c1,avg_ribo_pos[0][c2],avg_ribo_pos[1][c2],avg_ribo_pos[2][c2],avg_ribo_pos[3][c2]);
-			}
-			fclose(f10);
-		}
+	// Read in the numeric seq
+	size_t map_size;
+	uint8_t *codon_buf = Read_Genome(fasta_file, Gene, &map_size);
+
+	// Read in the trna code file
+	Read_tRNA_File(code_file, cTRNA);
+	
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////	
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	tot_mRNA = 0;
+	for(c1=0;c1<n_genes;c1++)
+	{	tot_mRNA += Gene[c1].exp;
 	}
 	
+	if(stall_opt==1)
+	{	Read_Stall_Genes(stall_genes_file, Gene);
+	}
+	
+	// Genome and tRNA tables are loaded once and shared by all replicates
+	if(strcmp(sweep_file, "") != 0)
+	{	Run_Sweep(Gene, cTRNA);
+	}
+	else if(n_domains > 1)
+	{	Simulate_Domains(Gene, cTRNA, out_prefix);
+	}
+	else if(leap_validate == 1)
+	{	Leap_Validation(Gene, cTRNA);
+	}
+	else if(n_replicates > 1)
+	{	Run_Replicates(Gene, cTRNA);
+	}
+	else
+	{	Simulate_Cell(Gene, cTRNA, 0, out_prefix, NULL);
+	}
+	if(strcmp(cache_dir, "") != 0 && strcmp(sweep_file, "") == 0)
+	{	Cache_Store(cache_key, out_prefix, NULL);
+	}
 	
-	// Free the malloc structures and arrays
+	if(map_size > 0)
+	{	munmap(codon_buf, map_size);
+	}
+	else
+	{	free(codon_buf);
+	}
+	free(stall_off);
 	free(Gene);
-	free(Ribo);
-	free(mRNA);
 	free(cTRNA);
-	free(Rb_e);
-	free(gene_sp_ribo);
-	free(gene_sp_ribo_ns);
-	free(gene_sp_ribo_500);
-	free(free_mRNA);
-	free(R_grid);
-	
-	gsl_rng_free(r);
+#ifdef SMOPT_TELEMETRY
+	if(telem_fh != NULL && telem_fh != stderr)
+	{	fclose(telem_fh);
+	}
+#endif
 }
+#endif
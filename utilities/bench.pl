@@ -0,0 +1,179 @@
+# Throughput benchmark of the simulation. Runs a fixed number of events for every workload of a parameter grid
+# (genes N, ribosomes R, tRNAs t, cell volume V, print options, engine and domains D) on synthetic genomes made with
+# make.synthetic.genome.pl, and writes the results as JSON: events/s, ns/event by event type, peak RSS and
+# startup time of the fastest of <reps> runs of each workload. Workloads split into domains (-D) also report their
+# wall-clock speedup over the same workload in one piece and an accuracy check: the average free ribosomes and tRNAs
+# (-p4) of a short simulation of the cell split into domains against the cell in one piece (mean and largest relative
+# difference), next to the same difference between two seeds of the cell in one piece.
+# Given a baseline file written by an earlier run,
+# the events/s of each workload are compared with it and the script exits with status 1 if any workload is
+# slower than the baseline by more than <tolerance> (relative, default 0.1).
+# The simulation must be built with -DSMOPT_BENCH (see the top of source/translation_v2.0.c), e.g.
+#	gcc source/translation_v2.0.c -lm -lgsl -lgslcblas -O3 -DSMOPT_BENCH -o bin/SMoPT_v2_bench
+# Edit the grid below to change the workloads. Genomes and outputs of the runs are written to <work_dir>.
+
+# Usage: 	perl bench.pl <bench_binary> <output_json> [baseline_json] [tolerance]
+# Example:	perl bench.pl ../bin/SMoPT_v2_bench bench.json
+#		perl bench.pl ../bin/SMoPT_v2_bench bench.new.json bench.json 0.05
+
+use JSON::PP;
+use File::Basename;
+
+# Workloads
+@grid_N=(1000,4839);						# Number of genes
+@grid_R=(200000);							# Number of ribosomes
+@grid_t=(3300000);							# Number of tRNAs
+@grid_V=(4.2e-17);							# Cell volume
+@grid_p=("","-p1 -p2 -p3","-p4 -p6","-p7");	# Print options
+@grid_E=("direct");							# Engines
+@grid_D=(1,4);								# Domains of the cell
+$n_events=2000000;							# Events of each run
+$reps=3;									# Runs of each workload, the fastest is kept
+$acc_time=20;								# Simulated time of the accuracy checks of domains
+$acc_burn=10;								# and their burn-in
+
+# Mean and largest relative difference of the average free ribosomes and tRNAs of two runs
+sub avg_diff
+{	my ($fa,$fb)=@_;
+	my (%a,@x,$d,$sum,$max,$n);
+	open fa,"$fa" or die "Cannot open $fa\n";
+	while(<fa>)
+	{	chomp;
+		@x=split(/\t/);
+		$a{$x[0]}=$x[1];
+	}
+	close fa;
+	($sum,$max,$n)=(0,0,0);
+	open fb,"$fb" or die "Cannot open $fb\n";
+	while(<fb>)
+	{	chomp;
+		@x=split(/\t/);
+		if(!exists($a{$x[0]}) || abs($a{$x[0]})+abs($x[1])==0)
+		{	next;
+		}
+		$d=abs($a{$x[0]}-$x[1])/((abs($a{$x[0]})+abs($x[1]))/2);
+		$sum+=$d;
+		$n++;
+		if($d>$max)
+		{	$max=$d;
+		}
+	}
+	close fb;
+	return {mean_rel_diff=>($n>0) ? $sum/$n : 0,max_rel_diff=>$max};
+}
+
+# Accuracy of a cell split into <D> domains: differences of its free pools from the cell in one piece (seed 1),
+# and of two seeds of the cell in one piece. The runs are shared by the workloads that differ only in print options.
+sub domain_check
+{	my ($args,$tag,$D)=@_;
+	my $cmd="$bin -Tt $acc_time -Tb $acc_burn $args -p4";
+	my $out="$work_dir/acc_$tag";
+	foreach my $s (1,2)
+	{	if(!(-e "${out}_s${s}_avg_ribo_tRNA.out"))
+		{	system("$cmd -s $s -O ${out}_s$s > /dev/null")==0 or die "Cannot run: $cmd -s $s\n";
+		}
+	}
+	if(!(-e "${out}_D${D}_avg_ribo_tRNA.out"))
+	{	system("$cmd -D $D -s 1 -O ${out}_D$D > /dev/null")==0 or die "Cannot run: $cmd -D $D\n";
+	}
+	return (avg_diff("${out}_s1_avg_ribo_tRNA.out","${out}_D${D}_avg_ribo_tRNA.out"),avg_diff("${out}_s1_avg_ribo_tRNA.out","${out}_s2_avg_ribo_tRNA.out"));
+}
+
+# Synthetic genomes: median length, spread of lengths, expression skew, codon bias, seed
+@genome=(400,0.6,1.0,0.5,1);
+
+$dir=dirname($0);
+$trna_file="$dir/../example/input/S.cer.tRNA";
+$work_dir="bench_work";
+
+if(@ARGV<2)
+{	die "Usage: perl bench.pl <bench_binary> <output_json> [baseline_json] [tolerance]\n";
+}
+($bin,$out_file,$base_file)=@ARGV;
+$tol=(@ARGV>3) ? $ARGV[3] : 0.1;
+mkdir $work_dir;
+
+@results=();
+foreach $N (@grid_N)
+{	$genom="$work_dir/syn_$N";
+	if(!(-e "$genom.genom"))
+	{	system("perl $dir/make.synthetic.genome.pl $N @genome $genom")==0 or die "Cannot generate $genom.genom\n";
+	}
+	foreach $R (@grid_R)
+	{	foreach $t (@grid_t)
+		{	foreach $V (@grid_V)
+			{	foreach $p (@grid_p)
+				{	foreach $E (@grid_E)
+					{	foreach $D (@grid_D)
+						{	$key="N=$N R=$R t=$t V=$V E=$E p=$p D=$D";
+							$best=undef;
+							for($k=0;$k<$reps;$k++)
+							{	$cmd="$bin -Tt 100000 -Tb 0 -N $N -R $R -t $t -V $V -E $E $p -D $D -B $n_events -s ".($k+1)." -F $genom.genom -C $trna_file -O $work_dir/out";
+								$res=undef;
+								foreach(`$cmd`)
+								{	if(/^\{"bench"/)
+									{	$res=decode_json($_);
+									}
+								}
+								if(!defined($res))
+								{	die "No benchmark output from: $cmd\n(was the binary built with -DSMOPT_BENCH?)\n";
+								}
+								if(!defined($best) || $res->{events_per_s}>$best->{events_per_s})
+								{	$best=$res;
+								}
+							}
+							printf "%-60s\t%.4g events/s\t%.1f ns/event\t%d kB\n",$key,$best->{events_per_s},$best->{ns_per_event},$best->{peak_rss_kb};
+							
+							# Speedup and accuracy of the domains against the cell in one piece
+							if($D>1)
+							{	foreach (@results)
+								{	if($_->{key} eq "N=$N R=$R t=$t V=$V E=$E p=$p D=1")
+									{	$best->{speedup}=$best->{events_per_s}/$_->{events_per_s};
+									}
+								}
+								($best->{accuracy},$best->{noise})=domain_check("-N $N -R $R -t $t -V $V -E $E -F $genom.genom -C $trna_file","${N}_${R}_${t}_${V}_${E}",$D);
+								printf "%-60s\tspeedup %.3g\tfree pools rel diff %.4f (seeds %.4f)\n",$key,$best->{speedup},$best->{accuracy}{mean_rel_diff},$best->{noise}{mean_rel_diff};
+							}
+							push(@results,{key=>$key,N=>$N,R=>$R,t=>$t,V=>$V,E=>$E,p=>$p,D=>$D,%$best});
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+open fo,">$out_file" or die "Cannot write $out_file\n";
+print fo JSON::PP->new->canonical->pretty->encode({binary=>$bin,events=>$n_events,reps=>$reps,date=>scalar(localtime),results=>\@results});
+close fo;
+
+# Comparison with the baseline
+if(defined($base_file))
+{	open fi,"$base_file" or die "Cannot open $base_file\n";
+	local $/;
+	$base=decode_json(<fi>);
+	close fi;
+
+	%base_rate=();
+	foreach (@{$base->{results}})
+	{	$base_rate{$_->{key}}=$_->{events_per_s};
+	}
+	$n_slow=0;
+	print "\nWorkload\tBaseline events/s\tCurrent events/s\tRatio\n";
+	foreach (@results)
+	{	if(!exists($base_rate{$_->{key}}))
+		{	next;
+		}
+		$ratio=$_->{events_per_s}/$base_rate{$_->{key}};
+		$flag="";
+		if($ratio<1-$tol)
+		{	$flag="\tSLOWER";
+			$n_slow++;
+		}
+		printf "%s\t%.4g\t%.4g\t%.3f%s\n",$_->{key},$base_rate{$_->{key}},$_->{events_per_s},$ratio,$flag;
+	}
+	if($n_slow>0)
+	{	print "\n$n_slow workloads are slower than the baseline by more than $tol\n";
+		exit(1);
+	}
+}
@@ -0,0 +1,80 @@
+# Compare the outputs of two simulation runs, e.g. the same cell simulated with two different engines (-E).
+# For every output file present for both prefixes, rows are matched by their first column and the
+# relative difference of each numeric column is reported (mean over rows and the largest one).
+# Rows with fewer than <min_events> events (second column of per-codon and per-gene files) are skipped
+# as their averages are dominated by sampling noise.
+
+# Usage: 	perl compare.outputs.pl <prefix_a> <prefix_b> [min_events]
+# Example:	perl compare.outputs.pl ../example/output/output ../example/output/nrm 100
+
+$min_n = 0;
+if(@ARGV>2)
+{	$min_n = $ARGV[2];
+}
+
+@files = ("_etimes.out","_gene_totetimes.out","_gene_initimes.out","_avg_ribo_tRNA.out","_allgene_stall_ribo.out");
+%counted = ("_etimes.out",1,"_gene_totetimes.out",1,"_gene_initimes.out",1);
+
+foreach $f (@files)
+{	if(!(-e "$ARGV[0]$f") || !(-e "$ARGV[1]$f"))
+	{	next;
+	}
+
+	open fa,"$ARGV[0]$f";
+	chomp(@a=<fa>);
+	close fa;
+	open fb,"$ARGV[1]$f";
+	chomp(@b=<fb>);
+	close fb;
+
+	# Rows of the second run indexed by their first column
+	%rows=();
+	foreach(@b)
+	{	@x=split(/\t/,$_);
+		$rows{$x[0]}=[@x];
+	}
+
+	@head=split(/\t/,$a[0]);
+	$start=1;
+	if($f eq "_avg_ribo_tRNA.out")				# This file has no header
+	{	@head=("Pool","Avg_abundance");
+		$start=0;
+	}
+
+	@sum=();
+	@max=();
+	@n=();
+	for($i=$start;$i<@a;$i++)
+	{	@x=split(/\t/,$a[$i]);
+		if(!exists($rows{$x[0]}))
+		{	next;
+		}
+		@y=@{$rows{$x[0]}};
+		if($counted{$f} && ($x[1]<$min_n || $y[1]<$min_n))
+		{	next;
+		}
+
+		for($j=1;$j<@x;$j++)
+		{	if($x[$j]!~/^-?[\d.]+(e[-+]?\d+)?$/i || $y[$j]!~/^-?[\d.]+(e[-+]?\d+)?$/i)		# Skip nan/inf
+			{	next;
+			}
+			$den=(abs($x[$j])+abs($y[$j]))/2;
+			if($den==0)
+			{	next;
+			}
+			$d=abs($x[$j]-$y[$j])/$den;
+			$sum[$j]+=$d;
+			$n[$j]++;
+			if($d>$max[$j])
+			{	$max[$j]=$d;
+			}
+		}
+	}
+
+	print "$f\n";
+	for($j=1;$j<@head;$j++)
+	{	if($n[$j]>0)
+		{	printf "\t%s\trows=%d\tmean_rel_diff=%.4f\tmax_rel_diff=%.4f\n",$head[$j],$n[$j],$sum[$j]/$n[$j],$max[$j];
+		}
+	}
+}
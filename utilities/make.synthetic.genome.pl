@@ -0,0 +1,76 @@
+# Generate a synthetic processed sequence file (.genom) for benchmarks and tests of the simulation.
+# Gene lengths are log-normal around <median_len> codons with a log-scale spread of <len_sd>. mRNA abundances
+# follow a Zipf law with exponent <exp_skew> over genes in random order (0: all genes equally expressed),
+# with <mRNA_per_gene> mRNAs per gene on average (12 in S.cer.mRNA.abndc.ini.tsv). Codons are drawn from
+# a biased codon usage: codon weights are exp(<codon_bias> * z) with z normal (0: uniform codon usage).
+# Initiation probabilities are log-normal around 0.001. The same arguments and seed give the same file.
+
+# Usage: 	perl make.synthetic.genome.pl <n_genes> <median_len> <len_sd> <exp_skew> <codon_bias> <seed> <output_prefix> [mRNA_per_gene]
+# Example:	perl make.synthetic.genome.pl 4839 400 0.6 1.0 0.5 1 ../example/input/synthetic
+
+($n_genes,$median_len,$len_sd,$exp_skew,$codon_bias,$seed,$prefix)=@ARGV;
+if(@ARGV<7)
+{	die "Usage: perl make.synthetic.genome.pl <n_genes> <median_len> <len_sd> <exp_skew> <codon_bias> <seed> <output_prefix> [mRNA_per_gene]\n";
+}
+$mRNA_per_gene=(@ARGV>7) ? $ARGV[7] : 12;
+srand($seed);
+
+# Standard normal deviate (Box-Muller)
+sub gauss
+{	return sqrt(-2*log(1-rand()))*cos(6.283185307179586*rand());
+}
+
+# Cumulative weights of the 61 sense codons
+@cum=();
+$tot=0;
+for($c=0;$c<61;$c++)
+{	$tot+=exp($codon_bias*gauss());
+	$cum[$c]=$tot;
+}
+
+# Codon drawn from the codon usage (binary search of the cumulative weights)
+sub codon
+{	my $x=rand()*$tot;
+	my ($lo,$hi)=(0,60);
+	while($lo<$hi)
+	{	my $mid=int(($lo+$hi)/2);
+		if($cum[$mid]<$x)
+		{	$lo=$mid+1;
+		}
+		else
+		{	$hi=$mid;
+		}
+	}
+	return $lo;
+}
+
+# Zipf weights of the genes, assigned to the genes in random order
+@rank=(1..$n_genes);
+for($i=$n_genes-1;$i>0;$i--)
+{	$j=int(rand($i+1));
+	@rank[$i,$j]=@rank[$j,$i];
+}
+$sum_w=0;
+for($i=1;$i<=$n_genes;$i++)
+{	$sum_w+=$i**(-$exp_skew);
+}
+
+open fo,">$prefix.genom" or die "Cannot write $prefix.genom\n";
+for($g=0;$g<$n_genes;$g++)
+{	$len=int($median_len*exp($len_sd*gauss())+0.5);
+	if($len<20)
+	{	$len=20;
+	}
+	$exp=int($n_genes*$mRNA_per_gene*$rank[$g]**(-$exp_skew)/$sum_w+0.5);
+	if($exp<1)
+	{	$exp=1;
+	}
+	$ini=0.001*exp(0.5*gauss());
+
+	@seq=();
+	for($j=0;$j<$len;$j++)
+	{	push(@seq,codon());
+	}
+	print fo "$ini $exp ",join(" ",@seq),"\n";
+}
+close fo;
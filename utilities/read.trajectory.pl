@@ -0,0 +1,99 @@
+# Read the binary trajectory of ribosome positions written by the simulation with -pt (<prefix>_ribo_traj.bin).
+# Each frame holds the codons bound by ribosomes at one time point, as offsets into the codons of all mRNAs
+# laid end to end, sorted and stored as variable-length gaps (7 bits per byte, lowest bits first).
+# The file must be read on a machine with the same byte order as the one that wrote it.
+
+# Usage: 	perl read.trajectory.pl <traj_file>				List the frames: frame, time, number of bound ribosomes
+#		perl read.trajectory.pl <traj_file> <frame>			Bound ribosomes of a frame: mRNA, gene, codon position
+#		perl read.trajectory.pl <traj_file> sum				Bound ribosomes at each position of each gene summed over all frames
+#										(same format as <prefix>_gene_pos_sp_ribo_500.out)
+# Example:	perl read.trajectory.pl ../example/output/output_ribo_traj.bin 10
+
+open fi,"$ARGV[0]" or die "Cannot open $ARGV[0]\n";
+binmode fi;
+
+read(fi,$buf,16);
+($magic,$version,$n_mRNA)=unpack("a8 L L",$buf);
+if($magic ne "SMOPTTRJ" || $version!=1)
+{	die "$ARGV[0] is not a trajectory file of version 1\n";
+}
+
+# Gene and length of each mRNA, and the offset of its first codon
+read(fi,$buf,8*$n_mRNA);
+@h=unpack("L*",$buf);
+@gene=();
+@off=(0);
+%glen=();
+$n_genes=0;
+for($i=0;$i<$n_mRNA;$i++)
+{	$gene[$i]=$h[2*$i];
+	$off[$i+1]=$off[$i]+$h[2*$i+1];
+	$glen{$gene[$i]}=$h[2*$i+1];
+	if($gene[$i]+1>$n_genes)
+	{	$n_genes=$gene[$i]+1;
+	}
+}
+
+# mRNA containing a codon offset (binary search)
+sub find_mRNA
+{	my ($x)=@_;
+	my ($lo,$hi)=(0,$n_mRNA-1);
+	while($lo<$hi)
+	{	my $mid=int(($lo+$hi+1)/2);
+		if($off[$mid]<=$x)
+		{	$lo=$mid;
+		}
+		else
+		{	$hi=$mid-1;
+		}
+	}
+	return $lo;
+}
+
+$mode=(@ARGV>1) ? $ARGV[1] : "list";
+@sum=();
+$frame=0;
+while(read(fi,$buf,16)==16)
+{	($t,$n,$n_bytes)=unpack("d L L",$buf);
+	read(fi,$buf,$n_bytes);
+
+	if($mode eq "list")
+	{	print "$frame\t$t\t$n\n";
+	}
+	elsif($mode eq "sum" || $mode==$frame)
+	{	$x=0;
+		$gap=0;
+		$shift=0;
+		foreach $b (unpack("C*",$buf))
+		{	$gap|=($b&127)<<$shift;
+			$shift+=7;
+			if($b<128)
+			{	$x+=$gap;
+				$m=find_mRNA($x);
+				if($mode eq "sum")
+				{	$sum[$gene[$m]][$x-$off[$m]]++;
+				}
+				else
+				{	print "$m\t$gene[$m]\t",$x-$off[$m],"\n";
+				}
+				$gap=0;
+				$shift=0;
+			}
+		}
+		if($mode ne "sum")
+		{	last;
+		}
+	}
+	$frame++;
+}
+close fi;
+
+if($mode eq "sum")
+{	for($g=0;$g<$n_genes;$g++)
+	{	@row=();
+		for($p=0;$p<$glen{$g};$p++)
+		{	push(@row,$sum[$g][$p]+0);
+		}
+		print join(" ",@row),"\n";
+	}
+}